@@ -19,6 +19,7 @@ class AppConstants {
   static const String statusCharUuid = '00001237-0000-1000-8000-00805f9b34fb';
   static const String commandCharUuid = '00001238-0000-1000-8000-00805f9b34fb';
   static const String historyCharUuid = '00001239-0000-1000-8000-00805f9b34fb';
+  static const String diagCharUuid = '0000123a-0000-1000-8000-00805f9b34fb';
   
   // Location Related
   static const int maxLocationHistory = 500;
@@ -0,0 +1,284 @@
+/*
+ * at_stats.cpp
+ *
+ * Implementation of adaptive AT command timeouts
+ *
+ * The timeout comes from the completion latency histogram: the upper
+ * bound of the bucket holding the 95th percentile, with headroom. Mean
+ * and deviation are skewed by a run of fast answers, a percentile bound
+ * only moves when the slow tail itself does. A timeout lands in the
+ * histogram as the full wait, so a step that is genuinely slow grows
+ * its budget, up to the stretch limit over the caller's default. The
+ * smoothed mean (alpha 1/8) and deviation (alpha 1/4) are kept for the
+ * statistics.
+ *
+ * Network-bound commands (SMS submit, attach, bearer, socket open) are
+ * never shortened below the caller's timeout: cutting a slow CMGS short
+ * resends the SMS, cutting CFUN=1 short starts modem recovery.
+ *
+ * Commands are keyed by their name and the first character of their
+ * first parameter, so AT+CFUN=0 and AT+CFUN=1 learn separately.
+ * Commands whose parameters are values (message index or length, baud
+ * rate, band list, socket and context numbers) are cut at the '=', one
+ * slot per value would fill the table. The table holds every key the
+ * firmware sends; should it still fill up, the least used local command
+ * gives up its slot, network commands are never evicted. The same slots
+ * hold a completion latency histogram of every traced transaction
+ * (at_trace.h), including the commands that are read directly instead
+ * of through sendATCommand.
+ */
+
+#include "at_stats.h"
+
+struct ATLatency {
+  char key[AT_STATS_KEY_LEN];
+  uint16_t samples;
+  uint16_t timeouts;
+  uint32_t mean8;   // Mean latency * 8 (ms)
+  uint32_t dev4;    // Mean deviation * 4 (ms)
+  uint16_t traced;
+  uint16_t hist[AT_HIST_BUCKETS];
+};
+
+// Upper bucket bounds (ms), the last bucket is open
+static const uint32_t atHistBounds[AT_HIST_BUCKETS - 1] = {
+  50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+// Commands whose latency depends on the network, matched as key prefixes
+static const char* const atNetworkKeys[] = {
+  "AT+CMGS", "AT+CFUN=1", "AT+CNACT=", "AT+CAOPEN", "AT+CLBS"
+};
+
+// Commands keyed without their parameters (index, length, rate, bands, ids)
+static const char* const atIndexedKeys[] = {
+  "AT+CMGD", "AT+CMGR", "AT+CMGS", "AT+CMGL", "AT+IPR", "AT+CMNB", "AT+CBANDCFG",
+  "AT+CNCFG", "AT+CAOPEN", "AT+CASEND", "AT+CARECV", "AT+CACLOSE", "AT+CLBS",
+  "AT+CGNSMOD", "AT+CGNSCMD", "AT+CSMP", "AT+CNMI"
+};
+
+// Learned latencies (survive deep sleep)
+RTC_DATA_ATTR ATLatency atLatency[AT_STATS_SLOTS];
+
+static bool isNetworkKey(const char* key) {
+  for (size_t i = 0; i < sizeof(atNetworkKeys) / sizeof(atNetworkKeys[0]); i++) {
+    if (strncmp(key, atNetworkKeys[i], strlen(atNetworkKeys[i])) == 0) return true;
+  }
+  return false;
+}
+
+static bool isIndexedCommand(const char* key, int len) {
+  for (size_t i = 0; i < sizeof(atIndexedKeys) / sizeof(atIndexedKeys[0]); i++) {
+    if ((int)strlen(atIndexedKeys[i]) == len && strncmp(key, atIndexedKeys[i], len) == 0) return true;
+  }
+  return false;
+}
+
+/*
+ * Build the lookup key: text up to ',' or '"', and at most one
+ * character after '=' (none for indexed commands)
+ *
+ * @param key Receives at least AT_STATS_KEY_LEN bytes
+ */
+void makeATKey(const char* cmd, char* key) {
+  int len = 0;
+  int equals = -1;
+  for (int i = 0; cmd[i] != '\0' && len < AT_STATS_KEY_LEN - 1; i++) {
+    char c = cmd[i];
+    if (c == ',' || c == '"' || c == '\r' || c == '\n') break;
+    if (equals != -1 && i > equals + 1) break;
+    if (c == '=') {
+      if (isIndexedCommand(key, len)) break;
+      equals = i;
+    }
+    key[len++] = c;
+  }
+  key[len] = '\0';
+}
+
+/*
+ * Find the slot for a command key
+ *
+ * @param create Take over the least used local slot if the command is new
+ */
+static ATLatency* findKeySlot(const char* key, bool create) {
+  ATLatency* spare = nullptr;
+  for (int i = 0; i < AT_STATS_SLOTS; i++) {
+    if (strcmp(atLatency[i].key, key) == 0) return &atLatency[i];
+    if (isNetworkKey(atLatency[i].key)) continue;
+    if (!spare || atLatency[i].samples + atLatency[i].traced < spare->samples + spare->traced) {
+      spare = &atLatency[i];
+    }
+  }
+  if (!create || !spare) return nullptr;
+
+  memset(spare, 0, sizeof(*spare));
+  strncpy(spare->key, key, AT_STATS_KEY_LEN - 1);
+  return spare;
+}
+
+static ATLatency* findSlot(const String& cmd, bool create) {
+  char key[AT_STATS_KEY_LEN];
+  makeATKey(cmd.c_str(), key);
+  return findKeySlot(key, create);
+}
+
+/*
+ * Timeout from the latency histogram, before clamping
+ *
+ * @return 0 without enough samples, UINT32_MAX if the percentile is in the open bucket
+ */
+static uint32_t learnedTimeout(const ATLatency& slot) {
+  if (slot.traced < AT_STATS_MIN_SAMPLES) return 0;
+
+  uint32_t target = ((uint32_t)slot.traced * AT_TIMEOUT_PERCENTILE + 99) / 100;
+  uint32_t seen = 0;
+  for (int b = 0; b < AT_HIST_BUCKETS - 1; b++) {
+    seen += slot.hist[b];
+    if (seen >= target) return atHistBounds[b] * AT_TIMEOUT_HEADROOM;
+  }
+  return UINT32_MAX;
+}
+
+/*
+ * Timeout for a command from its learned latency
+ *
+ * @param defaultMs Caller's timeout, used until enough samples exist and
+ *                  as the floor for network-bound commands
+ */
+uint32_t getAdaptiveTimeout(const String& cmd, uint32_t defaultMs) {
+  const ATLatency* slot = findSlot(cmd, false);
+  if (!slot) return defaultMs;
+
+  uint32_t learned = learnedTimeout(*slot);
+  if (learned == 0) return defaultMs;
+
+  uint32_t floor = isNetworkKey(slot->key) ? defaultMs : (uint32_t)AT_TIMEOUT_FLOOR_MS;
+  uint32_t ceiling = max(floor, min((uint32_t)AT_TIMEOUT_CEILING_MS, defaultMs * AT_TIMEOUT_STRETCH));
+  return constrain(learned, floor, ceiling);
+}
+
+/*
+ * Fold one response time into the command's statistics
+ *
+ * @param elapsedMs Time to the final response, or the full wait on timeout
+ */
+void recordATLatency(const String& cmd, uint32_t elapsedMs, bool timedOut) {
+  ATLatency* slot = findSlot(cmd, true);
+  if (!slot) return;
+
+  if (slot->samples == 0) {
+    slot->mean8 = elapsedMs * 8;
+    slot->dev4 = elapsedMs * 2;
+  } else {
+    int32_t error = (int32_t)elapsedMs - (int32_t)(slot->mean8 / 8);
+    slot->mean8 += error;
+    slot->dev4 += abs(error) - (int32_t)(slot->dev4 / 4);
+  }
+
+  if (slot->samples < UINT16_MAX) slot->samples++;
+  if (timedOut && slot->timeouts < UINT16_MAX) slot->timeouts++;
+}
+
+/*
+ * Count one traced transaction in its latency bucket
+ *
+ * @param key Command key from makeATKey()
+ */
+void recordATHistogram(const char* key, uint32_t elapsedMs) {
+  ATLatency* slot = findKeySlot(key, true);
+  if (!slot) return;
+
+  int bucket = 0;
+  while (bucket < AT_HIST_BUCKETS - 1 && elapsedMs >= atHistBounds[bucket]) bucket++;
+
+  if (slot->hist[bucket] < UINT16_MAX) slot->hist[bucket]++;
+  if (slot->traced < UINT16_MAX) slot->traced++;
+}
+
+/*
+ * Format histograms as JSON fields, from slot 'slot' on:
+ * "bounds":[...],"cmds":{"AT+CSQ":[1,12,3],...}
+ * Each command is the index of its first non-empty bucket followed by
+ * the counts up to its last non-empty one. Commands that do not fit
+ * are left for the next call.
+ *
+ * @param out Buffer, or nullptr to only measure
+ * @param slot Slot to start at, advanced past the commands written
+ * @return length written
+ */
+int formatATHistograms(char* out, size_t outSize, int& slot) {
+  char text[96];
+  int len = snprintf(text, sizeof(text), "\"bounds\":[");
+  for (int i = 0; i < AT_HIST_BUCKETS - 1; i++) {
+    len += snprintf(text + len, sizeof(text) - len, i ? ",%lu" : "%lu", atHistBounds[i]);
+  }
+  len += snprintf(text + len, sizeof(text) - len, "],\"cmds\":{");
+  if (len + 2 > (int)outSize) return 0;
+  if (out) memcpy(out, text, len + 1);
+
+  bool first = true;
+  for (; slot < AT_STATS_SLOTS; slot++) {
+    const ATLatency& s = atLatency[slot];
+    if (s.traced == 0) continue;
+
+    int low = 0;
+    int high = AT_HIST_BUCKETS - 1;
+    while (low < high && s.hist[low] == 0) low++;
+    while (high > low && s.hist[high] == 0) high--;
+
+    int n = snprintf(text, sizeof(text), "%s\"%s\":[%d", first ? "" : ",", s.key, low);
+    for (int b = low; b <= high; b++) {
+      n += snprintf(text + n, sizeof(text) - n, ",%u", s.hist[b]);
+    }
+    n += snprintf(text + n, sizeof(text) - n, "]");
+
+    if (len + n + 2 > (int)outSize) break;  // Keep room for the closing brace
+    if (out) memcpy(out + len, text, n + 1);
+    len += n;
+    first = false;
+  }
+
+  if (out) snprintf(out + len, outSize - len, "}");
+  return len + 1;
+}
+
+/*
+ * Print learned latencies and the timeouts derived from them
+ */
+void printATStats() {
+  Serial.println("\nAT latency (mean / deviation / p95 timeout ms, before clamping):");
+  for (int i = 0; i < AT_STATS_SLOTS; i++) {
+    const ATLatency& s = atLatency[i];
+    if (s.samples == 0) continue;
+    uint32_t learned = learnedTimeout(s);
+    Serial.printf("  %-12s %5lu / %5lu / %5lu%s  (%u samples, %u timeouts)\n",
+                  s.key, s.mean8 / 8, s.dev4 / 4,
+                  learned == UINT32_MAX ? atHistBounds[AT_HIST_BUCKETS - 2] * AT_TIMEOUT_HEADROOM : learned, learned == UINT32_MAX ? "+" : " ",
+                  s.samples, s.timeouts);
+  }
+}
+
+/*
+ * Print completion latency histograms
+ */
+void printATHistograms() {
+  Serial.print("\nAT latency histogram (ms):\n  command     ");
+  for (int i = 0; i < AT_HIST_BUCKETS - 1; i++) Serial.printf(" <%-5lu", atHistBounds[i]);
+  Serial.println("  more");
+
+  for (int i = 0; i < AT_STATS_SLOTS; i++) {
+    const ATLatency& s = atLatency[i];
+    if (s.traced == 0) continue;
+    Serial.printf("  %-12s", s.key);
+    for (int b = 0; b < AT_HIST_BUCKETS; b++) Serial.printf(" %6u", s.hist[b]);
+    Serial.println();
+  }
+}
+
+/*
+ * Forget all learned latencies
+ */
+void clearATStats() {
+  memset(atLatency, 0, sizeof(atLatency));
+}
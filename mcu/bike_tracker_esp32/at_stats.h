@@ -0,0 +1,40 @@
+/*
+ * at_stats.h
+ *
+ * Adaptive AT command timeouts
+ * Learns per-command response latency in RTC memory and derives
+ * timeouts from a high percentile of it. Local commands fail fast,
+ * network steps never get less than the caller's timeout but may grow
+ * up to a ceiling when they are genuinely slow.
+ */
+
+#ifndef AT_STATS_H
+#define AT_STATS_H
+
+#include <Arduino.h>
+
+#define AT_STATS_SLOTS          56      // Commands tracked - the firmware sends about 50 keys
+#define AT_STATS_KEY_LEN        16      // "AT+CGNSPWR=1" - command and first parameter character
+#define AT_STATS_MIN_SAMPLES    4       // Responses seen before the learned timeout is used
+#define AT_TIMEOUT_FLOOR_MS     300
+#define AT_TIMEOUT_CEILING_MS   60000
+#define AT_TIMEOUT_STRETCH      2       // Learned timeout may reach this multiple of the caller's
+#define AT_TIMEOUT_PERCENTILE   95      // Completion latency percentile the timeout is based on
+#define AT_TIMEOUT_HEADROOM     2       // Timeout = headroom * percentile bucket bound
+#define AT_HIST_BUCKETS         9       // Completion latency histogram, see atHistBounds
+
+// Adaptive timeouts
+uint32_t getAdaptiveTimeout(const String& cmd, uint32_t defaultMs);
+void recordATLatency(const String& cmd, uint32_t elapsedMs, bool timedOut);
+
+// Latency histograms (every traced transaction)
+void makeATKey(const char* cmd, char* key);
+void recordATHistogram(const char* key, uint32_t elapsedMs);
+int formatATHistograms(char* out, size_t outSize, int& slot);
+
+// Statistics
+void printATStats();
+void printATHistograms();
+void clearATStats();
+
+#endif // AT_STATS_H
@@ -0,0 +1,186 @@
+/*
+ * at_trace.cpp
+ *
+ * Implementation of AT transaction tracing
+ *
+ * sendATCommand and readResponse close their transactions themselves,
+ * code that reads the UART directly (SMS submit, GNSS info, socket
+ * receive) calls noteATFirstByte() and endATTrace(). A transaction that
+ * is never closed is recorded as abandoned when the next one begins,
+ * so a missing hook shows up in the trace instead of skewing it.
+ */
+
+#include "at_trace.h"
+#include "sim7070g.h"
+
+// Ring of recent transactions (survives deep sleep)
+RTC_DATA_ATTR ATTraceRecord atTrace[AT_TRACE_SIZE];
+RTC_DATA_ATTR uint8_t atTraceIndex = 0;   // Next slot to write
+RTC_DATA_ATTR uint8_t atTraceCount = 0;
+RTC_DATA_ATTR uint8_t atTraceWake = 0;
+
+// Open transaction
+static ATTraceRecord pending;
+static bool pendingOpen = false;
+static bool wakeCounted = false;
+
+static const char* outcomeName(uint8_t outcome) {
+  switch (outcome) {
+    case AT_TRACE_OK:        return "ok";
+    case AT_TRACE_NEGATIVE:  return "negative";
+    case AT_TRACE_ERROR:     return "error";
+    case AT_TRACE_TIMEOUT:   return "timeout";
+    case AT_TRACE_ABANDONED: return "abandoned";
+    default:                 return "?";
+  }
+}
+
+/*
+ * Start a transaction
+ * Call right after the command is written to the UART
+ */
+void beginATTrace(const char* cmd, size_t bytesOut) {
+  if (pendingOpen) endATTrace(AT_TRACE_ABANDONED, 0);
+
+  // Wake number tells records of different wakes apart (millis() restarts)
+  if (!wakeCounted) {
+    atTraceWake++;
+    wakeCounted = true;
+  }
+
+  memset(&pending, 0, sizeof(pending));
+  makeATKey(cmd, pending.key);
+  pending.startMs = millis();
+  pending.firstByteMs = 0xFFFF;
+  pending.bytesOut = min(bytesOut, (size_t)UINT16_MAX);
+  pending.wake = atTraceWake;
+  pendingOpen = true;
+}
+
+/*
+ * Mark the first response byte of the open transaction
+ * Cheap to call for every byte, only the first one counts
+ */
+void noteATFirstByte() {
+  if (pendingOpen && pending.firstByteMs == 0xFFFF) {
+    uint32_t elapsed = millis() - pending.startMs;
+    pending.firstByteMs = min(elapsed, (uint32_t)0xFFFE);
+  }
+}
+
+/*
+ * Close the open transaction and store it
+ */
+void endATTrace(ATTraceOutcome outcome, size_t bytesIn) {
+  if (!pendingOpen) return;
+  pendingOpen = false;
+
+  uint32_t total = millis() - pending.startMs;
+  pending.totalMs = min(total, (uint32_t)UINT16_MAX);
+  pending.bytesIn = min(bytesIn, (size_t)UINT16_MAX);
+  pending.outcome = outcome;
+  pending.error = getLastModemError();
+
+  atTrace[atTraceIndex] = pending;
+  atTraceIndex = (atTraceIndex + 1) % AT_TRACE_SIZE;
+  if (atTraceCount < AT_TRACE_SIZE) atTraceCount++;
+
+  recordATHistogram(pending.key, total);
+}
+
+/*
+ * Outcome of a response read up to its final line
+ */
+ATTraceOutcome classifyATResponse(const String& response) {
+  if (response.indexOf("ERROR") != -1) return AT_TRACE_ERROR;
+  if (response.indexOf("OK") != -1) return AT_TRACE_OK;
+  return AT_TRACE_TIMEOUT;
+}
+
+/*
+ * Print the trace (oldest first) followed by the histograms
+ */
+void printATTrace() {
+  Serial.printf("\nAT trace (%u transactions, wake %u):\n", atTraceCount, atTraceWake);
+  Serial.println("  wake   start ms  command       first  total   out    in  outcome");
+
+  int first = (atTraceIndex + AT_TRACE_SIZE - atTraceCount) % AT_TRACE_SIZE;
+  for (int i = 0; i < atTraceCount; i++) {
+    const ATTraceRecord& r = atTrace[(first + i) % AT_TRACE_SIZE];
+    char firstByte[8];
+    if (r.firstByteMs == 0xFFFF) {
+      strcpy(firstByte, "-");
+    } else {
+      snprintf(firstByte, sizeof(firstByte), "%u", r.firstByteMs);
+    }
+    Serial.printf("  %4u %10lu  %-12s %6s %6u %5u %5u  %s",
+                  r.wake, r.startMs, r.key, firstByte, r.totalMs,
+                  r.bytesOut, r.bytesIn, outcomeName(r.outcome));
+    if (r.error != MODEM_ERR_NONE) Serial.printf(" (%s)", modemErrorName((ModemError)r.error));
+    Serial.println();
+  }
+
+  printATHistograms();
+}
+
+/*
+ * Format one page of diagnostics as JSON for BLE
+ * Page 0 is the trace, records added newest first until the buffer is full:
+ *   {"page":0,"totalPages":N,"trace":[[wake,start,first,total,out,in,outcome,"cmd"],...]}
+ * Pages 1 and on hold the latency histograms, as many commands as fit:
+ *   {"page":1,"totalPages":N,"bounds":[...],"cmds":{...}}
+ *
+ * @return length written
+ */
+int formatATDiagnostics(char* out, size_t outSize, int page) {
+  size_t histSize = outSize - AT_DIAG_HEADER_LEN;
+
+  // Lay out the histogram pages to count them and find where 'page' starts
+  int pages = 1;
+  int slot = 0;
+  int pageSlot = AT_STATS_SLOTS;
+  do {
+    int start = slot;
+    if (pages == page) pageSlot = slot;
+    formatATHistograms(nullptr, histSize, slot);
+    pages++;
+    if (slot == start) break;
+  } while (slot < AT_STATS_SLOTS);
+
+  int len = snprintf(out, outSize, "{\"page\":%d,\"totalPages\":%d", page, pages);
+  if (page > 0) {
+    if (page < pages) {
+      len += snprintf(out + len, outSize - len, ",");
+      len += formatATHistograms(out + len, histSize, pageSlot);
+    }
+    len += snprintf(out + len, outSize - len, "}");
+    return len;
+  }
+
+  len += snprintf(out + len, outSize - len, ",\"trace\":[");
+
+  for (int i = 0; i < atTraceCount; i++) {
+    const ATTraceRecord& r = atTrace[(atTraceIndex + AT_TRACE_SIZE - 1 - i) % AT_TRACE_SIZE];
+    char entry[80];
+    int n = snprintf(entry, sizeof(entry), "%s[%u,%lu,%d,%u,%u,%u,%u,\"%s\"]",
+                     i ? "," : "", r.wake, r.startMs,
+                     r.firstByteMs == 0xFFFF ? -1 : r.firstByteMs, r.totalMs,
+                     r.bytesOut, r.bytesIn, r.outcome, r.key);
+    if (len + n + 3 > (int)outSize) break;
+    memcpy(out + len, entry, n + 1);
+    len += n;
+  }
+
+  len += snprintf(out + len, outSize - len, "]}");
+  return len;
+}
+
+/*
+ * Forget the trace (histograms are cleared with clearATStats())
+ */
+void clearATTrace() {
+  memset(atTrace, 0, sizeof(atTrace));
+  atTraceIndex = 0;
+  atTraceCount = 0;
+  pendingOpen = false;
+}
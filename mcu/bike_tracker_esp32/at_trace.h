@@ -0,0 +1,53 @@
+/*
+ * at_trace.h
+ *
+ * AT transaction tracing
+ * Every AT transaction (command, start, first-byte and completion
+ * latency, outcome, bytes out and in) is written to a fixed binary
+ * ring in RTC memory, and its completion time to the per-command
+ * histogram in at_stats.h. Shows which waits dominate report time.
+ */
+
+#ifndef AT_TRACE_H
+#define AT_TRACE_H
+
+#include <Arduino.h>
+#include "at_stats.h"
+
+#define AT_TRACE_SIZE  32      // Transactions kept, oldest overwritten
+#define AT_DIAG_HEADER_LEN 40  // Page fields and closing brace of a diagnostics page
+
+enum ATTraceOutcome : uint8_t {
+  AT_TRACE_OK,         // Expected response
+  AT_TRACE_NEGATIVE,   // Final OK without the expected response
+  AT_TRACE_ERROR,      // ERROR / +CME ERROR / +CMS ERROR
+  AT_TRACE_TIMEOUT,    // No final response in time
+  AT_TRACE_ABANDONED,  // Next command started before this one was closed
+  AT_TRACE_OUTCOME_COUNT
+};
+
+struct ATTraceRecord {
+  char key[AT_STATS_KEY_LEN];  // Command up to its first parameter
+  uint32_t startMs;            // millis() at send, in wake number 'wake'
+  uint16_t firstByteMs;        // 0xFFFF = no response byte
+  uint16_t totalMs;
+  uint16_t bytesOut;
+  uint16_t bytesIn;
+  uint8_t wake;
+  uint8_t outcome;             // ATTraceOutcome
+  uint8_t error;               // ModemError at completion
+};
+
+// Transaction hooks - begin after the command is written, end when the
+// final response (or timeout) is seen
+void beginATTrace(const char* cmd, size_t bytesOut);
+void noteATFirstByte();
+void endATTrace(ATTraceOutcome outcome, size_t bytesIn);
+ATTraceOutcome classifyATResponse(const String& response);
+
+// Dump
+void printATTrace();
+int formatATDiagnostics(char* out, size_t outSize, int page);
+void clearATTrace();
+
+#endif // AT_TRACE_H
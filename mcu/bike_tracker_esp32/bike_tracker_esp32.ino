@@ -23,6 +23,23 @@
 #include "sim7070g.h"
 #include "gps_handler.h"
 #include "sms_handler.h"
+#include "sms_outbox.h"
+#include "sms_report.h"
+#include "report_session.h"
+#include "data_uplink.h"
+#include "track_upload.h"
+#include "cell_locator.h"
+#include "signal_quality.h"
+#include "modem_sleep.h"
+#include "network_cache.h"
+#include "modem_recovery.h"
+#include "at_stats.h"
+#include "at_trace.h"
+#include "modem_transcript.h"
+#include "gnss_profile.h"
+#include "gnss_budget.h"
+#include "fix_validator.h"
+#include "track_fusion.h"
 #include "lsm6dsl_handler.h"
 #include <Wire.h>
 #include "SparkFun_VL53L1X.h"
@@ -43,6 +60,10 @@ uint32_t tNext=0;
 // Motion sensor wake threshold constants
 #define WAKE_THRESHOLD_MAX      0.28f  // Maximum wake sensitivity (g)
 #define WAKE_THRESHOLD_RANGE    0.23f  // Sensitivity adjustment range (0.28 - 0.05 = 0.23)
+#define MOTION_CONFIRM_MS       3000   // Motion wake: window to confirm the bike is really moving
+#define MOTION_CONFIRM_POLL_MS  50
+#define MOTION_SUPPRESS_MAX     3      // Unconfirmed motion wakes within the window before alerting anyway
+#define MOTION_SUPPRESS_WIN_S   1800   // ... this window
 
 // Configuration limits
 #define SMS_INTERVAL_MIN_SEC    60     // Minimum SMS interval (1 minute)
@@ -54,18 +75,26 @@ uint32_t tNext=0;
 #define GPS_CHANGE_THRESHOLD    0.0001f  // ~11 meters at equator
 
 // GPS acquisition constants
-#define GPS_ACQUISITION_ATTEMPTS     30    // Standard GPS fix attempts (~1 minute)
 #define CACHED_GPS_LIMIT              3    // Max consecutive cached GPS sends before no-location alert
 
 // GPS status enumeration (return values from acquireGPSWithFallback)
 enum GPSStatus {
   GPS_NONE = 0,      // No valid GPS data available
   GPS_FRESH = 1,     // Fresh GPS fix acquired
-  GPS_CACHED = 2     // Using cached GPS data (< 30 min old)
+  GPS_CACHED = 2,    // Using cached GPS data (< 30 min old)
+  GPS_UNVERIFIED = 3 // Fresh fix that failed the plausibility check (not logged)
+};
+
+// Report session outcome
+enum SessionResult {
+  SESSION_FAILED = 0,  // Not delivered and not queued
+  SESSION_SENT,        // Delivered over the uplink or SMS
+  SESSION_QUEUED,      // This session's report waits in the SMS outbox
+  SESSION_DEFERRED     // Periodic report skipped in poor coverage (fix is in the track log)
 };
 
 // JSON buffer sizes
-#define STATUS_JSON_SIZE        256
+#define STATUS_JSON_SIZE        448
 #define CONFIG_PHONE_MAX_LEN    20
 
 int _distance = 0;
@@ -77,6 +106,7 @@ BLECharacteristic* pConfigChar = nullptr;
 BLECharacteristic* pStatusChar = nullptr;
 BLECharacteristic* pHistoryChar = nullptr;
 BLECharacteristic* pCommandChar = nullptr;
+BLECharacteristic* pDiagChar = nullptr;
 
 volatile bool deviceConnected = false;
 bool oldDeviceConnected = false;
@@ -87,6 +117,10 @@ struct {
   uint16_t updateInterval;
   bool alertEnabled;
   float motionSensitivity;
+  SMSRecipient extraRecipients[MAX_SMS_RECIPIENTS - 1];  // Besides phoneNumber
+  uint8_t extraRecipientCount;
+  char uplinkHost[UPLINK_HOST_MAX_LEN];  // Report server, empty = SMS only
+  uint16_t uplinkPort;
 } config = {"", 600, true, 0.5};
 
 struct {
@@ -108,6 +142,7 @@ struct StatusSnapshot {
   char mode[16];
   float lat;
   float lon;
+  uint8_t signalLevel;
 
   bool hasChanged(const StatusSnapshot& other) const {
     return bleConnected != other.bleConnected ||
@@ -115,17 +150,20 @@ struct StatusSnapshot {
            gpsValid != other.gpsValid ||
            phoneConfigured != other.phoneConfigured ||
            strcmp(mode, other.mode) != 0 ||
+           signalLevel != other.signalLevel ||
            (gpsValid && (fabs(lat - other.lat) > GPS_CHANGE_THRESHOLD ||
                          fabs(lon - other.lon) > GPS_CHANGE_THRESHOLD));
   }
 };
 
-StatusSnapshot lastSentStatus = {false, false, false, false, "", 0, 0};
+StatusSnapshot lastSentStatus = {false, false, false, false, "", 0, 0, SIGNAL_NONE};
 
 unsigned long lastMotionTime = 0;
 unsigned long bootTime = 0;
 bool gracePeriodActive = false;
 bool inSleepMode = false;
+bool keepSleepReference = false;   // Unconfirmed motion wake: compare the next wake to the same resting orientation
+float wakeMotionDelta = 0;         // IMU sample taken first thing on a motion wake
 
 // RTC Memory (preserved across deep sleep)
 RTC_DATA_ATTR bool disconnectSMSSent = false;
@@ -134,6 +172,11 @@ RTC_DATA_ATTR bool isTimerWake = false;
 RTC_DATA_ATTR bool motionWakeNeedsSMS = false;
 RTC_DATA_ATTR bool motionSensorInitialized = false;
 RTC_DATA_ATTR int consecutiveCachedGPS = 0;  // Track consecutive cached GPS sends
+RTC_DATA_ATTR AccelData sleepReference = {0, 0, 1.0, 1.0};  // Resting orientation before motion-wake sleep
+RTC_DATA_ATTR bool sleepReferenceValid = false;
+RTC_DATA_ATTR uint8_t suppressedInWindow = 0;    // Unconfirmed motion wakes in the current window
+RTC_DATA_ATTR uint32_t suppressWindowStartS = 0;
+RTC_DATA_ATTR uint16_t suppressedWakesTotal = 0;
 
 // External RTC variables from gps_handler.cpp
 extern RTC_DATA_ATTR int logIndex;
@@ -144,6 +187,9 @@ void updateStatusCharacteristic();
 void syncGPSHistory();
 void clearConfiguration();
 void parseConfigJSON(const String& json);
+void parseRecipients(const char* start, const char* end);
+SMSRecipientList getSMSRecipients();
+int getExtraSMSRecipients(SMSRecipientList& list);
 void sendGPSHistoryPage(int page);
 void stopBLEAdvertising();
 void startBLEAdvertising();
@@ -151,8 +197,15 @@ void applyMotionSensitivity();
 void readIRSensor();
 float getCurrentMotionThreshold();
 void testGPSAndSMS();
+bool sendUplinkReport(bool userPresent, GPSStatus gpsStatus, const CellLocation& cell);
+SessionResult runReportSession(bool userPresent, bool urgent);
 bool handleDisconnectedSMS();
+bool handleSMSCommand(SMSCommand cmd, long arg, char* reply, size_t replySize);
 void enterSleepMode();
+float sampleWakeMotion();
+bool confirmMotionWake(float wakeDelta);
+bool isStillSince(uint32_t sinceMs);
+void sampleFusionIMU();
 void processSerialCommand(const String& cmd);
 void initBLE();
 void ensureMotionSensorInit();
@@ -193,12 +246,26 @@ class ConfigCallbacks: public BLECharacteristicCallbacks {
     }
 };
 
+// AT trace and latency histograms, formatted on each read
+// Page 0 is the trace, DIAG_PAGE:<n> selects a histogram page
+static int diagPage = 0;
+
+class DiagnosticsCallbacks : public BLECharacteristicCallbacks {
+    void onRead(BLECharacteristic *pChar) override {
+      static char json[BLE_MTU_SIZE];
+      int len = formatATDiagnostics(json, sizeof(json), diagPage);
+      pChar->setValue((uint8_t*)json, len);
+    }
+};
+
 class CommandCallbacks : public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pChar) override {
       String cmd = pChar->getValue().c_str();
       
       if (cmd.startsWith("GPS_PAGE:")) {
         sendGPSHistoryPage(cmd.substring(9).toInt());
+      } else if (cmd.startsWith("DIAG_PAGE:")) {
+        diagPage = cmd.substring(10).toInt();
       } else if (cmd == "SYNC") {
         syncGPSHistory();
       } else if (cmd == "CLEAR_HISTORY") {
@@ -214,6 +281,13 @@ void loadConfiguration() {
   config.updateInterval = preferences.getUShort("interval", 600);
   config.alertEnabled = preferences.getBool("alerts", true);
   config.motionSensitivity = preferences.getFloat("sensitivity", 0.5);
+  config.extraRecipientCount = preferences.getUChar("recipCount", 0);
+  if (config.extraRecipientCount > MAX_SMS_RECIPIENTS - 1 ||
+      preferences.getBytes("recipients", config.extraRecipients, sizeof(config.extraRecipients)) != sizeof(config.extraRecipients)) {
+    config.extraRecipientCount = 0;
+  }
+  preferences.getString("uplinkHost", config.uplinkHost, sizeof(config.uplinkHost));
+  config.uplinkPort = preferences.getUShort("uplinkPort", 0);
   preferences.end();
 }
 
@@ -223,6 +297,10 @@ void saveConfiguration() {
   preferences.putUShort("interval", config.updateInterval);
   preferences.putBool("alerts", config.alertEnabled);
   preferences.putFloat("sensitivity", config.motionSensitivity);
+  preferences.putBytes("recipients", config.extraRecipients, sizeof(config.extraRecipients));
+  preferences.putUChar("recipCount", config.extraRecipientCount);
+  preferences.putString("uplinkHost", config.uplinkHost);
+  preferences.putUShort("uplinkPort", config.uplinkPort);
   preferences.end();
 }
 
@@ -231,6 +309,10 @@ void clearConfiguration() {
   config.updateInterval = 600;
   config.alertEnabled = true;
   config.motionSensitivity = 0.5;
+  memset(config.extraRecipients, 0, sizeof(config.extraRecipients));
+  config.extraRecipientCount = 0;
+  memset(config.uplinkHost, 0, sizeof(config.uplinkHost));
+  config.uplinkPort = 0;
   
   preferences.begin("bike-tracker", false);
   preferences.clear();
@@ -306,12 +388,102 @@ void parseConfigJSON(const String& json) {
     }
   }
 
+  // Parse extra recipients
+  const char* recipKey = isCompact ? "\"r\":\"" : "\"recipients\":\"";
+  const char* recipStart = strstr(jsonStr, recipKey);
+  if (recipStart) {
+    recipStart += strlen(recipKey);
+    const char* recipEnd = strchr(recipStart, '"');
+    if (recipEnd) {
+      parseRecipients(recipStart, recipEnd);
+      changed = true;
+    }
+  }
+
+  // Parse data uplink server ("host:port", empty disables)
+  const char* uplinkKey = isCompact ? "\"u\":\"" : "\"uplink\":\"";
+  const char* uplinkStart = strstr(jsonStr, uplinkKey);
+  if (uplinkStart) {
+    uplinkStart += strlen(uplinkKey);
+    const char* uplinkEnd = strchr(uplinkStart, '"');
+    const char* colon = uplinkStart;
+    while (uplinkEnd && colon < uplinkEnd && *colon != ':') colon++;
+    if (uplinkEnd) {
+      size_t hostLen = min((size_t)(colon - uplinkStart), sizeof(config.uplinkHost) - 1);
+      memcpy(config.uplinkHost, uplinkStart, hostLen);
+      config.uplinkHost[hostLen] = '\0';
+      config.uplinkPort = (colon < uplinkEnd) ? atoi(colon + 1) : 0;
+      changed = true;
+    }
+  }
+
   if (changed) {
     saveConfiguration();
     updateStatusCharacteristic();
   }
 }
 
+/*
+ * Parse extra recipients from "number:alertMask,number:alertMask"
+ * Mask is a bit per AlertType (ALERT_MASK), all alerts if omitted.
+ * An empty list removes all extra recipients.
+ */
+void parseRecipients(const char* start, const char* end) {
+  memset(config.extraRecipients, 0, sizeof(config.extraRecipients));
+  config.extraRecipientCount = 0;
+
+  const char* p = start;
+  while (p < end && config.extraRecipientCount < MAX_SMS_RECIPIENTS - 1) {
+    const char* sep = p;
+    while (sep < end && *sep != ',') sep++;
+    const char* colon = p;
+    while (colon < sep && *colon != ':') colon++;
+
+    size_t numLen = min((size_t)(colon - p), (size_t)RECIPIENT_NUMBER_MAX_LEN - 1);
+    if (numLen > 0) {
+      SMSRecipient& r = config.extraRecipients[config.extraRecipientCount++];
+      memcpy(r.number, p, numLen);
+      r.number[numLen] = '\0';
+      r.alertMask = (colon < sep) ? atoi(colon + 1) : ALERT_MASK_ALL;
+    }
+    p = sep + 1;
+  }
+}
+
+/*
+ * Build recipient list for reports
+ * Primary number gets every alert and is the only one allowed to send commands
+ */
+SMSRecipientList getSMSRecipients() {
+  SMSRecipientList list = {};
+  strncpy(list.entries[0].number, config.phoneNumber, RECIPIENT_NUMBER_MAX_LEN - 1);
+  list.entries[0].alertMask = ALERT_MASK_ALL;
+  list.count = 1;
+
+  for (int i = 0; i < config.extraRecipientCount; i++) {
+    list.entries[list.count++] = config.extraRecipients[i];
+  }
+  return list;
+}
+
+/*
+ * Build recipient list for reports the data uplink already delivered
+ * The server only reaches the primary number, which stays in the list for
+ * command authentication but is not sent the report again.
+ *
+ * @return number of extra recipients subscribed to reports
+ */
+int getExtraSMSRecipients(SMSRecipientList& list) {
+  list = getSMSRecipients();
+  list.entries[0].alertMask = 0;
+
+  int count = 0;
+  for (int i = 1; i < list.count; i++) {
+    if (list.entries[i].alertMask & ALERT_MASK(ALERT_BLE_DISCONNECT)) count++;
+  }
+  return count;
+}
+
 // Sensor Functions
 inline void readIRSensor() {
   static bool lastUserPresent = false;
@@ -343,6 +515,7 @@ void updateStatusCharacteristic() {
   current.mode[sizeof(current.mode) - 1] = '\0';
   current.lat = currentGPS.valid ? atof(currentGPS.latitude.c_str()) : 0;
   current.lon = currentGPS.valid ? atof(currentGPS.longitude.c_str()) : 0;
+  current.signalLevel = getSignalLevel();
 
   // Only send if changed (reduces BLE traffic ~80%)
   if (!current.hasChanged(lastSentStatus)) {
@@ -350,11 +523,14 @@ void updateStatusCharacteristic() {
     return;
   }
 
+  char signal[128];
+  formatSignalStats(signal, sizeof(signal));
+
   char json[STATUS_JSON_SIZE];
   snprintf(json, sizeof(json),
     "{\"ble\":%s,\"phone_configured\":%s,\"phone\":\"%s\",\"interval\":%d,"
     "\"alerts\":%s,\"user_present\":%s,\"mode\":\"%s\","
-    "\"gps_valid\":%s,\"lat\":\"%s\",\"lon\":\"%s\"}",
+    "\"gps_valid\":%s,\"lat\":\"%s\",\"lon\":\"%s\",\"recipients\":%d,\"signal\":%s}",
     status.bleConnected ? "true" : "false",
     current.phoneConfigured ? "true" : "false",
     config.phoneNumber,
@@ -364,7 +540,9 @@ void updateStatusCharacteristic() {
     status.deviceMode.c_str(),
     currentGPS.valid ? "true" : "false",
     currentGPS.valid ? currentGPS.latitude.c_str() : "",
-    currentGPS.valid ? currentGPS.longitude.c_str() : "");
+    currentGPS.valid ? currentGPS.longitude.c_str() : "",
+    current.phoneConfigured ? 1 + config.extraRecipientCount : 0,
+    signal);
 
   pStatusChar->setValue(json);
   if (deviceConnected) pStatusChar->notify();
@@ -413,10 +591,14 @@ void sendGPSHistoryPage(int page) {
  * Cached data is only used if less than 30 minutes old (GPS_CACHE_TIMEOUT).
  *
  * @param gpsData      Reference to GPSData structure to populate
- * @param maxAttempts  Maximum number of GPS fix attempts (typically GPS_ACQUISITION_ATTEMPTS=30)
- * @return GPS_FRESH   Fresh GPS fix successfully acquired
- *         GPS_CACHED  Using valid cached GPS data (< 30 min old)
- *         GPS_NONE    No valid GPS data available
+ * @param maxAttempts  Maximum number of GPS fix attempts (typically from predictGNSSAttempts())
+ * A fresh fix that the plausibility check rejected is still this session's
+ * position: it is reported as unverified rather than replaced by an older one.
+ *
+ * @return GPS_FRESH      Fresh GPS fix successfully acquired
+ *         GPS_UNVERIFIED Fresh fix that failed the plausibility check
+ *         GPS_CACHED     Using valid cached GPS data (< 30 min old)
+ *         GPS_NONE       No valid GPS data available
  */
 GPSStatus acquireGPSWithFallback(GPSData& gpsData, uint32_t maxAttempts) {
   unsigned long currentTime = millis();
@@ -434,6 +616,11 @@ GPSStatus acquireGPSWithFallback(GPSData& gpsData, uint32_t maxAttempts) {
     return GPS_FRESH;
   }
 
+  if (getRejectedFix(gpsData)) {
+    Serial.println("⚠️ Fresh fix failed the plausibility check - reporting it as unverified");
+    return GPS_UNVERIFIED;
+  }
+
   // GPS acquisition failed - try to load cached data
   Serial.println("⚠️ GPS acquisition failed, checking cached data...");
   if (loadGPSData(gpsData) && gpsData.valid) {
@@ -456,30 +643,44 @@ GPSStatus acquireGPSWithFallback(GPSData& gpsData, uint32_t maxAttempts) {
  *
  * Intelligently handles GPS status and sends appropriate SMS:
  * - GPS_FRESH: Sends location SMS, resets cached counter
+ * - GPS_UNVERIFIED: Sends location SMS, the counter is left alone
  * - GPS_CACHED: Sends location SMS up to CACHED_GPS_LIMIT times, then switches to no-location alert
  * - GPS_NONE: Sends no-location alert with last known location if available
  *
+ * When GPS failed, a cell tower position (LBS) is sent instead of cached or
+ * missing data, and the no-location alert carries the serving cell ID if known.
+ *
  * This function manages the consecutiveCachedGPS counter to prevent sending stale
  * location data indefinitely when GPS module is not functioning.
  *
- * @param phoneNumber    Phone number to send SMS to
+ * Reports that fail to send are kept in the SMS outbox and retried in the
+ * next RF session, compare getSMSQueuedTotal() before and after the call to
+ * tell "queued" from "lost".
+ *
+ * @param recipients     Report recipients (sent in one RF session)
  * @param userPresent    Whether IR sensor detects user presence
  * @param updateInterval SMS update interval in seconds
  * @param gpsData        GPS data (fresh, cached, or invalid)
- * @param gpsStatus      GPS acquisition status (GPS_FRESH, GPS_CACHED, or GPS_NONE)
+ * @param gpsStatus      GPS acquisition status (GPS_FRESH, GPS_UNVERIFIED, GPS_CACHED, or GPS_NONE)
+ * @param cell           Cell tower fallback from this RF session
  * @return true if SMS sent successfully, false otherwise
  */
 bool sendSMSWithGPSFallback(
-  const char* phoneNumber,
+  const SMSRecipientList& recipients,
   bool userPresent,
   uint16_t updateInterval,
   GPSData& gpsData,
-  GPSStatus gpsStatus
+  GPSStatus gpsStatus,
+  const CellLocation& cell
 ) {
   bool smsSent = false;
 
-  // Check if we've sent cached GPS too many times
-  if (gpsStatus == GPS_CACHED) {
+  if ((gpsStatus == GPS_CACHED || gpsStatus == GPS_NONE) && cell.resolved) {
+    // Current cell tower position beats a stale or missing fix
+    Serial.println("📶 GPS unavailable - sending cell tower location");
+    smsSent = sendCellLocationSMS(recipients, cell, userPresent, updateInterval);
+  } else if (gpsStatus == GPS_CACHED) {
+    // Check if we've sent cached GPS too many times
     consecutiveCachedGPS++;
     Serial.printf("⚠️ Using cached GPS (%d/%d consecutive)\n",
                   consecutiveCachedGPS, CACHED_GPS_LIMIT);
@@ -488,26 +689,188 @@ bool sendSMSWithGPSFallback(
       // Too many cached sends - send no-location alert instead
       Serial.println("❌ Cached GPS limit reached - sending no-location alert");
       GPSData cachedGPS = gpsData;  // Keep last cached for reference
-      smsSent = sendNoLocationSMS(phoneNumber, userPresent, true, cachedGPS, updateInterval);
+      smsSent = cell.hasCell ? sendCellLocationSMS(recipients, cell, userPresent, updateInterval)
+                             : sendNoLocationSMS(recipients, userPresent, true, cachedGPS, updateInterval);
     } else {
       // Still within limit - send cached location
-      smsSent = sendDisconnectSMS(phoneNumber, gpsData, userPresent, updateInterval);
+      smsSent = sendDisconnectSMS(recipients, gpsData, userPresent, updateInterval);
     }
   } else if (gpsStatus == GPS_FRESH) {
     // Fresh GPS acquired - reset counter and send location
     consecutiveCachedGPS = 0;
     Serial.println("✅ Fresh GPS acquired - counter reset");
-    smsSent = sendDisconnectSMS(phoneNumber, gpsData, userPresent, updateInterval);
+    smsSent = sendDisconnectSMS(recipients, gpsData, userPresent, updateInterval);
+  } else if (gpsStatus == GPS_UNVERIFIED) {
+    // A fresh position beats an older one even if it disagrees with the track
+    Serial.println("⚠️ Sending unverified fresh GPS");
+    smsSent = sendDisconnectSMS(recipients, gpsData, userPresent, updateInterval);
   } else {
-    // No GPS at all - send no-location alert
+    // No GPS at all - send no-location alert (serving cell ID if known)
     GPSData cachedGPS;
     bool hasCached = loadGPSData(cachedGPS) && cachedGPS.valid;
-    smsSent = sendNoLocationSMS(phoneNumber, userPresent, hasCached, cachedGPS, updateInterval);
+    smsSent = cell.hasCell ? sendCellLocationSMS(recipients, cell, userPresent, updateInterval)
+                           : sendNoLocationSMS(recipients, userPresent, hasCached, cachedGPS, updateInterval);
   }
 
   return smsSent;
 }
 
+/*
+ * Send report over the data uplink when a server is configured
+ *
+ * Used before SMS in the RF phase. On success the buffered track is
+ * uploaded while the bearer is up, extra recipients get the same report
+ * through the SMS outbox flush, and inbound commands still run, as the
+ * SMS senders would have done.
+ *
+ * @param userPresent Whether IR sensor detects user presence
+ * @param gpsStatus   GPS acquisition status for this session
+ * @param cell        Cell tower fallback from this RF session
+ * @return true if the server acknowledged the report
+ */
+bool sendUplinkReport(bool userPresent, GPSStatus gpsStatus, const CellLocation& cell) {
+  if (strlen(config.uplinkHost) == 0 || config.uplinkPort == 0) return false;
+  if (!setModemState(MODEM_RF)) return false;
+
+  GPSData lastKnown;
+  ReportInfo report = {REPORT_STATUS, ALERT_BLE_DISCONNECT, &currentGPS, userPresent, config.updateInterval};
+  if (gpsStatus == GPS_NONE) {
+    report.type = REPORT_NO_FIX;
+    report.gps = (loadGPSData(lastKnown) && lastKnown.valid) ? &lastKnown : nullptr;
+  }
+  if (gpsStatus != GPS_FRESH && cell.hasCell) {
+    report.cell = &cell;  // Serving cell travels with the report either way
+    if (cell.resolved && gpsStatus != GPS_UNVERIFIED) {
+      report.type = REPORT_CELL;
+      report.gps = &cell.position;
+    }
+  }
+  report.unverified = (gpsStatus == GPS_UNVERIFIED && report.type == REPORT_STATUS);
+
+  // Track filter estimate beside the raw fix (position, heading, uncertainty)
+  FusedState fused;
+  getFusedState(fused);
+  if (fused.valid) report.fused = &fused;
+
+  bool fresh = gpsStatus == GPS_FRESH || report.unverified;
+  if (!sendDataReport(config.uplinkHost, config.uplinkPort, report, fresh)) {
+    Serial.println("📱 Data uplink failed - falling back to SMS");
+    return false;
+  }
+
+  // Server sees the cached flag, so only SMS needs the cached counter
+  if (gpsStatus == GPS_FRESH) consecutiveCachedGPS = 0;
+
+  // The server only reaches the primary number
+  SMSRecipientList extras;
+  if (getExtraSMSRecipients(extras) > 0) {
+    static char message[REPORT_MAX_LEN + 1];
+    encodeReport(report, message, sizeof(message));
+    queueReportSMS(extras, message);
+  }
+
+  uploadTrackHistory(config.uplinkHost, config.uplinkPort);
+  flushSMSOutbox();
+  checkInboundSMS(config.phoneNumber);
+  return true;
+}
+
+/*
+ * Run one planned report session
+ *
+ * The planner orders the wake's work so the modem goes OFF -> GNSS -> RF -> OFF
+ * once: GPS fix first, then sends, outbox retries and inbound commands in a
+ * single RF phase. The report goes over the data uplink when one is
+ * configured, SMS is the fallback; extra recipients get it by SMS either
+ * way. Predicted and measured durations are logged.
+ * When the GNSS budget predicts a slow or failing fix (and no warm-up is
+ * already running), the cell tower position is looked up first and the
+ * GNSS budget is capped, so the report does not wait for GNSS to give up.
+ * Coverage is sampled at the start of the RF phase: a non-urgent report is
+ * deferred to the next wake in poor coverage, urgent ones get longer timeouts.
+ * The GNSS profile follows the situation: alert, periodic report or live
+ * tracking (short interval).
+ *
+ * @param userPresent Whether IR sensor detects user presence
+ * @param urgent      Alert (disconnect after motion) rather than a periodic update
+ * @return whether this session's report was sent, queued or deferred
+ */
+SessionResult runReportSession(bool userPresent, bool urgent) {
+  SessionWork work = {};
+  work.needFix = true;
+  work.messages = 1 + getSMSOutboxCount();
+  work.timeSync = (currentGPS.timestamp == 0);
+  work.inboundCheck = true;
+
+  // A GNSS warm-up already running is never interrupted for the cell lookup
+  uint32_t gnssAttempts = predictGNSSAttempts();
+  work.cellFirst = isGNSSFixDoubtful() && getModemState() != MODEM_GNSS;
+
+  SessionPlan plan = planReportSession(work);
+  beginReportSession(plan);
+
+  GPSStatus gpsStatus = GPS_NONE;
+  bool reported = false;
+  bool deferred = false;
+  uint32_t queuedBefore = getSMSQueuedTotal();
+  setTransmissionUrgency(urgent);
+  selectGNSSProfile(urgent ? GNSS_PROFILE_URGENT :
+                    config.updateInterval <= GNSS_LIVE_INTERVAL_S ? GNSS_PROFILE_LIVE :
+                    GNSS_PROFILE_PERIODIC);
+
+  CellLocation cell = CellLocation();
+
+  for (int i = 0; i < plan.phaseCount; i++) {
+    enterSessionPhase(plan.phases[i]);
+
+    if (plan.phases[i] == MODEM_RF && i + 1 < plan.phaseCount && plan.phases[i + 1] == MODEM_GNSS) {
+      // Cell-first: coarse position in hand before the GNSS search
+      if (setModemState(MODEM_RF) && locateByCell(cell)) {
+        gnssAttempts = capGNSSAttempts(gnssAttempts);
+      }
+    } else if (plan.phases[i] == MODEM_GNSS) {
+      // Try to acquire GPS with fallback
+      gpsStatus = acquireGPSWithFallback(currentGPS, gnssAttempts);
+    } else if (plan.phases[i] == MODEM_RF) {
+      // Bad coverage burns long timeouts - skip periodic reports, the fix is in the track log
+      if (setModemState(MODEM_RF)) {
+        sampleSignalQuality();
+        configureModemSleep(config.updateInterval);  // Stay attached between reports if the network allows
+      }
+      // Outbox retries and inbound commands still use the RF session
+      // Alerts are never deferred (urgency is set above)
+      if (shouldDeferTransmission()) {
+        flushSMSOutbox();
+        checkInboundSMS(config.phoneNumber);
+        deferred = true;
+        continue;
+      }
+
+      // GPS failed - cell towers give a coarse position within seconds
+      if (gpsStatus != GPS_FRESH && !cell.hasCell && setModemState(MODEM_RF)) {
+        locateByCell(cell);
+      }
+
+      // Data uplink first, SMS with GPS fallback logic if it fails
+      reported = sendUplinkReport(userPresent, gpsStatus, cell) || sendSMSWithGPSFallback(
+        getSMSRecipients(),
+        userPresent,
+        config.updateInterval,
+        currentGPS,
+        gpsStatus,
+        cell
+      );
+    }
+  }
+
+  endReportSession();
+
+  // Only this session's report counts - older queued entries say nothing about it
+  if (reported) return SESSION_SENT;
+  if (getSMSQueuedTotal() != queuedBefore) return SESSION_QUEUED;
+  return deferred ? SESSION_DEFERRED : SESSION_FAILED;
+}
+
 bool handleDisconnectedSMS() {
   if (strlen(config.phoneNumber) == 0 || !config.alertEnabled) return false;
 
@@ -522,19 +885,9 @@ bool handleDisconnectedSMS() {
     // Update user presence before sending SMS
     readIRSensor();
 
-    // Try to acquire GPS with fallback
-    GPSStatus gpsStatus = acquireGPSWithFallback(currentGPS, GPS_ACQUISITION_ATTEMPTS);
-
-    // Send SMS with GPS fallback logic
-    bool smsSent = sendSMSWithGPSFallback(
-      config.phoneNumber,
-      status.userPresent,
-      config.updateInterval,
-      currentGPS,
-      gpsStatus
-    );
-
-    if (smsSent) {
+    // A queued report goes out with the next RF session - don't re-acquire GPS now
+    SessionResult result = runReportSession(status.userPresent, true);
+    if (result == SESSION_SENT || result == SESSION_QUEUED) {
       disconnectSMSSent = true;
       lastDisconnectSMS = currentTime;
       motionWakeNeedsSMS = false;
@@ -556,28 +909,77 @@ bool handleDisconnectedSMS() {
     // Update user presence before sending SMS
     readIRSensor();
 
-    // Try to acquire GPS with fallback
-    GPSStatus gpsStatus = acquireGPSWithFallback(currentGPS, GPS_ACQUISITION_ATTEMPTS);
-
-    // Send SMS with GPS fallback logic
-    bool smsSent = sendSMSWithGPSFallback(
-      config.phoneNumber,
-      status.userPresent,
-      config.updateInterval,
-      currentGPS,
-      gpsStatus
-    );
-
-    if (smsSent) {
+    // A deferred periodic report waits for the next interval, but never
+    // counts as the first alert
+    SessionResult result = runReportSession(status.userPresent, !disconnectSMSSent);
+    if (result == SESSION_SENT || result == SESSION_QUEUED) {
       disconnectSMSSent = true;
       lastDisconnectSMS = currentTime;
       return true;
     }
+    if (result == SESSION_DEFERRED && disconnectSMSSent) {
+      lastDisconnectSMS = currentTime;
+      return true;
+    }
   }
 
   return false;
 }
 
+/*
+ * Handle authenticated command received by SMS
+ *
+ * Runs inside an RF session, so replies go out without another wake.
+ * There is no SMS arm/disarm: alerts off also stops the RF sessions that
+ * receive commands, so alerts are switched from the app only.
+ */
+bool handleSMSCommand(SMSCommand cmd, long arg, char* reply, size_t replySize) {
+  switch (cmd) {
+    case SMS_CMD_LOCATE: {
+      // Fix from this or an earlier session - say how old it is
+      char age[24] = "";
+      if (currentGPS.valid) {
+        uint32_t ageS = getGNSSFixAgeS();
+        if (ageS == UINT32_MAX) {
+          snprintf(age, sizeof(age), "\nFix age: unknown");
+        } else {
+          snprintf(age, sizeof(age), "\nFix age: %lu min", ageS / 60);
+        }
+      }
+
+      ReportInfo report = {currentGPS.valid ? REPORT_STATUS : REPORT_NO_FIX, ALERT_LOCATION_UPDATE,
+                           currentGPS.valid ? &currentGPS : nullptr,
+                           status.userPresent, config.updateInterval};
+      int len = encodeReport(report, reply, replySize - strlen(age));
+      snprintf(reply + len, replySize - len, "%s", age);
+      return true;
+    }
+
+    case SMS_CMD_STATUS:
+      snprintf(reply, replySize, "Status: %s\nAlerts:%s Int:%us\nGPS:%s Outbox:%d",
+               status.deviceMode.c_str(),
+               config.alertEnabled ? "On" : "Off",
+               config.updateInterval,
+               currentGPS.valid ? "OK" : "None",
+               getSMSOutboxCount());
+      return true;
+
+    case SMS_CMD_SET_INTERVAL:
+      if (arg < SMS_INTERVAL_MIN_SEC || arg > SMS_INTERVAL_MAX_SEC) {
+        snprintf(reply, replySize, "Interval must be %d-%d sec", SMS_INTERVAL_MIN_SEC, SMS_INTERVAL_MAX_SEC);
+        return true;
+      }
+      config.updateInterval = arg;
+      saveConfiguration();
+      updateStatusCharacteristic();
+      snprintf(reply, replySize, "Interval set to %us", config.updateInterval);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
 // BLE Functions
 void initBLE() {
   char deviceName[32];
@@ -611,6 +1013,10 @@ void initBLE() {
                     BLECharacteristic::PROPERTY_WRITE);
   pCommandChar->setCallbacks(new CommandCallbacks());
   
+  pDiagChar = pService->createCharacteristic(DIAG_CHAR_UUID,
+                    BLECharacteristic::PROPERTY_READ);
+  pDiagChar->setCallbacks(new DiagnosticsCallbacks());
+  
   String initialHistory = getGPSHistoryJSON(MAX_GPS_HISTORY_POINTS);
   if (initialHistory.length() > BLE_MTU_SIZE) initialHistory = getGPSHistoryJSON(5);
   pHistoryChar->setValue(initialHistory.c_str());
@@ -647,6 +1053,14 @@ void enterSleepMode() {
       tof.stopRanging();
       delay(50);
 
+      // Resting orientation the next motion wake is compared against. Kept over
+      // unconfirmed wakes, so a bike moved in small steps still adds up
+      if (!keepSleepReference || !sleepReferenceValid) {
+        motionSensor.resetMotionReference();
+        sleepReference = motionSensor.getReference();
+        sleepReferenceValid = true;
+      }
+
       // Calculate sensitive threshold for wake interrupts (0.05g to 0.28g range)
       float wakeThreshold = WAKE_THRESHOLD_MAX - (config.motionSensitivity * WAKE_THRESHOLD_RANGE);
       motionSensor.configureWakeOnMotion(wakeThreshold);
@@ -667,6 +1081,7 @@ void enterSleepMode() {
       delay(100);
 
       motionWakeNeedsSMS = true;
+      flushModemTranscript();
       esp_deep_sleep_start();
       // Device resets on wake - execution continues in setup()
     }
@@ -688,6 +1103,10 @@ void enterSleepMode() {
     // Ensure minimum sleep time of 1 second
     if (timeUntilNextSMS < 1000) timeUntilNextSMS = intervalMillis;
 
+    // Wake early by the modem boot time if it was switched fully off
+    uint32_t modemLead = getModemWakeLeadMs();
+    if (timeUntilNextSMS > modemLead + 1000) timeUntilNextSMS -= modemLead;
+
     // Stop ToF to release I2C bus before sleep
     tof.stopRanging();
     delay(50);
@@ -704,6 +1123,7 @@ void enterSleepMode() {
     Serial.flush();
 
     esp_sleep_enable_timer_wakeup(timeUntilNextSMS * 1000ULL);
+    flushModemTranscript();
     esp_deep_sleep_start();
   }
 }
@@ -727,10 +1147,12 @@ void processSerialCommand(const String& cmd) {
         saveGPSData(currentGPS);
         logGPSPoint(currentGPS, 1);
       }
+      setModemState(MODEM_OFF);
     }},
     {"sms", []() {
       if (strlen(config.phoneNumber) > 0) {
         sendTestSMS(config.phoneNumber);
+        setModemState(MODEM_OFF);
       }
     }},
     {"status", []() {
@@ -740,6 +1162,17 @@ void processSerialCommand(const String& cmd) {
         deviceConnected ? "Connected" : "Disconnected",
         strlen(config.phoneNumber) > 0 ? config.phoneNumber : "(not set)",
         config.updateInterval);
+      Serial.printf("  Motion wakes suppressed: %u (%u in the current window)\n",
+        suppressedWakesTotal, suppressedInWindow);
+      printModemSession();
+      if (strlen(config.uplinkHost) > 0) {
+        Serial.printf("  Uplink: %s:%u (%d track points pending)\n",
+          config.uplinkHost, config.uplinkPort, getPendingTrackPoints());
+      }
+      for (int i = 0; i < config.extraRecipientCount; i++) {
+        Serial.printf("  Recipient %d: %s (alerts 0x%02X)\n", i + 2,
+          config.extraRecipients[i].number, config.extraRecipients[i].alertMask);
+      }
     }},
     {"history", []() {
       Serial.printf("\nGPS History: %d points\n", getGPSHistoryCount());
@@ -747,11 +1180,28 @@ void processSerialCommand(const String& cmd) {
         Serial.println(getGPSHistoryJSON(5));
       }
     }},
+    {"outbox", []() {
+      Serial.printf("\nSMS Outbox: %d pending\n", getSMSOutboxCount());
+    }},
+    {"clearoutbox", []() { clearSMSOutbox(); }},
+    {"session", []() { printSessionEstimates(); }},
+    {"signal", []() { printSignalHistory(); }},
+    {"modemsleep", []() { printModemSleepStats(config.updateInterval); }},
+    {"network", []() { printNetworkCache(); }},
+    {"clearnetwork", []() { clearNetworkCache(); }},
+    {"recovery", []() { printModemRecovery(); }},
+    {"atstats", []() { printATStats(); }},
+    {"attrace", []() { printATTrace(); }},
+    {"gnss", []() { printGNSSProfiles(); printGNSSBudget(); printFixValidation(); }},
+    {"fusion", []() { printTrackFusion(); }},
+    {"transcript", []() { printModemTranscript(); }},
+    {"dumptranscript", []() { dumpModemTranscript(); }},
+    {"cleartranscript", []() { clearModemTranscript(); }},
     {"clear", []() { clearGPSHistory(); }},
     {"clearconfig", []() { clearConfiguration(); }},
     {"sync", []() { if (deviceConnected) syncGPSHistory(); }},
     {"help", []() {
-      Serial.println("\nCommands: test, gps, sms, status, history, clear, clearconfig, sync, help");
+      Serial.println("\nCommands: test, gps, sms, status, history, outbox, clearoutbox, session, signal, modemsleep, network, clearnetwork, recovery, atstats, attrace, gnss, fusion, transcript, dumptranscript, cleartranscript, clear, clearconfig, sync, help");
     }}
   };
   
@@ -772,12 +1222,13 @@ void testGPSAndSMS() {
     saveGPSData(currentGPS);
     status.lastGPSTime = millis();
     logGPSPoint(currentGPS, 1);
-    sendLocationSMS(config.phoneNumber, currentGPS, ALERT_TEST);
+    sendLocationSMS(getSMSRecipients(), currentGPS, ALERT_TEST);
   } else if (loadGPSData(currentGPS)) {
-    sendLocationSMS(config.phoneNumber, currentGPS, ALERT_TEST);
+    sendLocationSMS(getSMSRecipients(), currentGPS, ALERT_TEST);
   } else {
     sendTestSMS(config.phoneNumber);
   }
+  setModemState(MODEM_OFF);
 }
 
 // Setup
@@ -795,17 +1246,23 @@ void setup() {
   
   esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
   Serial.println("\nMCU STARTUP");
+  setModemIdleHandler(sampleFusionIMU);
   
   switch(wakeup_reason) {
     case ESP_SLEEP_WAKEUP_GPIO:
       Serial.println("Wake: MOTION (GPIO)");
       lastMotionTime = millis();
+      fuseWatchedSleep();  // The IMU watched this sleep - the bike stood still until now
       if (disconnectSMSSent) lastDisconnectSMS = 0;
-      // Initialize SIM7070G for GPS acquisition after motion wake
+      // Sample the IMU before any modem work, the jolt that woke us may be short.
+      // Then start GNSS right away - the receiver searches while the rest of
+      // boot and the theft decision run, and the alert's fix comes sooner
       if (motionWakeNeedsSMS) {
-        Serial.println("📡 Motion wake - initializing SIM7070G for GPS acquisition");
-        if (!initializeSIM7070G()) {
-          Serial.println("❌ SIM7070G init failed on motion wake");
+        wakeMotionDelta = sampleWakeMotion();
+        Serial.println("📡 Motion wake - starting GNSS warm-up");
+        selectGNSSProfile(GNSS_PROFILE_URGENT);
+        if (!initializeSIM7070G() || !setModemState(MODEM_GNSS)) {
+          Serial.println("❌ GNSS warm-up failed on motion wake");
         }
       }
       break;
@@ -821,40 +1278,45 @@ void setup() {
       isTimerWake = false;
       motionWakeNeedsSMS = false;
       motionSensorInitialized = false;
+      sleepReferenceValid = false;
+      suppressedInWindow = 0;
       consecutiveCachedGPS = 0;  // Reset cached GPS counter on boot
   }
 
   loadConfiguration();
+  setSMSCommandHandler(handleSMSCommand);
+  setStillnessSource(isStillSince);
   bool hasValidConfig = (strlen(config.phoneNumber) > 0 && config.alertEnabled);
   
   if (isTimerWake && hasValidConfig) {
     stopBLEAdvertising();
     Serial.println("📍 Timer wake - acquiring GPS for periodic update");
 
+    // IMU on for the session, the track filter is fed while the modem works
+    motionSensorInitialized = motionSensor.isInitialized() || motionSensor.begin();
+
     // Initialize SIM7070G for GPS acquisition
     if (!initializeSIM7070G()) {
       Serial.println("❌ SIM7070G init failed on timer wake");
     }
 
-    // Try to acquire GPS with fallback
-    GPSStatus gpsStatus = acquireGPSWithFallback(currentGPS, GPS_ACQUISITION_ATTEMPTS);
-
-    // Send SMS with GPS fallback logic (userPresent=false for timer wake)
-    sendSMSWithGPSFallback(
-      config.phoneNumber,
-      false,  // userPresent = false (no IR check during timer wake)
-      config.updateInterval,
-      currentGPS,
-      gpsStatus
-    );
+    // GPS fix and SMS in one planned session (userPresent=false for timer wake)
+    runReportSession(false, false);
 
     isTimerWake = false;
 
     // Allow time for NVS writes to complete
     delay(100);
 
+    // Wake early by the modem boot time if it was switched fully off
+    uint64_t sleepMs = config.updateInterval * 1000ULL;
+    uint32_t modemLead = getModemWakeLeadMs();
+    if (sleepMs > modemLead + 1000) sleepMs -= modemLead;
+
     esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
-    esp_sleep_enable_timer_wakeup(config.updateInterval * 1000000ULL);
+    if (motionSensorInitialized) motionSensor.setPowerDownMode();
+    esp_sleep_enable_timer_wakeup(sleepMs * 1000ULL);
+    flushModemTranscript();
     esp_deep_sleep_start();
   }
   
@@ -866,14 +1328,24 @@ void setup() {
   initGPSHistory();
   loadGPSData(currentGPS);
   
-  if (motionSensor.begin()) {
+  // Already started on a motion wake, a second begin() would reset the reference
+  if (motionSensor.isInitialized() || motionSensor.begin()) {
     motionSensorInitialized = true;
     applyMotionSensitivity();
     lastMotionTime = millis();
   }
+
+  // A bump or gust is not a theft - stop the GNSS warm-up and sleep again
+  if (wakeup_reason == ESP_SLEEP_WAKEUP_GPIO && motionWakeNeedsSMS &&
+      motionSensor.isInitialized() && !confirmMotionWake(wakeMotionDelta)) {
+    Serial.println("💤 Motion not confirmed - false alarm, GNSS off");
+    setModemState(MODEM_OFF);
+    keepSleepReference = true;
+    enterSleepMode();
+  }
   
   if (hasValidConfig && wakeup_reason == ESP_SLEEP_WAKEUP_UNDEFINED) {
-    if (initializeSIM7070G()) disableRF();
+    if (initializeSIM7070G()) setModemState(MODEM_OFF);
     if (!deviceConnected) {
       bootTime = millis();
       gracePeriodActive = true;
@@ -881,6 +1353,102 @@ void setup() {
   }
 }
 
+/*
+ * First IMU sample of a motion wake, against the orientation stored
+ * before sleep
+ *
+ * @return acceleration change in g, 0 if the IMU is not available
+ */
+float sampleWakeMotion() {
+  if (!motionSensor.begin()) return 0;
+  motionSensorInitialized = true;
+  if (sleepReferenceValid) motionSensor.setReference(sleepReference);
+
+  float delta = motionSensor.getMotionDelta();
+  Serial.printf("🚲 Wake motion %.2fg from the resting orientation\n", delta);
+  return delta;
+}
+
+/*
+ * Classify a motion wake while GNSS warms up
+ *
+ * The wake interrupt fires on a single jolt. The bike counts as moving if
+ * the first sample on wake or any sample within MOTION_CONFIRM_MS differs
+ * from the resting orientation stored before sleep by more than the wake
+ * threshold (tilt, lifting, pushing, carrying). A bike rolled away smoothly
+ * may still look at rest, so after MOTION_SUPPRESS_MAX unconfirmed wakes
+ * within MOTION_SUPPRESS_WIN_S the alert goes out anyway.
+ *
+ * @param wakeDelta Sample from sampleWakeMotion()
+ * @return true for real movement, false for a false alarm
+ */
+bool confirmMotionWake(float wakeDelta) {
+  float threshold = WAKE_THRESHOLD_MAX - (config.motionSensitivity * WAKE_THRESHOLD_RANGE);
+  if (wakeDelta > threshold) {
+    Serial.printf("🚲 Motion confirmed (%.2fg on wake)\n", wakeDelta);
+    suppressedInWindow = 0;
+    return true;
+  }
+
+  uint32_t start = millis();
+  while (millis() - start < MOTION_CONFIRM_MS) {
+    float delta = motionSensor.getMotionDelta();
+    if (delta > threshold) {
+      Serial.printf("🚲 Motion confirmed (%.2fg after %lu ms)\n", delta, millis() - start);
+      suppressedInWindow = 0;
+      return true;
+    }
+    delay(MOTION_CONFIRM_POLL_MS);
+  }
+
+  // Repeated wakes that never confirm - something keeps moving the bike
+  uint32_t now = getGNSSClockS();
+  if (suppressedInWindow == 0 || now - suppressWindowStartS > MOTION_SUPPRESS_WIN_S) {
+    suppressWindowStartS = now;
+    suppressedInWindow = 0;
+  }
+  if (suppressedInWindow + 1 >= MOTION_SUPPRESS_MAX) {
+    Serial.printf("⚠️ %d unconfirmed motion wakes within %d min - alerting anyway\n",
+                  MOTION_SUPPRESS_MAX, MOTION_SUPPRESS_WIN_S / 60);
+    suppressedInWindow = 0;
+    return true;
+  }
+
+  suppressedInWindow++;
+  if (suppressedWakesTotal < UINT16_MAX) suppressedWakesTotal++;
+  return false;
+}
+
+/*
+ * IMU motion into the track filter, every FUSION_IMU_PERIOD_MS
+ * Runs from loop() and, as the modem idle handler, through the waits of
+ * GNSS acquisition and report sessions, so the filter dead-reckons in
+ * the timer and motion wake paths too
+ */
+void sampleFusionIMU() {
+  static uint32_t lastSampleMs = 0;
+  if (!motionSensor.isInitialized() || millis() - lastSampleMs < FUSION_IMU_PERIOD_MS) return;
+  lastSampleMs = millis();
+
+  motionSensor.getMotionDelta();  // Reads a new sample
+  float deviation = fabs(motionSensor.getAcceleration().magnitude - 1.0f);
+  fuseIMUMotion((uint32_t)(deviation * 1000));
+}
+
+/*
+ * IMU stillness for the fix validator
+ *
+ * Only claimed while the loop polls the IMU (awake, disconnected, alert
+ * not yet sent) - anything else counts as possibly moved.
+ *
+ * @param sinceMs millis() of the last trusted fix
+ */
+bool isStillSince(uint32_t sinceMs) {
+  if (!motionSensorInitialized || deviceConnected || disconnectSMSSent) return false;
+  if (motionSensor.detectMotion()) return false;
+  return motionSensor.getTimeSinceLastMotion() > millis() - sinceMs;
+}
+
 // Helper function to ensure motion sensor is initialized
 void ensureMotionSensorInit() {
   if (motionSensorInitialized) return;
@@ -964,6 +1532,8 @@ void loop()
     lastIRCheck = currentTime;
     readIRSensor();
   }
+
+  sampleFusionIMU();
   
   if (deviceConnected && (currentTime - lastStatusUpdate > STATUS_UPDATE_INTERVAL)) {
     lastStatusUpdate = currentTime;
@@ -7,6 +7,7 @@
 #define STATUS_CHAR_UUID "00001237-0000-1000-8000-00805f9b34fb"
 #define COMMAND_CHAR_UUID "00001238-0000-1000-8000-00805f9b34fb"
 #define HISTORY_CHAR_UUID "00001239-0000-1000-8000-00805f9b34fb"
+#define DIAG_CHAR_UUID "0000123a-0000-1000-8000-00805f9b34fb"
 
 #define DEVICE_NAME_PREFIX "BikeTrk_"
 
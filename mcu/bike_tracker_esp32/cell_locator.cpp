@@ -0,0 +1,182 @@
+/*
+ * cell_locator.cpp
+ *
+ * Implementation of the cell-tower location fallback
+ *
+ * The serving cell comes from AT+CPSI?, neighbours from AT+CENG?. The
+ * position comes from AT+CLBS over the data bearer. If LBS is not
+ * available, the raw cell identity is still reported so it can be
+ * resolved later. Accuracy is stored as HDOP = accuracy / GPS_UERE_METERS,
+ * so the report encoder rounds coordinates to match.
+ */
+
+#include "cell_locator.h"
+#include "sim7070g.h"
+#include "data_uplink.h"
+#include "sms_report.h"
+#include "at_trace.h"
+
+/*
+ * Split comma separated fields in place
+ *
+ * @return number of fields
+ */
+static int splitFields(char* text, char** fields, int maxFields) {
+  int count = 0;
+  char* p = text;
+  while (count < maxFields) {
+    fields[count++] = p;
+    char* comma = strchr(p, ',');
+    if (!comma) break;
+    *comma = '\0';
+    p = comma + 1;
+  }
+  return count;
+}
+
+/*
+ * Copy the first "<tag>..." line of a response into out
+ */
+static bool extractLine(const String& response, const char* tag, char* out, size_t outSize) {
+  int start = response.indexOf(tag);
+  if (start == -1) return false;
+  start += strlen(tag);
+
+  int end = response.indexOf('\r', start);
+  if (end == -1) end = response.length();
+
+  String line = response.substring(start, end);
+  strncpy(out, line.c_str(), outSize - 1);
+  out[outSize - 1] = '\0';
+  return true;
+}
+
+/*
+ * Read serving cell identity
+ * "+CPSI: LTE CAT-M1,Online,515-02,0x5A1E,187214780,..."
+ */
+bool readServingCell(CellLocation& loc) {
+  clearSerialBuffer();
+  simSerial.println("AT+CPSI?");
+  beginATTrace("AT+CPSI?", sizeof("AT+CPSI?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  char line[128];
+  if (!extractLine(response, "+CPSI: ", line, sizeof(line))) return false;
+
+  char* fields[6];
+  int count = splitFields(line, fields, 6);
+  if (count < 5 || strcmp(fields[1], "Online") != 0) {
+    Serial.println("⚠️ No serving cell");
+    return false;
+  }
+
+  char* dash = strchr(fields[2], '-');
+  if (!dash) return false;
+
+  loc.mcc = atoi(fields[2]);
+  loc.mnc = atoi(dash + 1);
+  loc.tac = strtoul(fields[3], nullptr, 16);
+  loc.cellId = strtoul(fields[4], nullptr, 10);
+  loc.hasCell = true;
+
+  Serial.printf("📶 Serving cell %s: %u-%02u TAC 0x%04X CID %lu\n",
+                fields[0], loc.mcc, loc.mnc, loc.tac, loc.cellId);
+  return true;
+}
+
+/*
+ * Count neighbour cells reported by the engineering mode
+ */
+int readNeighborCells() {
+  sendATCommand("AT+CENG=1,1", "OK");
+
+  clearSerialBuffer();
+  simSerial.println("AT+CENG?");
+  beginATTrace("AT+CENG?", sizeof("AT+CENG?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  // Header "+CENG: <mode>,<ncell>,<cells>,..." then one "+CENG: <i>,..." line per cell
+  int lines = 0;
+  for (int i = response.indexOf("+CENG: "); i != -1; i = response.indexOf("+CENG: ", i + 1)) {
+    lines++;
+  }
+
+  sendATCommand("AT+CENG=0", "OK");
+  return max(lines - 2, 0);  // Minus header and serving cell
+}
+
+/*
+ * Resolve position through the module's LBS service
+ * "+CLBS: 0,<longitude>,<latitude>,<accuracy>"
+ */
+static bool resolveLBS(CellLocation& loc) {
+  if (!activateDataBearer()) return false;
+
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+CLBS=1,%d", UPLINK_PDP_CONTEXT);
+  clearSerialBuffer();
+  simSerial.println(cmd);
+  beginATTrace(cmd, strlen(cmd) + 2);
+
+  // Result line can follow the OK
+  String response = "";
+  uint32_t start = millis();
+  while (millis() - start < CELL_LBS_TIMEOUT_MS) {
+    response += readResponse(1000);
+    if (response.indexOf("ERROR") != -1) return false;
+    int tag = response.indexOf("+CLBS: ");
+    if (tag != -1 && response.indexOf('\r', tag) != -1) break;
+  }
+
+  char line[80];
+  if (!extractLine(response, "+CLBS: ", line, sizeof(line))) return false;
+
+  char* fields[4];
+  if (splitFields(line, fields, 4) < 4 || atoi(fields[0]) != 0) {
+    Serial.printf("⚠️ LBS lookup failed (code %s)\n", line);
+    return false;
+  }
+
+  loc.position.longitude = fields[1];
+  loc.position.latitude = fields[2];
+  loc.position.longitude.trim();
+  loc.position.latitude.trim();
+  loc.accuracyM = atoi(fields[3]);
+  loc.position.hdop = max(loc.accuracyM / GPS_UERE_METERS, 1.0f);
+  loc.position.accuracy = loc.accuracyM;
+  loc.position.speed = "";
+  loc.position.timestamp = 0;
+  loc.position.valid = true;
+  loc.resolved = true;
+
+  Serial.printf("📶 Cell location: %s, %s (±%u m)\n",
+                loc.position.latitude.c_str(), loc.position.longitude.c_str(), loc.accuracyM);
+  return true;
+}
+
+/*
+ * Locate the device from cell towers
+ *
+ * @return true if a position was resolved; loc.hasCell tells whether at
+ *         least the raw serving cell identity is known
+ */
+bool locateByCell(CellLocation& loc) {
+  uint32_t start = millis();
+  loc = CellLocation();
+
+  if (!readServingCell(loc)) return false;
+  loc.neighbors = readNeighborCells();
+  resolveLBS(loc);
+
+  Serial.printf("📶 Cell fallback: %s, %u neighbours, %lu ms\n",
+                loc.resolved ? "resolved" : "cell ID only", loc.neighbors, millis() - start);
+  return loc.resolved;
+}
+
+/*
+ * Format serving cell as "MCC-MNC-TAC-CID" (TAC and CID in hex)
+ */
+void formatCellId(const CellLocation& loc, char* out, size_t outSize) {
+  snprintf(out, outSize, "%u-%02u-%X-%lX", loc.mcc, loc.mnc, loc.tac, (unsigned long)loc.cellId);
+}
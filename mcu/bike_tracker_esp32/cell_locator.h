@@ -0,0 +1,37 @@
+/*
+ * cell_locator.h
+ *
+ * Cell-tower location fallback for when GNSS fails
+ * Reads serving and neighbour cells during the RF session and resolves
+ * a coarse position with the module's LBS service (AT+CLBS).
+ */
+
+#ifndef CELL_LOCATOR_H
+#define CELL_LOCATOR_H
+
+#include <Arduino.h>
+#include "gps_handler.h"
+
+#define CELL_LBS_TIMEOUT_MS   20000
+#define CELL_ID_MAX_LEN       24    // "MCC-MNC-TAC-CID" text, e.g. "515-02-5A1E-B28A6BC"
+
+// Coarse location from the cellular network
+struct CellLocation {
+  bool hasCell;           // Serving cell identified
+  uint16_t mcc;
+  uint16_t mnc;
+  uint16_t tac;           // Tracking (LTE) or location (GSM) area code
+  uint32_t cellId;
+  uint8_t neighbors;      // Neighbour cells seen
+  bool resolved;          // LBS returned a position
+  GPSData position;       // Resolved position (HDOP encodes accuracy)
+  uint16_t accuracyM;
+};
+
+// Cell location functions (call with RF enabled)
+bool readServingCell(CellLocation& loc);
+int readNeighborCells();
+bool locateByCell(CellLocation& loc);
+void formatCellId(const CellLocation& loc, char* out, size_t outSize);
+
+#endif // CELL_LOCATOR_H
@@ -0,0 +1,319 @@
+/*
+ * data_uplink.cpp
+ *
+ * Implementation of the binary report uplink
+ *
+ * Report layout (UPLINK_REPORT_LEN bytes, little endian):
+ *   0  magic (UPLINK_MAGIC)      1  version       2  message ('R')
+ *   3  device id (uint32, low 32 bits of the eFuse MAC)
+ *   7  sequence (uint16)         9  ReportType   10  AlertType
+ *  11  flags (UPLINK_FLAG_*)    12  HDOP x10 (0 = unknown)
+ *  13  latitude x1e6 (int32)    17  longitude x1e6 (int32)
+ *  21  speed x10 km/h (uint16)  23  update interval s (uint16)
+ *  25  fix time (uint32, Unix seconds)
+ * With UPLINK_FLAG_CELL_ID a serving cell trailer follows:
+ *  29  MCC (uint16)  31  MNC (uint16)  33  TAC (uint16)
+ *  35  cell ID (uint32)             39  neighbour cells (uint8)
+ * With UPLINK_FLAG_FUSED the track filter estimate follows (offsets
+ * from the end of the previous part):
+ *   0  latitude x1e6 (int32)     4  longitude x1e6 (int32)
+ *   8  heading x100 deg (uint16, 0xFFFF = unknown)
+ *  10  uncertainty m (uint16, 1 sigma)
+ *
+ * Every message starts with the same UPLINK_HEADER_LEN bytes. The server
+ * answers with magic, 'A', sequence, optionally followed by a
+ * message-specific payload. The PDP context stays active until RF is
+ * disabled (CFUN=0 drops it).
+ */
+
+#include "data_uplink.h"
+#include "sim7070g.h"
+#include "signal_quality.h"
+#include "at_trace.h"
+
+// Report sequence number - survives deep sleep
+RTC_DATA_ATTR uint16_t uplinkSequence = 0;
+
+#define UPLINK_PROMPT_TIMEOUT_MS  2000
+#define UPLINK_POLL_INTERVAL_MS   250
+
+/*
+ * Allocate the next message sequence number
+ */
+uint16_t nextUplinkSequence() {
+  return ++uplinkSequence;
+}
+
+/*
+ * Write the common message header
+ *
+ * @return header length (UPLINK_HEADER_LEN)
+ */
+int writeUplinkHeader(uint8_t* out, uint8_t message, uint16_t seq) {
+  out[0] = UPLINK_MAGIC;
+  out[1] = UPLINK_VERSION;
+  out[2] = message;
+  putUplinkU32(out + 3, (uint32_t)ESP.getEfuseMac());
+  putUplinkU16(out + 7, seq);
+  return UPLINK_HEADER_LEN;
+}
+
+/*
+ * Encode report into the binary wire format
+ *
+ * @return encoded length, 0 if out is too small
+ */
+int encodeUplinkReport(const ReportInfo& info, bool freshFix, uint16_t seq, uint8_t* out, size_t outSize) {
+  if (outSize < UPLINK_REPORT_MAX_LEN) return 0;
+  memset(out, 0, UPLINK_REPORT_MAX_LEN);
+
+  writeUplinkHeader(out, UPLINK_MSG_REPORT, seq);
+  out[9] = info.type;
+  out[10] = info.alert;
+
+  uint8_t flags = info.userPresent ? UPLINK_FLAG_USER : 0;
+  bool hasLocation = info.gps && info.gps->valid &&
+                     info.gps->latitude.length() > 0 && info.gps->longitude.length() > 0;
+
+  if (hasLocation) {
+    flags |= UPLINK_FLAG_LOCATION;
+    if (freshFix) flags |= UPLINK_FLAG_FRESH;
+    if (info.unverified) flags |= UPLINK_FLAG_UNVERIFIED;
+    if (info.type == REPORT_CELL && info.cell) {
+      flags |= UPLINK_FLAG_CELL;
+      out[12] = (uint8_t)min((info.cell->accuracyM + UPLINK_CELL_ACCURACY_STEP - 1) / UPLINK_CELL_ACCURACY_STEP, 255);
+    } else {
+      out[12] = (uint8_t)min(info.gps->hdop * 10.0f + 0.5f, 255.0f);
+    }
+    putUplinkU32(out + 13, (uint32_t)(int32_t)lround(strtod(info.gps->latitude.c_str(), nullptr) * 1e6));
+    putUplinkU32(out + 17, (uint32_t)(int32_t)lround(strtod(info.gps->longitude.c_str(), nullptr) * 1e6));
+    putUplinkU16(out + 21, (uint16_t)min(info.gps->speed.toFloat() * 10.0f + 0.5f, 65535.0f));
+    putUplinkU32(out + 25, (uint32_t)(info.gps->timestamp / 1000));
+  }
+
+  putUplinkU16(out + 23, info.updateInterval);
+  int len = UPLINK_REPORT_LEN;
+
+  if (info.cell && info.cell->hasCell) {
+    flags |= UPLINK_FLAG_CELL_ID;
+    putUplinkU16(out + 29, info.cell->mcc);
+    putUplinkU16(out + 31, info.cell->mnc);
+    putUplinkU16(out + 33, info.cell->tac);
+    putUplinkU32(out + 35, info.cell->cellId);
+    out[39] = info.cell->neighbors;
+    len += UPLINK_CELL_TRAILER_LEN;
+  }
+
+  if (info.fused && info.fused->valid) {
+    flags |= UPLINK_FLAG_FUSED;
+    putUplinkU32(out + len, (uint32_t)info.fused->latE6);
+    putUplinkU32(out + len + 4, (uint32_t)info.fused->lonE6);
+    putUplinkU16(out + len + 8, info.fused->headingCdeg < 0 ? 0xFFFF : (uint16_t)info.fused->headingCdeg);
+    putUplinkU16(out + len + 10, (uint16_t)min((info.fused->uncertaintyMm + 999) / 1000, (uint32_t)65535));
+    len += UPLINK_FUSED_TRAILER_LEN;
+  }
+
+  out[11] = flags;
+  return len;
+}
+
+/*
+ * Activate the PDP context if it is not active yet
+ */
+bool activateDataBearer() {
+  char cmd[48];
+  char active[24];
+  snprintf(active, sizeof(active), "+CNACT: %d,1", UPLINK_PDP_CONTEXT);
+
+  if (sendATCommand("AT+CNACT?", active, 1000)) return true;
+
+  if (strlen(UPLINK_APN) > 0) {
+    snprintf(cmd, sizeof(cmd), "AT+CNCFG=%d,1,\"%s\"", UPLINK_PDP_CONTEXT, UPLINK_APN);
+    sendATCommand(cmd, "OK");
+  }
+
+  Serial.println("🌐 Activating data bearer...");
+  snprintf(cmd, sizeof(cmd), "AT+CNACT=%d,1", UPLINK_PDP_CONTEXT);
+  if (!sendATCommand(cmd, "OK", 5000)) return false;
+
+  // Wait until the network assigns an address
+  uint32_t start = millis();
+  while (millis() - start < UPLINK_ATTACH_TIMEOUT_MS) {
+    if (sendATCommand("AT+CNACT?", active, 1000)) return true;
+    waitModem(500);
+  }
+  return false;
+}
+
+/*
+ * Write one datagram to the open socket
+ */
+static bool sendPacket(const uint8_t* data, int len) {
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+CASEND=%d,%d", UPLINK_SOCKET_ID, len);
+  clearSerialBuffer();
+  simSerial.println(cmd);
+  beginATTrace(cmd, strlen(cmd) + 2 + len);
+
+  // Wait for prompt
+  uint32_t start = millis();
+  bool promptReceived = false;
+  while (millis() - start < UPLINK_PROMPT_TIMEOUT_MS) {
+    if (simSerial.available()) {
+      noteATFirstByte();
+      if (readModemByte() == '>') {
+        promptReceived = true;
+        break;
+      }
+    }
+    delay(5);
+  }
+
+  if (!promptReceived) {
+    Serial.println("❌ No data prompt");
+    endATTrace(AT_TRACE_TIMEOUT, 0);
+    return false;
+  }
+
+  simSerial.write(data, len);
+  return readResponse(DEFAULT_TIMEOUT).indexOf("OK") != -1;
+}
+
+/*
+ * Read pending datagram bytes from the socket
+ *
+ * @return number of bytes read, 0 if nothing is pending, -1 on error
+ */
+static int receivePacket(uint8_t* buf, int size) {
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+CARECV=%d,%d", UPLINK_SOCKET_ID, size);
+  clearSerialBuffer();
+  simSerial.println(cmd);
+  beginATTrace(cmd, strlen(cmd) + 2);
+
+  // Header "+CARECV: <len>," followed by raw bytes, or "+CARECV: 0"
+  String header = "";
+  int expected = -1;
+  uint32_t start = millis();
+  while (expected < 0 && millis() - start < DEFAULT_TIMEOUT) {
+    if (!simSerial.available()) {
+      delay(5);
+      continue;
+    }
+    char c = readModemByte();  // A +CMTI before the header is still noticed
+    header += c;
+    noteATFirstByte();
+
+    int tag = header.indexOf("+CARECV: ");
+    if (tag != -1 && (c == ',' || c == '\r')) {
+      expected = header.substring(tag + 9).toInt();
+    } else if (header.indexOf("ERROR") != -1) {
+      endATTrace(AT_TRACE_ERROR, header.length());
+      return -1;
+    }
+  }
+
+  if (expected <= 0) {
+    endATTrace(expected < 0 ? AT_TRACE_TIMEOUT : AT_TRACE_OK, header.length());
+    return expected < 0 ? -1 : 0;
+  }
+
+  int received = 0;
+  start = millis();
+  while (received < expected && millis() - start < DEFAULT_TIMEOUT) {
+    if (simSerial.available()) {
+      uint8_t b = readModemByte();
+      if (received < size) buf[received] = b;
+      received++;
+    } else {
+      delay(1);
+    }
+  }
+  readResponse(500);  // Trailing OK
+
+  return min(received, size);
+}
+
+/*
+ * Wait for the server to acknowledge a sequence number
+ * The full ack (header and payload) is copied to ack
+ */
+static bool waitForAck(uint16_t seq, uint8_t* ack, int ackSize) {
+  uint32_t start = millis();
+
+  while (millis() - start < getSignalTimeout(UPLINK_ACK_TIMEOUT_MS)) {
+    int len = receivePacket(ack, ackSize);
+    if (len < 0) return false;
+
+    if (len >= UPLINK_ACK_LEN && ack[0] == UPLINK_MAGIC && ack[1] == UPLINK_MSG_ACK &&
+        (ack[2] | (ack[3] << 8)) == seq) {
+      return true;
+    }
+    waitModem(UPLINK_POLL_INTERVAL_MS);
+  }
+  return false;
+}
+
+/*
+ * Send one message over the data bearer and wait for its ack
+ *
+ * @param host     Server name or IP address
+ * @param port     Server UDP port
+ * @param data     Encoded message (starting with writeUplinkHeader)
+ * @param len      Message length
+ * @param seq      Sequence number written in the header
+ * @param ack      Receives the server's ack (at least UPLINK_ACK_LEN bytes)
+ * @param ackSize  Size of ack buffer
+ * @return true if the server acknowledged the message
+ */
+bool sendDataMessage(const char* host, uint16_t port, const uint8_t* data, int len,
+                     uint16_t seq, uint8_t* ack, int ackSize) {
+  if (host == nullptr || host[0] == '\0' || port == 0) return false;
+
+  if (!activateDataBearer()) {
+    Serial.println("❌ Data bearer not available");
+    return false;
+  }
+
+  char cmd[UPLINK_HOST_MAX_LEN + 40];
+  char opened[24];
+  snprintf(cmd, sizeof(cmd), "AT+CAOPEN=%d,%d,\"UDP\",\"%s\",%u",
+           UPLINK_SOCKET_ID, UPLINK_PDP_CONTEXT, host, port);
+  snprintf(opened, sizeof(opened), "+CAOPEN: %d,0", UPLINK_SOCKET_ID);
+
+  if (!sendATCommand(cmd, opened, 10000)) {
+    Serial.println("❌ Failed to open uplink socket");
+    return false;
+  }
+
+  bool acked = sendPacket(data, len) && waitForAck(seq, ack, ackSize);
+
+  snprintf(cmd, sizeof(cmd), "AT+CACLOSE=%d", UPLINK_SOCKET_ID);
+  sendATCommand(cmd, "OK");
+  return acked;
+}
+
+/*
+ * Send a report over the data bearer and wait for the server's ack
+ *
+ * @param host      Server name or IP address
+ * @param port      Server UDP port
+ * @param info      Report contents
+ * @param freshFix  Location was acquired in this session
+ * @return true if the server acknowledged the report
+ */
+bool sendDataReport(const char* host, uint16_t port, const ReportInfo& info, bool freshFix) {
+  uint32_t start = millis();
+  uint16_t seq = nextUplinkSequence();
+  uint8_t packet[UPLINK_REPORT_MAX_LEN];
+  uint8_t ack[UPLINK_ACK_LEN];
+  int len = encodeUplinkReport(info, freshFix, seq, packet, sizeof(packet));
+
+  bool acked = sendDataMessage(host, port, packet, len, seq, ack, sizeof(ack));
+  if (acked) {
+    Serial.printf("📊 Data report #%u: %d bytes, acked in %lu ms\n", seq, len, millis() - start);
+  } else {
+    Serial.printf("❌ Data report #%u not acknowledged\n", seq);
+  }
+  return acked;
+}
@@ -0,0 +1,70 @@
+/*
+ * data_uplink.h
+ *
+ * LTE-M/NB-IoT data uplink for reports
+ * Sends a compact binary report over UDP using the SIM7070G's internal
+ * IP stack (AT+CNACT / AT+CAOPEN). One report is a few dozen bytes
+ * instead of one or two SMS segments; callers fall back to SMS when
+ * the data path fails.
+ */
+
+#ifndef DATA_UPLINK_H
+#define DATA_UPLINK_H
+
+#include <Arduino.h>
+#include "sms_report.h"
+
+// Uplink configuration
+#define UPLINK_APN               ""     // Empty = APN provided by the network
+#define UPLINK_PDP_CONTEXT       0
+#define UPLINK_SOCKET_ID         0
+#define UPLINK_HOST_MAX_LEN      40
+#define UPLINK_ACK_TIMEOUT_MS    5000
+#define UPLINK_ATTACH_TIMEOUT_MS 10000
+
+// Wire format (little endian)
+#define UPLINK_MAGIC             0xB7
+#define UPLINK_VERSION           1
+#define UPLINK_MSG_REPORT        'R'
+#define UPLINK_MSG_ACK           'A'
+#define UPLINK_HEADER_LEN        9    // magic, version, message, device id, seq
+#define UPLINK_REPORT_LEN        29
+#define UPLINK_CELL_TRAILER_LEN  11   // Serving cell identity after the report
+#define UPLINK_FUSED_TRAILER_LEN 12   // Track filter estimate after the report (and cell trailer)
+#define UPLINK_REPORT_MAX_LEN    (UPLINK_REPORT_LEN + UPLINK_CELL_TRAILER_LEN + UPLINK_FUSED_TRAILER_LEN)
+#define UPLINK_ACK_LEN           4    // magic, 'A', seq (uint16) [, payload]
+#define UPLINK_MAX_MESSAGE_LEN   1024
+
+// Report flags
+#define UPLINK_FLAG_LOCATION     0x01  // Coordinates are valid
+#define UPLINK_FLAG_FRESH        0x02  // Fix from this session (else cached)
+#define UPLINK_FLAG_USER         0x04  // User present
+#define UPLINK_FLAG_CELL         0x08  // Position from cell towers, HDOP byte = accuracy / 50 m
+#define UPLINK_FLAG_CELL_ID      0x10  // Serving cell trailer present
+#define UPLINK_FLAG_UNVERIFIED   0x20  // Fresh fix that failed the plausibility check
+#define UPLINK_FLAG_FUSED        0x40  // Track filter trailer present
+#define UPLINK_CELL_ACCURACY_STEP 50
+
+// Little-endian field writers for uplink messages
+inline void putUplinkU16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+inline void putUplinkU32(uint8_t* p, uint32_t v) {
+  putUplinkU16(p, v & 0xFFFF);
+  putUplinkU16(p + 2, v >> 16);
+}
+
+// Message framing
+uint16_t nextUplinkSequence();
+int writeUplinkHeader(uint8_t* out, uint8_t message, uint16_t seq);
+int encodeUplinkReport(const ReportInfo& info, bool freshFix, uint16_t seq, uint8_t* out, size_t outSize);
+
+// Uplink functions (call with RF enabled)
+bool activateDataBearer();
+bool sendDataMessage(const char* host, uint16_t port, const uint8_t* data, int len,
+                     uint16_t seq, uint8_t* ack, int ackSize);
+bool sendDataReport(const char* host, uint16_t port, const ReportInfo& info, bool freshFix);
+
+#endif // DATA_UPLINK_H
@@ -0,0 +1,198 @@
+/*
+ * fix_validator.cpp
+ *
+ * Implementation of the GNSS fix plausibility check
+ *
+ * Positions are microdegrees, distances centimetres, speeds cm/s. The
+ * distance test compares squares, so no square root is needed. Both
+ * fixes' accuracy is added to every distance limit, so a coarse fix is
+ * not rejected for its own noise.
+ */
+
+#include "fix_validator.h"
+
+struct FixAnchor {
+  int32_t latE6;
+  int32_t lonE6;
+  int32_t speedCms;
+  uint32_t accuracyCm;
+  uint64_t timestamp;   // GNSS time, ms
+  bool valid;
+};
+
+// Anchor and counters (survive deep sleep)
+RTC_DATA_ATTR FixAnchor anchor = {};
+RTC_DATA_ATTR uint32_t fixesChecked = 0;
+RTC_DATA_ATTR uint32_t fixesRejected[FIX_VERDICT_COUNT] = {};
+RTC_DATA_ATTR uint32_t anchorsReset = 0;
+RTC_DATA_ATTR uint8_t rejectStreak = 0;
+
+static StillnessSource stillnessSource = nullptr;
+static uint32_t anchorMillis = 0;   // millis() of the anchor, 0 = taken before this boot
+
+static const char* verdictNames[FIX_VERDICT_COUNT] = { "trusted", "speed", "accel", "still" };
+
+// cos(latitude) in Q15, 5 degree steps from 0 to 90
+static const uint16_t cosTable[19] = {
+  32768, 32643, 32270, 31651, 30792, 29697, 28378, 26842, 25102, 23170,
+  21063, 18795, 16384, 13848, 11207, 8481, 5690, 2856, 0
+};
+
+#define CM_PER_UDEG_NUM  11132   // 1e-6 degree of latitude = 11.132 cm
+#define CM_PER_UDEG_DEN  1000
+#define LIMIT_CM_MAX     ((int64_t)1000000000)
+
+/*
+ * Parse a decimal string to an integer scaled by 10^decimals
+ * ("14.5995", 6 -> 14599500), extra digits are truncated
+ */
+int32_t parseScaled(const char* text, uint8_t decimals) {
+  while (*text == ' ') text++;
+  bool negative = (*text == '-');
+  if (*text == '-' || *text == '+') text++;
+
+  int32_t value = 0;
+  int8_t fraction = -1;   // Digits after the point, -1 = before the point
+  for (; *text; text++) {
+    if (*text == '.' && fraction < 0) {
+      fraction = 0;
+    } else if (*text >= '0' && *text <= '9') {
+      if (fraction >= decimals) break;
+      value = value * 10 + (*text - '0');
+      if (fraction >= 0) fraction++;
+    } else {
+      break;
+    }
+  }
+  for (int8_t i = max(fraction, (int8_t)0); i < decimals; i++) value *= 10;
+  return negative ? -value : value;
+}
+
+/*
+ * cos(angle in microdegrees) in Q15, linear between table entries
+ */
+int32_t cosQ15(int32_t angleE6) {
+  int32_t a = angleE6 % 360000000;
+  if (a < 0) a += 360000000;
+  if (a > 180000000) a = 360000000 - a;
+  bool negative = a > 90000000;
+  if (negative) a = 180000000 - a;
+
+  uint32_t index = a / 5000000;
+  int32_t value = cosTable[18];
+  if (index < 18) {
+    uint32_t frac = a % 5000000;
+    value = cosTable[index] - (int32_t)(((uint64_t)(cosTable[index] - cosTable[index + 1]) * frac) / 5000000);
+  }
+  return negative ? -value : value;
+}
+
+/*
+ * East/north offset between two positions (equirectangular, fine over
+ * the distances between consecutive fixes)
+ */
+void localOffsetCm(int32_t fromLatE6, int32_t fromLonE6, int32_t toLatE6, int32_t toLonE6,
+                   int32_t& eastCm, int32_t& northCm) {
+  int64_t dLon = (int64_t)toLonE6 - fromLonE6;
+  if (dLon > 180000000) dLon -= 360000000;
+  if (dLon < -180000000) dLon += 360000000;
+  int64_t dLat = (int64_t)toLatE6 - fromLatE6;
+
+  int64_t north = dLat * CM_PER_UDEG_NUM / CM_PER_UDEG_DEN;
+  int64_t east = dLon * CM_PER_UDEG_NUM / CM_PER_UDEG_DEN * cosQ15((fromLatE6 + toLatE6) / 2) >> 15;
+  northCm = (int32_t)constrain(north, -LIMIT_CM_MAX, LIMIT_CM_MAX);
+  eastCm = (int32_t)constrain(east, -LIMIT_CM_MAX, LIMIT_CM_MAX);
+}
+
+void setStillnessSource(StillnessSource source) {
+  stillnessSource = source;
+}
+
+/*
+ * Speed string (km/h) to cm/s
+ */
+static int32_t speedCms(const GPSData& fix) {
+  return parseScaled(fix.speed.c_str(), 2) * 10 / 36;   // 0.01 km/h = 10/36 cm/s
+}
+
+static void setAnchor(const GPSData& fix, int32_t latE6, int32_t lonE6, uint32_t accuracyCm) {
+  anchor.latE6 = latE6;
+  anchor.lonE6 = lonE6;
+  anchor.speedCms = speedCms(fix);
+  anchor.accuracyCm = accuracyCm;
+  anchor.timestamp = fix.timestamp;
+  anchor.valid = true;
+  anchorMillis = millis();
+  if (anchorMillis == 0) anchorMillis = 1;
+  rejectStreak = 0;
+}
+
+/*
+ * Check a fix against the last trusted one
+ *
+ * @return FIX_TRUSTED (fix is the new anchor) or the rejection reason
+ */
+FixVerdict validateFix(const GPSData& fix) {
+  int32_t latE6 = parseScaled(fix.latitude.c_str(), 6);
+  int32_t lonE6 = parseScaled(fix.longitude.c_str(), 6);
+  uint32_t accuracyCm = fix.accuracyCm;
+  fixesChecked++;
+
+  if (!anchor.valid || fix.timestamp < anchor.timestamp) {
+    setAnchor(fix, latE6, lonE6, accuracyCm);
+    return FIX_TRUSTED;
+  }
+
+  int64_t gapMs = (int64_t)(fix.timestamp - anchor.timestamp);
+  int64_t dtMs = max(gapMs, (int64_t)FIX_MIN_INTERVAL_MS);
+  int32_t eastCm, northCm;
+  localOffsetCm(anchor.latE6, anchor.lonE6, latE6, lonE6, eastCm, northCm);
+  int64_t distSq = (int64_t)eastCm * eastCm + (int64_t)northCm * northCm;
+  int64_t allowance = (int64_t)accuracyCm + anchor.accuracyCm;
+
+  FixVerdict verdict = FIX_TRUSTED;
+  int64_t reach = min(FIX_MAX_SPEED_CMS * dtMs / 1000 + allowance, LIMIT_CM_MAX);
+  int32_t dv = abs(speedCms(fix) - anchor.speedCms);
+  bool recentAnchor = gapMs <= FIX_ACCEL_MAX_AGE_MS;   // Over hours (earlier wake) any speed change is possible
+
+  if (distSq > reach * reach) {
+    verdict = FIX_REJECT_SPEED;
+  } else if (recentAnchor && (int64_t)dv * 1000 > FIX_MAX_ACCEL_CMS2 * dtMs) {
+    verdict = FIX_REJECT_ACCEL;
+  } else if (anchorMillis != 0 && stillnessSource && stillnessSource(anchorMillis)) {
+    int64_t drift = allowance + FIX_STILL_MARGIN_CM;
+    if (distSq > drift * drift) verdict = FIX_REJECT_STILL;
+  }
+
+  if (verdict == FIX_TRUSTED) {
+    setAnchor(fix, latE6, lonE6, accuracyCm);
+    return FIX_TRUSTED;
+  }
+
+  fixesRejected[verdict]++;
+  if (++rejectStreak >= FIX_REANCHOR_AFTER) {
+    // Consistent disagreement - the anchor itself was the outlier (or the bike was moved unseen)
+    Serial.printf("⚠️ %u fixes disagree with the anchor - re-anchoring\n", rejectStreak);
+    anchorsReset++;
+    setAnchor(fix, latE6, lonE6, accuracyCm);
+    return FIX_TRUSTED;
+  }
+
+  int32_t ae = abs(eastCm), an = abs(northCm);
+  Serial.printf("🚫 Fix rejected (%s): ~%ld m in %lu s\n", verdictNames[verdict],
+                (long)((max(ae, an) + min(ae, an) / 2) / 100), (uint32_t)(dtMs / 1000));
+  return verdict;
+}
+
+/*
+ * Print validation counters
+ */
+void printFixValidation() {
+  Serial.printf("\nFix validation: %lu checked, rejected speed %lu / accel %lu / still %lu, %lu re-anchored\n",
+                fixesChecked, fixesRejected[FIX_REJECT_SPEED], fixesRejected[FIX_REJECT_ACCEL],
+                fixesRejected[FIX_REJECT_STILL], anchorsReset);
+  if (anchor.valid) {
+    Serial.printf("  Anchor %.6f,%.6f ±%lu m\n",
+                  anchor.latE6 / 1e6, anchor.lonE6 / 1e6, anchor.accuracyCm / 100);
+  }
+}
@@ -0,0 +1,47 @@
+/*
+ * fix_validator.h
+ *
+ * Plausibility check for GNSS fixes
+ * A new fix is compared with the last trusted one: implied speed,
+ * change of reported speed and displacement while the IMU saw the bike
+ * standing still. Rejected fixes are counted per reason and never reach
+ * the track log. Integer math only (the ESP32-C3 has no FPU).
+ */
+
+#ifndef FIX_VALIDATOR_H
+#define FIX_VALIDATOR_H
+
+#include <Arduino.h>
+#include "gps_handler.h"
+
+// Limits (a stolen bike may travel in a vehicle, so road speeds are allowed)
+#define FIX_MAX_SPEED_CMS       4200   // ~150 km/h
+#define FIX_MAX_ACCEL_CMS2      500    // ~0.5 g
+#define FIX_ACCEL_MAX_AGE_MS    60000  // Acceleration test only against a recent anchor
+#define FIX_STILL_MARGIN_CM     1000   // Allowed drift while still, on top of the accuracies
+#define FIX_MIN_INTERVAL_MS     1000   // Fixes closer in time are compared over this interval
+#define FIX_REANCHOR_AFTER      3      // Consecutive rejections: the anchor was wrong, trust the new fix
+
+enum FixVerdict : uint8_t {
+  FIX_TRUSTED,
+  FIX_REJECT_SPEED,   // Jump faster than FIX_MAX_SPEED_CMS
+  FIX_REJECT_ACCEL,   // Reported speed changed faster than FIX_MAX_ACCEL_CMS2
+  FIX_REJECT_STILL,   // Moved although the IMU saw no motion
+  FIX_VERDICT_COUNT
+};
+
+// IMU stillness since a millis() time, from the sketch
+typedef bool (*StillnessSource)(uint32_t sinceMs);
+void setStillnessSource(StillnessSource source);
+
+// Validation (trusted fixes become the new anchor)
+FixVerdict validateFix(const GPSData& fix);
+void printFixValidation();
+
+// Fixed-point helpers
+int32_t parseScaled(const char* text, uint8_t decimals);
+int32_t cosQ15(int32_t angleE6);
+void localOffsetCm(int32_t fromLatE6, int32_t fromLonE6, int32_t toLatE6, int32_t toLonE6,
+                   int32_t& eastCm, int32_t& northCm);
+
+#endif // FIX_VALIDATOR_H
@@ -0,0 +1,226 @@
+/*
+ * gnss_budget.cpp
+ *
+ * Implementation of the predictive GNSS acquisition budget
+ *
+ * Expected TTFF comes from the current spot if it has fixed before,
+ * otherwise from the fix-age class (hot / warm / cold, same limits as
+ * the start mode choice in gnss_profile.h), whichever is larger, so a
+ * stale ephemeris lengthens the budget even at a known spot. Each
+ * consecutive failure at the spot halves the budget. Every
+ * GNSS_BUDGET_PROBE_EVERY-th attempt there runs with the full budget,
+ * and failures fade after GNSS_BUDGET_DECAY_S without attempts, so a
+ * spot with sky view again recovers.
+ */
+
+#include "gnss_budget.h"
+#include "gnss_profile.h"
+
+enum FixAgeClass { AGE_HOT, AGE_WARM, AGE_COLD, AGE_CLASS_COUNT };
+
+struct GNSSSpot {
+  int32_t lat;           // Spot index (latitude * 1e6 / GNSS_BUDGET_SPOT_E6)
+  int32_t lon;
+  uint32_t ttffMs;       // EWMA, 0 = never fixed here
+  uint32_t lastAttemptS; // RTC clock seconds
+  uint32_t decayedS;     // Failures are decayed up to this time (RTC clock seconds)
+  uint16_t attempts;
+  uint16_t fixes;
+  uint8_t failures;      // Consecutive
+  uint8_t backedOff;     // Reduced attempts since the last full-length one
+  bool used;
+};
+
+// History (survives deep sleep)
+RTC_DATA_ATTR GNSSSpot gnssSpots[GNSS_BUDGET_SPOTS];
+RTC_DATA_ATTR uint32_t ttffByAge[AGE_CLASS_COUNT] = {};
+RTC_DATA_ATTR int8_t currentSpot = -1;   // Spot of the last fix, -1 = unknown
+RTC_DATA_ATTR uint32_t lastBudgetMs = 0;
+
+static bool lastBudgetProbe = false;   // Full-length probe at a failing spot
+
+static const uint32_t defaultTTFF[AGE_CLASS_COUNT] = {
+  GNSS_TTFF_HOT_MS, GNSS_TTFF_WARM_MS, GNSS_TTFF_COLD_MS
+};
+
+/*
+ * Fold a measurement into an average (alpha = 1/4)
+ */
+static void updateAverage(uint32_t& avg, uint32_t sample) {
+  avg = (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+static FixAgeClass ageClass(uint32_t fixAgeS) {
+  if (fixAgeS < GNSS_HOT_MAX_AGE_S) return AGE_HOT;
+  if (fixAgeS < GNSS_WARM_MAX_AGE_S) return AGE_WARM;
+  return AGE_COLD;
+}
+
+static const char* ageName(int cls) {
+  return cls == AGE_HOT ? "hot" : cls == AGE_WARM ? "warm" : "cold";
+}
+
+/*
+ * Find (or take over the least recently used) spot for a fix position
+ */
+static int spotFor(const GPSData& fix) {
+  int32_t lat = (int32_t)lround(strtod(fix.latitude.c_str(), nullptr) * 1e6) / GNSS_BUDGET_SPOT_E6;
+  int32_t lon = (int32_t)lround(strtod(fix.longitude.c_str(), nullptr) * 1e6) / GNSS_BUDGET_SPOT_E6;
+
+  int oldest = 0;
+  for (int i = 0; i < GNSS_BUDGET_SPOTS; i++) {
+    if (gnssSpots[i].used && gnssSpots[i].lat == lat && gnssSpots[i].lon == lon) return i;
+    if (!gnssSpots[i].used ||
+        (gnssSpots[oldest].used && gnssSpots[i].lastAttemptS < gnssSpots[oldest].lastAttemptS)) {
+      oldest = i;
+    }
+  }
+
+  GNSSSpot& spot = gnssSpots[oldest];
+  memset(&spot, 0, sizeof(spot));
+  spot.lat = lat;
+  spot.lon = lon;
+  spot.used = true;
+  return oldest;
+}
+
+/*
+ * Forget one failure per GNSS_BUDGET_DECAY_S since the last attempt
+ * The decay point advances by the periods used, so a prediction and the
+ * acquisition after it never forget the same period twice
+ */
+static void decayFailures(GNSSSpot& spot, uint32_t now) {
+  if (spot.failures == 0 || now <= spot.decayedS) return;
+  uint32_t periods = (now - spot.decayedS) / GNSS_BUDGET_DECAY_S;
+  spot.failures = periods >= spot.failures ? 0 : spot.failures - periods;
+  spot.decayedS += periods * GNSS_BUDGET_DECAY_S;
+}
+
+/*
+ * Predict the acquisition budget for this wake
+ *
+ * @return attempts for acquireGPSFix()
+ */
+uint32_t predictGNSSAttempts() {
+  uint32_t fixAge = getGNSSFixAgeS();
+  FixAgeClass cls = isGNSSEphemerisLost() ? AGE_COLD : ageClass(fixAge);
+  uint32_t expected = ttffByAge[cls] ? ttffByAge[cls] : defaultTTFF[cls];
+  const char* reason = ageName(cls);
+  lastBudgetProbe = false;
+
+  if (currentSpot >= 0) {
+    GNSSSpot& spot = gnssSpots[currentSpot];
+    decayFailures(spot, getGNSSClockS());
+    expected = max(expected, spot.ttffMs);
+
+    uint32_t budget = expected * GNSS_BUDGET_MARGIN + GPS_IMPROVE_WINDOW_MS;
+    if (spot.failures > 0) {
+      if (spot.backedOff + 1 >= GNSS_BUDGET_PROBE_EVERY) {
+        reason = "probe";
+        lastBudgetProbe = true;
+      } else {
+        budget >>= min((int)spot.failures, 3);
+        reason = "backoff";
+      }
+    }
+    lastBudgetMs = constrain(budget, (uint32_t)GNSS_BUDGET_MIN_MS, (uint32_t)GNSS_BUDGET_MAX_MS);
+  } else {
+    lastBudgetMs = constrain(expected * GNSS_BUDGET_MARGIN + GPS_IMPROVE_WINDOW_MS,
+                             (uint32_t)GNSS_BUDGET_MIN_MS, (uint32_t)GNSS_BUDGET_MAX_MS);
+  }
+
+  // The budget runs from GNSS power-on like the TTFF it comes from: a warm-up has used part of it
+  uint32_t onMs = getGNSSSessionMs();
+  uint32_t remaining = lastBudgetMs > onMs ? lastBudgetMs - onMs : 0;
+  uint32_t attempts = max((uint32_t)1, (remaining + GNSS_BUDGET_POLL_MS - 1) / GNSS_BUDGET_POLL_MS);
+  Serial.printf("🛰️ GNSS budget %lu ms, %lu ms already on (%lu attempts, %s)\n",
+                lastBudgetMs, onMs, attempts, reason);
+  return attempts;
+}
+
+/*
+ * Extra time to first fix when the module is powered off between reports
+ * (ephemeris lost, cold start) compared to a start after the interval
+ *
+ * @param intervalS Time between reports
+ */
+uint32_t getGNSSColdPenaltyMs(uint32_t intervalS) {
+  FixAgeClass kept = ageClass(intervalS);
+  uint32_t cold = ttffByAge[AGE_COLD] ? ttffByAge[AGE_COLD] : defaultTTFF[AGE_COLD];
+  uint32_t normal = ttffByAge[kept] ? ttffByAge[kept] : defaultTTFF[kept];
+  return cold > normal ? cold - normal : 0;
+}
+
+/*
+ * Check if the predicted acquisition is slow or likely to fail
+ * Call after predictGNSSAttempts(). The session then looks up a cell
+ * tower position before GNSS, so the report never waits for the whole
+ * GNSS budget to run out.
+ */
+bool isGNSSFixDoubtful() {
+  if (lastBudgetMs > GNSS_CELL_FIRST_MS) return true;
+  return currentSpot >= 0 && gnssSpots[currentSpot].failures > 0;
+}
+
+/*
+ * Shorten the budget once a cell tower position is in hand
+ * The report no longer depends on the fix; probes keep their full length
+ *
+ * @return attempts for acquireGPSFix()
+ */
+uint32_t capGNSSAttempts(uint32_t attempts) {
+  uint32_t cap = (GNSS_CELL_CAP_MS + GNSS_BUDGET_POLL_MS - 1) / GNSS_BUDGET_POLL_MS;
+  if (lastBudgetProbe || attempts <= cap) return attempts;
+
+  Serial.printf("🛰️ GNSS budget capped to %lu attempts (cell position known)\n", cap);
+  return cap;
+}
+
+/*
+ * Learn from a finished acquisition
+ *
+ * @param fixAgeS Time since the previous fix, sampled before the search
+ * @param ttffMs  Time from GNSS power-on to the first fix (ignored if not fixed)
+ * @param fix     The fix, gives the spot; the last known spot is used otherwise
+ */
+void recordGNSSAcquisition(uint32_t fixAgeS, bool fixed, uint32_t ttffMs, const GPSData& fix) {
+  uint32_t now = getGNSSClockS();
+  if (fixed) {
+    currentSpot = spotFor(fix);
+    updateAverage(ttffByAge[ageClass(fixAgeS)], ttffMs);
+  }
+  if (currentSpot < 0) return;
+
+  GNSSSpot& spot = gnssSpots[currentSpot];
+  decayFailures(spot, now);
+  bool fullLength = spot.failures == 0 || spot.backedOff + 1 >= GNSS_BUDGET_PROBE_EVERY;
+
+  if (spot.attempts < UINT16_MAX) spot.attempts++;
+  spot.lastAttemptS = now;
+  spot.decayedS = now;   // Quiet time counts again from this attempt
+  spot.backedOff = fullLength ? 0 : spot.backedOff + 1;
+
+  if (fixed) {
+    updateAverage(spot.ttffMs, ttffMs);
+    if (spot.fixes < UINT16_MAX) spot.fixes++;
+    spot.failures = 0;
+  } else if (spot.failures < UINT8_MAX) {
+    spot.failures++;
+  }
+}
+
+/*
+ * Print TTFF history and spots
+ */
+void printGNSSBudget() {
+  Serial.printf("\nGNSS budget: last %lu ms, TTFF hot %lu / warm %lu / cold %lu ms\n",
+                lastBudgetMs, ttffByAge[AGE_HOT], ttffByAge[AGE_WARM], ttffByAge[AGE_COLD]);
+  for (int i = 0; i < GNSS_BUDGET_SPOTS; i++) {
+    const GNSSSpot& s = gnssSpots[i];
+    if (!s.used) continue;
+    Serial.printf("  %s%.3f,%.3f: %u/%u fixed, TTFF %lu ms, %u failures\n",
+                  i == currentSpot ? "*" : " ",
+                  s.lat * (GNSS_BUDGET_SPOT_E6 / 1e6), s.lon * (GNSS_BUDGET_SPOT_E6 / 1e6),
+                  s.fixes, s.attempts, s.ttffMs, s.failures);
+  }
+}
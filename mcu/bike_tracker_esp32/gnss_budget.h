@@ -0,0 +1,43 @@
+/*
+ * gnss_budget.h
+ *
+ * Predictive GNSS acquisition budget
+ * Keeps TTFF and failure history per recent location and per time since
+ * the last fix, and predicts how long the next acquisition may take.
+ * A spot where fixes keep failing (underground garage) gets a shrinking
+ * budget, with a periodic full-length probe so it is never given up.
+ */
+
+#ifndef GNSS_BUDGET_H
+#define GNSS_BUDGET_H
+
+#include <Arduino.h>
+#include "gps_handler.h"
+
+#define GNSS_BUDGET_SPOTS          8        // Locations remembered
+#define GNSS_BUDGET_SPOT_E6        2000     // Spot size, 1e-6 degrees (~200 m)
+#define GNSS_BUDGET_MIN_MS         12000    // Never below (covers a hot start)
+#define GNSS_BUDGET_MAX_MS         120000
+#define GNSS_BUDGET_MARGIN         2        // Budget = expected TTFF * margin + improve window
+#define GNSS_BUDGET_PROBE_EVERY    4        // Full budget every Nth attempt at a failing spot
+#define GNSS_BUDGET_DECAY_S        21600    // One failure forgotten per 6 h without attempts
+#define GNSS_BUDGET_POLL_MS        (GPS_POLL_INTERVAL_MS + 500)  // One acquireGPSFix attempt
+#define GNSS_CELL_FIRST_MS         30000    // Longer budgets get a cell tower position first
+#define GNSS_CELL_CAP_MS           24000    // Budget once a cell position is in hand
+
+// Expected TTFF before any history, by time since the last fix
+#define GNSS_TTFF_HOT_MS           10000
+#define GNSS_TTFF_WARM_MS          30000
+#define GNSS_TTFF_COLD_MS          50000
+
+// Prediction and learning
+uint32_t predictGNSSAttempts();
+bool isGNSSFixDoubtful();
+uint32_t getGNSSColdPenaltyMs(uint32_t intervalS);
+uint32_t capGNSSAttempts(uint32_t attempts);
+void recordGNSSAcquisition(uint32_t fixAgeS, bool fixed, uint32_t ttffMs, const GPSData& fix);
+
+// Statistics
+void printGNSSBudget();
+
+#endif // GNSS_BUDGET_H
@@ -0,0 +1,264 @@
+/*
+ * gnss_profile.cpp
+ *
+ * Implementation of GNSS profiles
+ *
+ * More constellations shorten the time to first fix and cost receiver
+ * power, so alerts use all of them and scheduled reports only GPS and
+ * GLONASS. AUTO start picks hot, warm or cold from the age of the last
+ * fix, measured with the RTC clock that keeps running in deep sleep.
+ * A profile whose last session ended without a fix cold starts once,
+ * in case stale aiding data held the receiver back. Only the first miss
+ * of a streak does that: a bike parked under a roof would otherwise
+ * throw away good ephemeris on every session. A session switched off
+ * before a fix search (aborted warm-up) or that never saw a satellite
+ * is not a miss, the receiver was not at fault.
+ */
+
+#include "gnss_profile.h"
+#include "sim7070g.h"
+#include <sys/time.h>
+
+struct GNSSProfile {
+  const char* name;
+  uint8_t constellations;
+  GNSSStartMode start;
+  float staticSpeedMs;   // 0 = static navigation off
+};
+
+static const GNSSProfile profiles[GNSS_PROFILE_COUNT] = {
+  {"urgent",   GNSS_URGENT_CONSTELLATIONS,   GNSS_START_AUTO, 0.0f},
+  {"periodic", GNSS_PERIODIC_CONSTELLATIONS, GNSS_START_AUTO, GNSS_PERIODIC_STATIC_MS},
+  {"live",     GNSS_LIVE_CONSTELLATIONS,     GNSS_START_HOT,  0.0f},
+};
+
+struct GNSSProfileStats {
+  uint16_t sessions;
+  uint16_t fixes;
+  uint32_t ttffMs;       // EWMA time to first fix
+  uint32_t acceptMs;     // EWMA time to the first fix passing the quality gate
+  uint16_t accepted;
+  uint32_t onMs;         // EWMA GNSS-on time per session
+  uint32_t onTotalS;
+  uint8_t lastStart;     // GNSSStartMode used last
+  uint8_t missStreak;    // Sessions in a row that searched with satellites in view and did not fix
+};
+
+// Per-profile statistics and fix age (survive deep sleep)
+RTC_DATA_ATTR GNSSProfileStats gnssStats[GNSS_PROFILE_COUNT];
+RTC_DATA_ATTR uint32_t lastFixClockS = 0;    // RTC clock at the last fix, 0 = none
+RTC_DATA_ATTR bool staticNavUnsupported = false;
+RTC_DATA_ATTR bool ephemerisLost = false;    // Module power-cycled since the last fix
+
+static GNSSProfileId activeProfile = GNSS_PROFILE_PERIODIC;
+static bool sessionOpen = false;
+static bool sessionFixed = false;
+static bool sessionSearched = false;   // acquireGPSFix ran in this session
+static bool sessionSky = false;        // ... and saw at least one satellite
+static uint32_t sessionStart = 0;
+
+/*
+ * Fold a measurement into an average (alpha = 1/4)
+ */
+static void updateAverage(uint32_t& avg, uint32_t sample) {
+  avg = (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+/*
+ * Seconds on the RTC clock, continues through deep sleep
+ */
+uint32_t getGNSSClockS() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return tv.tv_sec;
+}
+
+/*
+ * Seconds since the last valid fix, UINT32_MAX if there was none
+ */
+uint32_t getGNSSFixAgeS() {
+  if (lastFixClockS == 0) return UINT32_MAX;
+  return getGNSSClockS() - lastFixClockS;
+}
+
+/*
+ * Note that the module was powered off (full-off sleep or power cycle)
+ * The receiver keeps no ephemeris through it, so the next start is cold
+ * whatever the age of the last fix.
+ */
+void noteGNSSPowerLoss() {
+  ephemerisLost = true;
+}
+
+bool isGNSSEphemerisLost() {
+  return ephemerisLost;
+}
+
+static const char* startName(uint8_t mode) {
+  switch (mode) {
+    case GNSS_START_HOT:  return "hot";
+    case GNSS_START_WARM: return "warm";
+    case GNSS_START_COLD: return "cold";
+    default:              return "default";
+  }
+}
+
+/*
+ * Resolve AUTO to a concrete start mode
+ */
+static GNSSStartMode chooseStart(const GNSSProfile& profile, const GNSSProfileStats& stats) {
+  if (ephemerisLost && lastFixClockS != 0) return GNSS_START_COLD;  // Hot/warm data is gone
+  if (stats.missStreak == 1) return GNSS_START_COLD;  // First miss only, not every one after it
+  if (profile.start != GNSS_START_AUTO) return profile.start;
+  if (lastFixClockS == 0) return GNSS_START_AUTO;  // No history, module decides
+
+  uint32_t age = getGNSSFixAgeS();
+  if (age < GNSS_HOT_MAX_AGE_S) return GNSS_START_HOT;
+  if (age < GNSS_WARM_MAX_AGE_S) return GNSS_START_WARM;
+  return GNSS_START_COLD;
+}
+
+/*
+ * Select the profile for the next GNSS session
+ */
+void selectGNSSProfile(GNSSProfileId id) {
+  if (id < GNSS_PROFILE_COUNT) activeProfile = id;
+}
+
+GNSSProfileId getGNSSProfile() {
+  return activeProfile;
+}
+
+/*
+ * Set the constellations (GNSS must be off)
+ * Order: GPS, GLONASS, BeiDou, Galileo, QZSS
+ */
+void configureGNSSProfile() {
+  uint8_t mask = profiles[activeProfile].constellations;
+  char cmd[32];
+  snprintf(cmd, sizeof(cmd), "AT+CGNSMOD=%d,%d,%d,%d,%d",
+           (mask & GNSS_GPS) ? 1 : 0, (mask & GNSS_GLONASS) ? 1 : 0,
+           (mask & GNSS_BEIDOU) ? 1 : 0, (mask & GNSS_GALILEO) ? 1 : 0,
+           (mask & GNSS_QZSS) ? 1 : 0);
+  if (!sendATCommand(cmd, "OK", 1000)) {
+    Serial.println("⚠️ GNSS constellation setting rejected - module default");
+  }
+}
+
+/*
+ * Apply start mode and static threshold after AT+CGNSPWR=1 and start timing
+ */
+void startGNSSProfile() {
+  const GNSSProfile& profile = profiles[activeProfile];
+  GNSSProfileStats& stats = gnssStats[activeProfile];
+  GNSSStartMode start = chooseStart(profile, stats);
+
+  if (start == GNSS_START_HOT) sendATCommand("AT+CGNSHOT", "OK", 2000);
+  else if (start == GNSS_START_WARM) sendATCommand("AT+CGNSWARM", "OK", 2000);
+  else if (start == GNSS_START_COLD) sendATCommand("AT+CGNSCOLD", "OK", 2000);
+
+  // Static navigation through the receiver's NMEA command channel (PMTK386)
+  if (!staticNavUnsupported) {
+    char sentence[24];
+    char cmd[48];
+    snprintf(sentence, sizeof(sentence), "PMTK386,%.1f", profile.staticSpeedMs);
+    uint8_t checksum = 0;
+    for (const char* p = sentence; *p; p++) checksum ^= *p;
+    snprintf(cmd, sizeof(cmd), "AT+CGNSCMD=0,\"$%s*%02X\"", sentence, checksum);
+    if (!sendATCommand(cmd, "OK", 1000)) {
+      staticNavUnsupported = true;
+      Serial.println("⚠️ Static navigation threshold not supported by this firmware");
+    }
+  }
+
+  Serial.printf("🛰️ GNSS profile %s, %s start\n", profile.name, startName(start));
+  stats.lastStart = start;
+  if (stats.sessions < UINT16_MAX) stats.sessions++;
+  sessionOpen = true;
+  sessionFixed = false;
+  sessionSearched = false;
+  sessionSky = false;
+  sessionStart = millis();
+}
+
+/*
+ * Time since the receiver was switched on, 0 without an open session
+ * TTFF is measured from here, also when a warm-up ran before the search
+ */
+uint32_t getGNSSSessionMs() {
+  return sessionOpen ? millis() - sessionStart : 0;
+}
+
+/*
+ * Note a fix search in the open session
+ *
+ * @param skySeen At least one satellite was in view during the search
+ */
+void noteGNSSSearch(bool skySeen) {
+  if (!sessionOpen) return;
+  sessionSearched = true;
+  if (skySeen) sessionSky = true;
+}
+
+/*
+ * Note a trusted fix, the first one of a session gives the TTFF
+ *
+ * @param ttffMs Time from power-on to the first fix (getGNSSSessionMs())
+ */
+void recordGNSSFix(uint32_t ttffMs) {
+  lastFixClockS = getGNSSClockS();
+  if (lastFixClockS == 0) lastFixClockS = 1;
+  ephemerisLost = false;
+  if (!sessionOpen || sessionFixed) return;
+
+  GNSSProfileStats& stats = gnssStats[activeProfile];
+  updateAverage(stats.ttffMs, ttffMs);
+  if (stats.fixes < UINT16_MAX) stats.fixes++;
+  sessionFixed = true;
+  Serial.printf("🛰️ TTFF %lu ms (%s)\n", ttffMs, profiles[activeProfile].name);
+}
+
+/*
+ * Note the first fix that passed the quality gate (gps_handler.h)
+ *
+ * @param elapsedMs Time since the receiver was switched on
+ */
+void recordGNSSAcceptableFix(uint32_t elapsedMs) {
+  GNSSProfileStats& stats = gnssStats[activeProfile];
+  updateAverage(stats.acceptMs, elapsedMs);
+  if (stats.accepted < UINT16_MAX) stats.accepted++;
+}
+
+/*
+ * Close the GNSS session when the receiver is switched off
+ */
+void endGNSSSession() {
+  if (!sessionOpen) return;
+  sessionOpen = false;
+
+  GNSSProfileStats& stats = gnssStats[activeProfile];
+  uint32_t onMs = millis() - sessionStart;
+  updateAverage(stats.onMs, onMs);
+  stats.onTotalS += onMs / 1000;
+
+  // Aborted and no-sky sessions neither extend nor end a streak
+  if (sessionFixed) stats.missStreak = 0;
+  else if (sessionSearched && sessionSky && stats.missStreak < UINT8_MAX) stats.missStreak++;
+}
+
+/*
+ * Print profile settings and measured TTFF / on-time
+ */
+void printGNSSProfiles() {
+  Serial.printf("\nGNSS profiles (active: %s, static nav %s):\n",
+                profiles[activeProfile].name, staticNavUnsupported ? "unsupported" : "ok");
+  for (int i = 0; i < GNSS_PROFILE_COUNT; i++) {
+    const GNSSProfile& p = profiles[i];
+    const GNSSProfileStats& s = gnssStats[i];
+    Serial.printf("  %-8s mask 0x%02X, static %.1f m/s: %u/%u fixed (%u acceptable), TTFF %lu ms, "
+                  "acceptable %lu ms, on %lu ms (total %lu s), last %s, %u missed in a row\n",
+                  p.name, p.constellations, p.staticSpeedMs, s.fixes, s.sessions, s.accepted,
+                  s.ttffMs, s.acceptMs, s.onMs, s.onTotalS, startName(s.lastStart),
+                  s.missStreak);
+  }
+}
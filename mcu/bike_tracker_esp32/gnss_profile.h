@@ -0,0 +1,70 @@
+/*
+ * gnss_profile.h
+ *
+ * GNSS profiles per situation
+ * Each profile sets the constellations (AT+CGNSMOD), the start mode
+ * (hot/warm/cold) and the static-navigation threshold. Time to first
+ * fix and GNSS-on time are measured per profile so the choice can be
+ * tuned from the "gnss" serial command.
+ */
+
+#ifndef GNSS_PROFILE_H
+#define GNSS_PROFILE_H
+
+#include <Arduino.h>
+
+// Constellations (bit order matches the AT+CGNSMOD parameters)
+#define GNSS_GPS      0x01
+#define GNSS_GLONASS  0x02
+#define GNSS_BEIDOU   0x04
+#define GNSS_GALILEO  0x08
+#define GNSS_QZSS     0x10
+
+// Profile settings
+#define GNSS_URGENT_CONSTELLATIONS    (GNSS_GPS | GNSS_GLONASS | GNSS_BEIDOU | GNSS_GALILEO)
+#define GNSS_PERIODIC_CONSTELLATIONS  (GNSS_GPS | GNSS_GLONASS)
+#define GNSS_LIVE_CONSTELLATIONS      (GNSS_GPS | GNSS_GLONASS | GNSS_BEIDOU)
+#define GNSS_PERIODIC_STATIC_MS       0.4f   // Parked bike: hold position below this speed (m/s)
+#define GNSS_LIVE_INTERVAL_S          120    // Periodic reports this frequent count as live tracking
+
+// Start mode selection for GNSS_START_AUTO
+#define GNSS_HOT_MAX_AGE_S            7200     // Ephemeris still valid
+#define GNSS_WARM_MAX_AGE_S           259200   // Almanac and rough position still useful
+
+enum GNSSProfileId : uint8_t {
+  GNSS_PROFILE_URGENT,    // Theft alert after motion - fastest fix
+  GNSS_PROFILE_PERIODIC,  // Scheduled report - lowest energy
+  GNSS_PROFILE_LIVE,      // Short report interval - GNSS stays hot
+  GNSS_PROFILE_COUNT
+};
+
+enum GNSSStartMode : uint8_t {
+  GNSS_START_AUTO,   // From the age of the last fix (module default if none)
+  GNSS_START_HOT,
+  GNSS_START_WARM,
+  GNSS_START_COLD
+};
+
+// Selection (before the GNSS phase)
+void selectGNSSProfile(GNSSProfileId id);
+GNSSProfileId getGNSSProfile();
+
+// Called by the modem layer around AT+CGNSPWR
+void configureGNSSProfile();   // GNSS off: constellations
+void startGNSSProfile();       // GNSS on: start mode, static threshold
+void recordGNSSFix(uint32_t ttffMs);
+void recordGNSSAcceptableFix(uint32_t elapsedMs);
+void noteGNSSSearch(bool skySeen);
+void endGNSSSession();
+uint32_t getGNSSSessionMs();   // Time since AT+CGNSPWR=1, 0 if GNSS is off
+
+// Fix history
+uint32_t getGNSSClockS();
+uint32_t getGNSSFixAgeS();
+void noteGNSSPowerLoss();      // Module powered off: ephemeris gone until the next fix
+bool isGNSSEphemerisLost();
+
+// Statistics
+void printGNSSProfiles();
+
+#endif // GNSS_PROFILE_H
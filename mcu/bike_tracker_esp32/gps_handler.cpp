@@ -6,11 +6,20 @@
 
 #include "gps_handler.h"
 #include "sim7070g.h"
+#include "at_trace.h"
+#include "gnss_profile.h"
+#include "gnss_budget.h"
+#include "fix_validator.h"
+#include "track_fusion.h"
 #include <time.h>
 
 // Preferences for GPS data storage
 static Preferences gpsPrefs;
 
+// Fix of the last acquisition that failed validateFix()
+static GPSData rejectedFix = {};
+static bool haveRejectedFix = false;
+
 /*
  * Convert GPS datetime string to Unix timestamp in milliseconds
  * GPS datetime format: YYYYMMDDHHMMSS.sss
@@ -75,8 +84,62 @@ uint64_t parseGPSDateTimeToUnixMillis(const String& datetime) {
   return totalSeconds * 1000ULL;
 }
 
+/*
+ * Horizontal accuracy in metres: the receiver's estimate if reported,
+ * otherwise HDOP * GPS_UERE_METERS (0 = unknown)
+ */
+float getGPSAccuracy(const GPSData& data) {
+  if (data.accuracy > 0) return data.accuracy;
+  return data.hdop > 0 ? data.hdop * GPS_UERE_METERS : 0;
+}
+
+/*
+ * Check a fix against the acceptance thresholds
+ * Unknown PDOP or satellite count is not held against the fix
+ */
+bool isAcceptableFix(const GPSData& data) {
+  if (!data.valid || data.hdop <= 0 || data.hdop > GPS_ACCEPT_HDOP) return false;
+  if (data.pdop > GPS_ACCEPT_PDOP) return false;
+  if (data.satellites > 0 && data.satellites < GPS_ACCEPT_SATELLITES) return false;
+  return true;
+}
+
+/*
+ * Fix of the last acquireGPSFix() that failed the plausibility check
+ * Not logged or cached - for a report that would otherwise have no fresh position
+ *
+ * @return false if the last acquisition had no rejected fix
+ */
+bool getRejectedFix(GPSData& data) {
+  if (!haveRejectedFix) return false;
+  data = rejectedFix;
+  return true;
+}
+
+/*
+ * Satellites in view from an AT+CGNSINF response, with or without a fix
+ * (field 14, after <Reserved2>)
+ */
+static int parseSatellitesInView(const String& response) {
+  int pos = response.indexOf("+CGNSINF: ");
+  if (pos == -1) return 0;
+  pos += 10;
+  for (int field = 0; field < 14; field++) {
+    pos = response.indexOf(',', pos);
+    if (pos == -1) return 0;
+    pos++;
+  }
+  return response.substring(pos).toInt();
+}
+
 /*
  * Acquire GPS fix with retry mechanism
+ *
+ * The first fix of a session is rarely the best one. Polling continues
+ * for GPS_IMPROVE_WINDOW_MS after the first acceptable fix (HDOP, PDOP,
+ * satellites) and keeps the most accurate one, or stops early once it
+ * reaches GPS_TARGET_ACCURACY_M. A fix that never becomes acceptable is
+ * only used if nothing better arrives, and never beyond GPS_REJECT_HDOP.
  * Returns true when valid fix is obtained
  */
 bool acquireGPSFix(GPSData& data, uint32_t maxAttempts) {
@@ -89,51 +152,100 @@ bool acquireGPSFix(GPSData& data, uint32_t maxAttempts) {
     }
   }
   
-  // First disable RF to prepare for GPS operation
-  Serial.println("📡 Switching to GPS mode...");
-  disableRF();
-  delay(500);
-  
-  // Enable GPS
-  if (!enableGNSSPower()) {
-    Serial.println("❌ Failed to enable GPS");
-    // Re-enable RF on failure
-    enableRF();
-    return false;
+  // Switch to GPS mode (RF off, GNSS on) - skipped if already there
+  if (getModemState() != MODEM_GNSS) {
+    Serial.println("📡 Switching to GPS mode...");
+    if (!setModemState(MODEM_GNSS)) {
+      Serial.println("❌ Failed to enable GPS");
+      return false;
+    }
+    
+    // Wait for GPS to initialize
+    waitModem(2000);
   }
   
-  // Wait for GPS to initialize
-  delay(2000);
-  
   uint32_t attemptCount = 0;
-  bool fixAcquired = false;
-  
-  while (!fixAcquired && attemptCount < maxAttempts) {
+  uint32_t start = millis();
+  uint32_t firstFixMs = 0;
+  // Before recordGNSSFix() resets it; after a power-off the start is cold
+  uint32_t fixAgeS = isGNSSEphemerisLost() ? UINT32_MAX : getGNSSFixAgeS();
+  uint32_t acceptedAt = 0;   // Time of the first acceptable fix, 0 = none yet
+  bool haveFix = false;
+  bool haveAcceptable = false;
+  bool skySeen = false;      // Any satellite in view - a miss without one is no sky, not the receiver
+  GPSData best = {};
+  
+  while (attemptCount < maxAttempts) {
     attemptCount++;
     
     String response;
-    if (requestGNSSInfo(response)) {
-      if (parseGNSSData(response, data)) {
-        fixAcquired = true;
-        // Convert GPS datetime to Unix timestamp in milliseconds
-        data.timestamp = parseGPSDateTimeToUnixMillis(data.datetime);
-        Serial.printf("🛰️ GPS Fix acquired: lat=%s, lon=%s, speed=%s km/h\n", 
-                      data.latitude.c_str(), data.longitude.c_str(), data.speed.c_str());
-        saveGPSData(data);
+    GPSData fix = {};
+    bool answered = requestGNSSInfo(response);
+    if (answered && parseSatellitesInView(response) > 0) skySeen = true;
+    if (answered && parseGNSSData(response, fix) && fix.hdop <= GPS_REJECT_HDOP) {
+      if (!haveFix) firstFixMs = getGNSSSessionMs();   // From power-on, a motion-wake warm-up included
+      bool acceptable = isAcceptableFix(fix);
+
+      // Acceptable fixes replace unacceptable ones, otherwise the more accurate wins
+      if (!haveFix || (acceptable && !haveAcceptable) ||
+          (acceptable == haveAcceptable && getGPSAccuracy(fix) < getGPSAccuracy(best))) {
+        best = fix;
       }
+      haveFix = true;
+
+      if (acceptable && !haveAcceptable) {
+        haveAcceptable = true;
+        acceptedAt = millis();
+        recordGNSSAcceptableFix(getGNSSSessionMs());
+      }
+
+      if (haveAcceptable && getGPSAccuracy(best) <= GPS_TARGET_ACCURACY_M) break;
     }
     
-    if (!fixAcquired) {
-      delay(2000);  // Wait before next attempt
+    if (haveAcceptable && millis() - acceptedAt >= GPS_IMPROVE_WINDOW_MS) break;
+    waitModem(GPS_POLL_INTERVAL_MS);  // Wait before next attempt
+  }
+
+  haveRejectedFix = false;
+  if (haveFix) {
+    // Convert GPS datetime to Unix timestamp in milliseconds
+    best.timestamp = parseGPSDateTimeToUnixMillis(best.datetime);
+
+    // The receiver did its job either way: TTFF, profile and budget count the fix
+    recordGNSSFix(firstFixMs);
+  }
+  noteGNSSSearch(skySeen || haveFix);
+  recordGNSSAcquisition(fixAgeS, haveFix, firstFixMs, best);
+
+  // Implausible jumps (multipath) never reach the track log or the filter,
+  // the caller may still report the fix as unverified (getRejectedFix)
+  if (haveFix && validateFix(best) != FIX_TRUSTED) {
+    rejectedFix = best;
+    haveRejectedFix = true;
+    haveFix = false;
+  } else if (haveFix) {
+    fuseGNSSFix(best);
+  }
+
+  if (haveFix) {
+    data = best;
+    Serial.printf("🛰️ GPS Fix %s: lat=%s, lon=%s, speed=%s km/h, HDOP %.1f, %u sats, ~%.0f m (%lu ms)\n",
+                  haveAcceptable ? "accepted" : "below target",
+                  data.latitude.c_str(), data.longitude.c_str(), data.speed.c_str(),
+                  data.hdop, data.satellites, getGPSAccuracy(data), millis() - start);
+
+    // The raw fix is the record, the filter's estimate goes beside it (uplink report)
+    FusedState fused;
+    getFusedState(fused);
+    if (fused.valid) {
+      Serial.printf("🧭 Fused %.6f,%.6f ±%lu m\n", fused.latE6 / 1e6, fused.lonE6 / 1e6,
+                    fused.uncertaintyMm / 1000);
     }
+    saveGPSData(data);
   }
   
-  // After GPS operation, disable GPS and re-enable RF for normal operation
-  disableGNSSPower();
-  delay(500);
-  enableRF();
-  
-  return fixAcquired;
+  // GNSS stays on - the caller picks the next modem state (RF for SMS or off)
+  return haveFix;
 }
 
 /*
@@ -142,7 +254,8 @@ bool acquireGPSFix(GPSData& data, uint32_t maxAttempts) {
 bool requestGNSSInfo(String& response) {
   clearSerialBuffer();
   simSerial.println("AT+CGNSINF");
-  delay(500);
+  beginATTrace("AT+CGNSINF", sizeof("AT+CGNSINF") + 1);
+  waitModem(500);
   
   response = "";
   uint32_t start = millis();
@@ -151,19 +264,23 @@ bool requestGNSSInfo(String& response) {
     while (simSerial.available()) {
       char c = simSerial.read();
       response += c;
+      noteATFirstByte();
     }
     
     if (response.indexOf("OK") != -1) {
+      endATTrace(AT_TRACE_OK, response.length());
       return true;
     }
   }
   
+  endATTrace(classifyATResponse(response), response.length());
   return false;
 }
 
 /*
  * Parse GNSS data from AT+CGNSINF response
- * Format: +CGNSINF: <run>,<fix>,<datetime>,<lat>,<lon>,<alt>,<speed>,...
+ * Format: +CGNSINF: <run>,<fix>,<datetime>,<lat>,<lon>,<alt>,<speed>,<course>,
+ *                   <fix mode>,<reserved>,<HDOP>,...
  */
 bool parseGNSSData(const String& gpsData, GPSData& data) {
   // Debug: show raw CGNSINF response
@@ -203,6 +320,12 @@ bool parseGNSSData(const String& gpsData, GPSData& data) {
   data.altitude = fields[5];
   data.speed = fields[6];
   data.course = fields[7];
+  data.hdop = fields[10].toFloat();
+  data.pdop = fields[11].toFloat();
+  data.satellites = fields[15].toInt() + fields[16].toInt();  // GNSS + GLONASS satellites used
+  data.accuracy = fields[19].toFloat();                       // HPA, empty on most firmware
+  int32_t hpaCm = parseScaled(fields[19].c_str(), 2);
+  data.accuracyCm = hpaCm > 0 ? hpaCm : parseScaled(fields[10].c_str(), 2) * GPS_UERE_CM / 100;
   
   Serial.printf("📡 Parsed GPS fields: speed='%s' (field[6])\n", fields[6].c_str());
   
@@ -229,6 +352,10 @@ void saveGPSData(const GPSData& data) {
   gpsPrefs.putString("alt", data.altitude);
   gpsPrefs.putString("speed", data.speed);
   gpsPrefs.putString("course", data.course);
+  gpsPrefs.putFloat("hdop", data.hdop);
+  gpsPrefs.putFloat("pdop", data.pdop);
+  gpsPrefs.putUChar("sats", data.satellites);
+  gpsPrefs.putFloat("acc", data.accuracy);
   gpsPrefs.putBool("valid", data.valid);
   // Store 64-bit timestamp as two 32-bit values
   gpsPrefs.putULong("timestamp_hi", (uint32_t)(data.timestamp >> 32));
@@ -248,6 +375,10 @@ bool loadGPSData(GPSData& data) {
   data.altitude = gpsPrefs.getString("alt", "");
   data.speed = gpsPrefs.getString("speed", "");
   data.course = gpsPrefs.getString("course", "");
+  data.hdop = gpsPrefs.getFloat("hdop", 0);
+  data.pdop = gpsPrefs.getFloat("pdop", 0);
+  data.satellites = gpsPrefs.getUChar("sats", 0);
+  data.accuracy = gpsPrefs.getFloat("acc", 0);
   data.valid = gpsPrefs.getBool("valid", false);
   // Load 64-bit timestamp from two 32-bit values
   uint32_t timestamp_hi = gpsPrefs.getULong("timestamp_hi", 0);
@@ -315,6 +446,7 @@ static Preferences gpsLogPrefs;
 // Use RTC memory to preserve these across deep sleep
 RTC_DATA_ATTR int logIndex = -1;  // -1 indicates uninitialized
 RTC_DATA_ATTR int logCount = -1;  // -1 indicates uninitialized
+RTC_DATA_ATTR uint32_t logSequence = 0;  // Points ever logged, never reset
 
 /*
  * Initialize GPS history logging system
@@ -330,6 +462,7 @@ void initGPSHistory() {
   gpsLogPrefs.begin(GPS_LOG_NAMESPACE, false);
   logIndex = gpsLogPrefs.getInt("logIndex", 0);
   logCount = gpsLogPrefs.getInt("logCount", 0);
+  logSequence = gpsLogPrefs.getULong("logSeq", logCount);
   gpsLogPrefs.end();
   
   Serial.printf("📍 GPS History loaded from NVS: index=%d, count=%d\n", logIndex, logCount);
@@ -363,8 +496,9 @@ bool logGPSPoint(const GPSData& data, uint8_t source) {
   gpsLogPrefs.begin(GPS_LOG_NAMESPACE, false);
 
   // Create keys for this entry (use char buffers to avoid String heap fragmentation)
-  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12];
+  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12], keyAcc[12];
   char keyTimeHi[14], keyTimeLo[14];
+  snprintf(keyAcc, sizeof(keyAcc), "acc_%d", logIndex);
   snprintf(keyLat, sizeof(keyLat), "lat_%d", logIndex);
   snprintf(keyLon, sizeof(keyLon), "lon_%d", logIndex);
   snprintf(keySpeed, sizeof(keySpeed), "spd_%d", logIndex);
@@ -379,6 +513,7 @@ bool logGPSPoint(const GPSData& data, uint8_t source) {
   // Store speed (convert string to float)
   float speed = data.speed.toFloat();
   gpsLogPrefs.putFloat(keySpeed, speed);
+  gpsLogPrefs.putFloat(keyAcc, getGPSAccuracy(data));
   Serial.printf("📍 Storing GPS from data: index=%d, lat=%.7f, lon=%.7f, speed=%.2fkm/h, src=%d\n",
                 logIndex, lat, lon, speed, source);
   // Store 64-bit timestamp as two 32-bit values
@@ -394,9 +529,12 @@ bool logGPSPoint(const GPSData& data, uint8_t source) {
     logCount++;
   }
   
+  logSequence++;
+  
   // Save metadata
   gpsLogPrefs.putInt("logIndex", logIndex);
   gpsLogPrefs.putInt("logCount", logCount);
+  gpsLogPrefs.putULong("logSeq", logSequence);
   
   // Close preferences to ensure data is written before potential deep sleep
   gpsLogPrefs.end();
@@ -411,12 +549,13 @@ bool logGPSPoint(float lat, float lon, uint8_t source) {
   gpsLogPrefs.begin(GPS_LOG_NAMESPACE, false);
 
   // Create keys for this entry (use char buffers to avoid String heap fragmentation)
-  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12];
+  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12], keyAcc[12];
   char keyTimeHi[14], keyTimeLo[14];
   snprintf(keyLat, sizeof(keyLat), "lat_%d", logIndex);
   snprintf(keyLon, sizeof(keyLon), "lon_%d", logIndex);
   snprintf(keySpeed, sizeof(keySpeed), "spd_%d", logIndex);
   snprintf(keySrc, sizeof(keySrc), "src_%d", logIndex);
+  snprintf(keyAcc, sizeof(keyAcc), "acc_%d", logIndex);
   snprintf(keyTimeHi, sizeof(keyTimeHi), "timeH_%d", logIndex);
   snprintf(keyTimeLo, sizeof(keyTimeLo), "timeL_%d", logIndex);
 
@@ -424,6 +563,7 @@ bool logGPSPoint(float lat, float lon, uint8_t source) {
   gpsLogPrefs.putFloat(keyLat, lat);
   gpsLogPrefs.putFloat(keyLon, lon);
   gpsLogPrefs.putFloat(keySpeed, 0.0);  // Default speed for phone GPS
+  gpsLogPrefs.putFloat(keyAcc, 0.0);    // Accuracy not reported by the phone
 
   Serial.printf("📍 Storing GPS (no speed): index=%d, lat=%.7f, lon=%.7f, src=%d\n",
                 logIndex, lat, lon, source);
@@ -458,9 +598,12 @@ bool logGPSPoint(float lat, float lon, uint8_t source) {
     logCount++;
   }
   
+  logSequence++;
+  
   // Save metadata
   gpsLogPrefs.putInt("logIndex", logIndex);
   gpsLogPrefs.putInt("logCount", logCount);
+  gpsLogPrefs.putULong("logSeq", logSequence);
   
   // Close preferences to ensure data is written before potential deep sleep
   gpsLogPrefs.end();
@@ -496,8 +639,9 @@ bool getGPSLogEntry(int index, GPSLogEntry& entry) {
   }
   
   // Create keys for this entry (use char buffers to avoid String heap fragmentation)
-  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12];
+  char keyLat[12], keyLon[12], keySpeed[12], keySrc[12], keyAcc[12];
   char keyTimeHi[14], keyTimeLo[14];
+  snprintf(keyAcc, sizeof(keyAcc), "acc_%d", actualIndex);
   snprintf(keyLat, sizeof(keyLat), "lat_%d", actualIndex);
   snprintf(keyLon, sizeof(keyLon), "lon_%d", actualIndex);
   snprintf(keySpeed, sizeof(keySpeed), "spd_%d", actualIndex);
@@ -509,6 +653,7 @@ bool getGPSLogEntry(int index, GPSLogEntry& entry) {
   entry.lat = gpsLogPrefs.getFloat(keyLat, 0);
   entry.lon = gpsLogPrefs.getFloat(keyLon, 0);
   entry.speed = gpsLogPrefs.getFloat(keySpeed, 0);
+  entry.accuracy = gpsLogPrefs.getFloat(keyAcc, 0);
 
   // Debug logging
   Serial.printf("     Reading index %d -> actual %d: %s=%.7f, %s=%.7f\n",
@@ -635,6 +780,7 @@ String getGPSHistoryPageJSON(int page, int pointsPerPage) {
 void clearGPSHistory() {
   gpsLogPrefs.begin(GPS_LOG_NAMESPACE, false);
   gpsLogPrefs.clear();
+  gpsLogPrefs.putULong("logSeq", logSequence);  // Keep upload sequence numbers unique
   gpsLogPrefs.end();
   
   // Reset both RTC memory and NVS
@@ -642,4 +788,12 @@ void clearGPSHistory() {
   logCount = 0;
   
   Serial.println("📍 GPS History cleared");
-}
\ No newline at end of file
+}
+
+/*
+ * Get number of points ever logged
+ * The oldest stored entry has sequence number (sequence - count)
+ */
+uint32_t getGPSLogSequence() {
+  return logSequence;
+}
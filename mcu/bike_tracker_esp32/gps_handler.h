@@ -18,10 +18,28 @@ struct GPSData {
   String altitude;
   String speed;
   String course;
+  float hdop;          // Horizontal dilution of precision (0 = unknown)
+  float pdop;          // Position dilution of precision (0 = unknown)
+  uint8_t satellites;  // Satellites used in the fix
+  float accuracy;      // Horizontal accuracy in metres (0 = unknown)
+  uint32_t accuracyCm; // getGPSAccuracy() in cm, integer, set by parseGNSSData (0 = unknown)
   bool valid;
   uint64_t timestamp;  // Unix timestamp in milliseconds
 };
 
+// Fix accuracy model
+#define GPS_UERE_METERS         5.0f   // Typical user range error, accuracy = HDOP * UERE
+#define GPS_UERE_CM             500    // The same for the integer accuracy
+
+// Fix acceptance
+#define GPS_ACCEPT_HDOP         2.5f   // Acceptable fix: HDOP, PDOP and satellites used within these
+#define GPS_ACCEPT_PDOP         4.0f
+#define GPS_ACCEPT_SATELLITES   5
+#define GPS_REJECT_HDOP         10.0f  // Worse fixes are never used
+#define GPS_TARGET_ACCURACY_M   8.0f   // Stop improving once the fix is this accurate
+#define GPS_IMPROVE_WINDOW_MS   10000  // Keep polling for a better fix after the first acceptable one
+#define GPS_POLL_INTERVAL_MS    2000
+
 // GPS History Configuration
 #define MAX_GPS_HISTORY 30  // Maximum number of GPS points to store (reduced to save NVS space)
 #define GPS_LOG_NAMESPACE "gps-log"
@@ -31,14 +49,18 @@ struct GPSLogEntry {
   float lat;
   float lon;
   float speed;  // Speed in km/h
+  float accuracy;  // Metres, 0 = unknown
   uint64_t timestamp;  // Unix timestamp in milliseconds
   uint8_t source;  // 0=Phone, 1=SIM7070G
 };
 
 // GPS functions
 bool acquireGPSFix(GPSData& data, uint32_t maxAttempts = 60);
+bool getRejectedFix(GPSData& data);   // Last acquisition's fix if the plausibility check rejected it
 bool parseGNSSData(const String& gpsData, GPSData& data);
 bool requestGNSSInfo(String& response);
+float getGPSAccuracy(const GPSData& data);
+bool isAcceptableFix(const GPSData& data);
 
 // GPS data persistence
 void saveGPSData(const GPSData& data);
@@ -54,6 +76,7 @@ String getGPSHistoryJSON(int maxPoints = 10);
 String getGPSHistoryPageJSON(int page, int pointsPerPage = 7);  // New pagination function
 void clearGPSHistory();
 bool getGPSLogEntry(int index, GPSLogEntry& entry);
+uint32_t getGPSLogSequence();
 
 // Utility functions
 String formatGoogleMapsLink(const GPSData& data);
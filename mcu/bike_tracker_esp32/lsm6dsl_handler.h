@@ -110,6 +110,8 @@ public:
   
   // Get current acceleration data
   AccelData getAcceleration() { return currentAccel; }
+  AccelData getReference() { return referenceAccel; }
+  void setReference(const AccelData& reference) { referenceAccel = reference; }
   float getMotionDelta();
 };
 
@@ -0,0 +1,202 @@
+/*
+ * modem_recovery.cpp
+ *
+ * Implementation of the modem recovery policy
+ *
+ * Each error class has a first action: a plain error or timeout is
+ * retried, a mode error re-enters text mode, a network error
+ * re-registers, SIM errors need a reset. Consecutive failures escalate
+ * one step each, up to a PWRKEY power cycle and then giving up until
+ * something succeeds again. Memory errors (CME 20-23, CMS 320-322) mean
+ * full or broken message storage, which survives any reset, so they
+ * free the storage instead and never escalate. A refused SMS is not a
+ * modem fault, so it gets no recovery (the outbox retries it later).
+ *
+ * The time spent is bounded per window, so a wedged modem cannot burn
+ * the GNSS and SMS budget of a wake. Every recovery is logged and counted
+ * per action in RTC memory.
+ */
+
+#include "modem_recovery.h"
+#include "modem_sleep.h"
+#include "at_trace.h"
+#include <sys/time.h>
+
+// Counters (survive deep sleep)
+RTC_DATA_ATTR uint16_t recoveryCount[RECOVER_ACTION_COUNT] = {};
+RTC_DATA_ATTR uint16_t recoveryErrorCount[MODEM_ERR_COUNT] = {};
+
+// Escalation and time budget - the window runs on the RTC clock, so
+// deep sleep wakes (millis() restarts) share one budget
+RTC_DATA_ATTR uint32_t windowStartS = 0;
+RTC_DATA_ATTR uint32_t windowSpentMs = 0;
+static uint8_t consecutiveFailures = 0;
+static bool recovering = false;
+
+static const char* actionName(RecoveryAction action) {
+  switch (action) {
+    case RECOVER_RETRY:       return "retry";
+    case RECOVER_TEXT_MODE:   return "text mode";
+    case RECOVER_REREGISTER:  return "re-register";
+    case RECOVER_SOFT_RESET:  return "soft reset";
+    case RECOVER_POWER_CYCLE: return "power cycle";
+    case RECOVER_FREE_STORAGE: return "free storage";
+    default:                  return "give up";
+  }
+}
+
+/*
+ * First action for an error class
+ */
+static RecoveryAction firstAction(ModemError error) {
+  switch (error) {
+    case MODEM_ERR_NOT_ALLOWED:
+    case MODEM_ERR_SMS_MODE:     return RECOVER_TEXT_MODE;
+    case MODEM_ERR_NO_NETWORK:   return RECOVER_REREGISTER;
+    case MODEM_ERR_SIM:          return RECOVER_SOFT_RESET;
+    case MODEM_ERR_MEMORY:       return RECOVER_FREE_STORAGE;
+    case MODEM_ERR_SMS_REJECTED: return RECOVER_GIVE_UP;
+    default:                     return RECOVER_RETRY;
+  }
+}
+
+/*
+ * Delete every stored message and check there is room again
+ * "+CPMS: "SM",0,50,"SM",0,50,"SM",0,50"
+ */
+static bool freeMessageStorage() {
+  sendATCommand("AT+CMGF=1", "OK");
+  if (!sendATCommand("AT+CMGD=1,4", "OK", 5000)) return false;
+
+  clearSerialBuffer();
+  simSerial.println("AT+CPMS?");
+  beginATTrace("AT+CPMS?", sizeof("AT+CPMS?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  int tag = response.indexOf("+CPMS: ");
+  int used = response.indexOf(',', tag);
+  int total = response.indexOf(',', used + 1);
+  if (tag == -1 || used == -1 || total == -1) return false;
+
+  int usedCount = response.substring(used + 1).toInt();
+  int totalCount = response.substring(total + 1).toInt();
+  Serial.printf("🔧 Message storage %d/%d after delete\n", usedCount, totalCount);
+  return usedCount < totalCount;
+}
+
+/*
+ * Run one recovery action
+ *
+ * @return true if the module is usable again
+ */
+static bool runAction(RecoveryAction action) {
+  switch (action) {
+    case RECOVER_RETRY:
+      delay(500);
+      return isModuleReady();
+
+    case RECOVER_TEXT_MODE:
+      simSerial.write(27);  // Leave any pending prompt
+      delay(100);
+      clearSerialBuffer();
+      return sendATCommand("AT+CMGF=1", "OK") && sendATCommand("AT+CSMP=17,167,0,0", "OK");
+
+    case RECOVER_REREGISTER:
+      disableRF();
+      enableRF();
+      return isNetworkRegistered();
+
+    case RECOVER_SOFT_RESET:
+      if (!resetModule()) return false;
+      invalidateModemSession();
+      return initializeSIM7070G();
+
+    case RECOVER_POWER_CYCLE:
+      powerOffModem();
+      invalidateModemSession();
+      return initializeSIM7070G();
+
+    case RECOVER_FREE_STORAGE:
+      return freeMessageStorage();
+
+    default:
+      return false;
+  }
+}
+
+/*
+ * Try to clear a modem error
+ * The action is the error's first action or, after repeated failures,
+ * the next step of the ladder, whichever is stronger.
+ *
+ * @return true if the failed operation is worth another try
+ */
+bool recoverModem(ModemError error) {
+  if (recovering || error == MODEM_ERR_NONE) return false;
+
+  uint32_t now = millis();
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  uint32_t clockS = tv.tv_sec;
+  if (clockS - windowStartS > MODEM_RECOVERY_WINDOW_MS / 1000) {
+    windowStartS = clockS;
+    windowSpentMs = 0;
+  }
+  if (windowSpentMs >= MODEM_RECOVERY_BUDGET_MS) {
+    Serial.println("🔧 Modem recovery budget spent - giving up");
+    return false;
+  }
+
+  // Storage errors keep their action (resets cannot clear them) and give
+  // up once freeing did not help
+  RecoveryAction action = firstAction(error);
+  RecoveryAction ladder = (RecoveryAction)min((int)consecutiveFailures, (int)RECOVER_GIVE_UP);
+  if (action == RECOVER_FREE_STORAGE) {
+    if (consecutiveFailures >= 2) action = RECOVER_GIVE_UP;
+  } else if (ladder > action) {
+    action = ladder;
+  }
+
+  recoveryErrorCount[error]++;
+  if (action == RECOVER_GIVE_UP) {
+    Serial.printf("🔧 No recovery for %s error (code %d)\n", modemErrorName(error), getLastModemErrorCode());
+    return false;
+  }
+
+  consecutiveFailures++;
+  recoveryCount[action]++;
+  Serial.printf("🔧 Recovery #%u: %s for %s error (code %d)\n",
+                recoveryCount[action], actionName(action), modemErrorName(error), getLastModemErrorCode());
+
+  recovering = true;
+  bool ok = runAction(action);
+  recovering = false;
+
+  uint32_t elapsed = millis() - now;
+  windowSpentMs += elapsed;
+  Serial.printf("🔧 Recovery %s in %lu ms\n", ok ? "succeeded" : "failed", elapsed);
+  return ok;
+}
+
+/*
+ * Operation succeeded - restart the escalation ladder
+ */
+void resetModemRecovery() {
+  consecutiveFailures = 0;
+}
+
+/*
+ * Print recovery counters
+ */
+void printModemRecovery() {
+  Serial.println("\nModem recovery:");
+  for (int a = 0; a < RECOVER_ACTION_COUNT; a++) {
+    if (a == RECOVER_GIVE_UP) continue;
+    Serial.printf("  %-12s %u\n", actionName((RecoveryAction)a), recoveryCount[a]);
+  }
+  Serial.print("  Errors:");
+  for (int e = MODEM_ERR_TIMEOUT; e < MODEM_ERR_COUNT; e++) {
+    if (recoveryErrorCount[e]) Serial.printf(" %s=%u", modemErrorName((ModemError)e), recoveryErrorCount[e]);
+  }
+  Serial.printf("\n  Budget used: %lu / %u ms\n", windowSpentMs, MODEM_RECOVERY_BUDGET_MS);
+}
@@ -0,0 +1,37 @@
+/*
+ * modem_recovery.h
+ *
+ * Recovery policy for modem errors
+ * Maps a typed error to the cheapest action that can clear it, escalates
+ * on repeated failures (retry, text mode, re-register, soft reset, power
+ * cycle) and bounds the time spent recovering. Full message storage is
+ * freed instead, since no reset clears it.
+ */
+
+#ifndef MODEM_RECOVERY_H
+#define MODEM_RECOVERY_H
+
+#include <Arduino.h>
+#include "sim7070g.h"
+
+#define MODEM_RECOVERY_BUDGET_MS   90000    // Max recovery time per window
+#define MODEM_RECOVERY_WINDOW_MS   600000   // Budget window (10 min)
+
+// Recovery actions, cheapest first
+enum RecoveryAction : uint8_t {
+  RECOVER_RETRY,        // Check module answers and retry
+  RECOVER_TEXT_MODE,    // Leave any prompt, re-enter SMS text mode
+  RECOVER_REREGISTER,   // CFUN=0/1 cycle and wait for registration
+  RECOVER_SOFT_RESET,   // AT+CFUN=1,1 and full init
+  RECOVER_POWER_CYCLE,  // PWRKEY off/on and full init
+  RECOVER_GIVE_UP,
+  RECOVER_FREE_STORAGE, // Delete stored messages (memory errors, outside the ladder)
+  RECOVER_ACTION_COUNT
+};
+
+// Recovery
+bool recoverModem(ModemError error);
+void resetModemRecovery();
+void printModemRecovery();
+
+#endif // MODEM_RECOVERY_H
@@ -0,0 +1,395 @@
+/*
+ * modem_sleep.cpp
+ *
+ * Implementation of the SIM7070G sleep-mode manager
+ *
+ * With AT+CFUN=0 every report pays a full network attach. PSM (AT+CPSMS)
+ * and eDRX (AT+CEDRX) keep the EPS context in the network: the module
+ * stays registered while the ESP32 sleeps and only needs its UART woken.
+ * Between sessions DTR is held high with AT+CSCLK=1 so the UART can
+ * sleep; on wake DTR goes low, and if the module is in PSM and does not
+ * answer, a PWRKEY pulse brings it out.
+ *
+ * The network may ignore or shorten the requested timers, so the granted
+ * values are read back (AT+CEREG=4, AT+CEDRXRDP) before a mode is used.
+ * GNSS runs while LTE is idle in PSM/eDRX, so no CFUN=0 is needed for a fix.
+ *
+ * For sparse reports even CFUN=0 or PSM idle current adds up, so the
+ * power policy compares the charge of one report cycle per mode - sleep
+ * current over the interval plus resume (and for full-off, boot) time at
+ * active current, and for full-off the longer cold GNSS start - and uses
+ * the cheapest. The GNSS layer is told about every power-off so it does
+ * not request a hot start the receiver can no longer do. After a full power-off the
+ * ESP32 wakes early by the measured boot time so reports stay on schedule.
+ */
+
+#include "modem_sleep.h"
+#include "sim7070g.h"
+#include "at_trace.h"
+#include "gnss_profile.h"
+#include "gnss_budget.h"
+#include "driver/gpio.h"
+
+// Negotiated and selected modes (survive deep sleep)
+RTC_DATA_ATTR ModemSleepMode modemNetworkMode = SLEEP_MODE_CFUN;  // Best mode the network granted
+RTC_DATA_ATTR ModemSleepMode modemSleepMode = SLEEP_MODE_CFUN;    // Mode used between sessions
+RTC_DATA_ATTR uint16_t modemSleepInterval = 0;   // Report interval the timers were negotiated for
+RTC_DATA_ATTR bool modemPoweredOff = false;
+RTC_DATA_ATTR uint32_t modemBootMs = 0;          // Power on to AT ready (EWMA)
+
+// Attach statistics per mode (EWMA, ms)
+RTC_DATA_ATTR uint32_t modemAttachMs[SLEEP_MODE_COUNT] = {};
+RTC_DATA_ATTR uint16_t modemAttachCount[SLEEP_MODE_COUNT] = {};
+
+static const char* modeName(ModemSleepMode mode) {
+  switch (mode) {
+    case SLEEP_MODE_PSM:  return "PSM";
+    case SLEEP_MODE_EDRX: return "eDRX";
+    case SLEEP_MODE_POWEROFF: return "OFF";
+    default:              return "CFUN=0";
+  }
+}
+
+static void updateAverage(uint32_t& avg, uint32_t sample) {
+  avg = (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+/*
+ * Expected time from wake to network ready for a mode (ms)
+ */
+static uint32_t resumeEstimate(ModemSleepMode mode) {
+  uint32_t attach = modemAttachMs[mode];
+  if (attach == 0) {
+    attach = (mode == SLEEP_MODE_EDRX || mode == SLEEP_MODE_PSM) ?
+             MODEM_DEFAULT_RESUME_MS : MODEM_DEFAULT_ATTACH_MS;
+  }
+  if (mode == SLEEP_MODE_POWEROFF) {
+    attach += modemBootMs ? modemBootMs : MODEM_DEFAULT_BOOT_MS;
+  }
+  return attach;
+}
+
+/*
+ * Estimated module charge of one report cycle (uA * ms)
+ * Full-off also pays the cold GNSS start of the next report
+ */
+static uint64_t cycleCharge(ModemSleepMode mode, uint32_t cycleMs) {
+  static const uint32_t SLEEP_UA[SLEEP_MODE_COUNT] = {
+    MODEM_CFUN0_UA, MODEM_EDRX_UA, MODEM_PSM_UA, MODEM_POWEROFF_UA
+  };
+  uint32_t active = min(resumeEstimate(mode), cycleMs);
+  uint64_t charge = (uint64_t)active * MODEM_ACTIVE_UA + (uint64_t)(cycleMs - active) * SLEEP_UA[mode];
+  if (mode == SLEEP_MODE_POWEROFF) {
+    charge += (uint64_t)getGNSSColdPenaltyMs(cycleMs / 1000) * MODEM_GNSS_UA;
+  }
+  return charge;
+}
+
+/*
+ * Pick the cheapest mode for the interval among CFUN=0, full-off and
+ * whatever the network granted
+ */
+static ModemSleepMode selectPowerMode(uint16_t reportIntervalSec) {
+  uint32_t cycleMs = reportIntervalSec * 1000UL;
+  ModemSleepMode best = SLEEP_MODE_CFUN;
+
+  const ModemSleepMode candidates[] = {SLEEP_MODE_POWEROFF, modemNetworkMode};
+  for (ModemSleepMode mode : candidates) {
+    if (cycleCharge(mode, cycleMs) < cycleCharge(best, cycleMs)) best = mode;
+  }
+  return best;
+}
+
+/*
+ * Drive DTR, holding the level through ESP32 deep sleep
+ */
+static void setDTR(bool sleepAllowed) {
+  gpio_hold_dis((gpio_num_t)MODEM_DTR_PIN);
+  pinMode(MODEM_DTR_PIN, OUTPUT);
+  digitalWrite(MODEM_DTR_PIN, sleepAllowed ? HIGH : LOW);
+  if (sleepAllowed) {
+    gpio_hold_en((gpio_num_t)MODEM_DTR_PIN);
+    gpio_deep_sleep_hold_en();
+  }
+}
+
+/*
+ * Pull PWRKEY low for the given time
+ * Both press lengths stay below the 1.2 s power-off press, the PSM wake
+ * one by a wide margin since the module may already be running
+ */
+static void pulsePWRKEY(uint32_t lowMs) {
+  pinMode(MODEM_PWRKEY_PIN, OUTPUT);
+  digitalWrite(MODEM_PWRKEY_PIN, HIGH);
+  delay(lowMs);
+  digitalWrite(MODEM_PWRKEY_PIN, LOW);
+}
+
+/*
+ * Encode a period as a GPRS Timer 3 value (periodic TAU, T3412)
+ * Picks the finest unit whose 5-bit value covers the period
+ */
+static void encodeTAU(uint32_t seconds, char* out) {
+  static const struct { uint8_t unit; uint32_t step; } units[] = {
+    {0b011, 2}, {0b100, 30}, {0b101, 60}, {0b000, 600},
+    {0b001, 3600}, {0b010, 36000}, {0b110, 1152000}
+  };
+
+  uint8_t bits = 0b11011111;  // 320 h * 31 if nothing smaller fits
+  for (const auto& u : units) {
+    uint32_t value = (seconds + u.step - 1) / u.step;
+    if (value <= 31) {
+      bits = (u.unit << 5) | value;
+      break;
+    }
+  }
+
+  for (int i = 0; i < 8; i++) {
+    out[i] = (bits & (0x80 >> i)) ? '1' : '0';
+  }
+  out[8] = '\0';
+}
+
+/*
+ * Request PSM and check the network granted an active time
+ * "+CEREG: 4,1,"5A1E","0B28ABBC",7,,,"00000001","00100011""
+ */
+static bool negotiatePSM(uint16_t reportIntervalSec) {
+  // TAU past the report interval so the module does not wake in between
+  char tau[9];
+  encodeTAU(reportIntervalSec + reportIntervalSec / 2, tau);
+
+  char cmd[48];
+  snprintf(cmd, sizeof(cmd), "AT+CPSMS=1,,,\"%s\",\"%s\"", tau, MODEM_PSM_ACTIVE_TIME);
+  if (!sendATCommand(cmd, "OK")) return false;
+  if (!sendATCommand("AT+CEREG=4", "OK")) return false;
+
+  clearSerialBuffer();
+  simSerial.println("AT+CEREG?");
+  beginATTrace("AT+CEREG?", sizeof("AT+CEREG?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+  sendATCommand("AT+CEREG=0", "OK");
+
+  int tag = response.indexOf("+CEREG: ");
+  if (tag == -1) return false;
+
+  // Active time is the 8th field, the 3rd quoted string (after TAC and CI),
+  // so its value starts after the 5th quote
+  int quote = tag;
+  for (int i = 0; i < 5 && quote != -1; i++) {
+    quote = response.indexOf('"', quote + 1);
+  }
+  if (quote == -1) return false;
+
+  String activeTime = response.substring(quote + 1, quote + 9);
+  bool granted = activeTime.length() == 8 && !activeTime.startsWith("111");
+  Serial.printf("💤 PSM requested TAU %s, network active time %s\n",
+                tau, granted ? activeTime.c_str() : "none");
+  return granted;
+}
+
+/*
+ * Request eDRX and check the network provided a cycle
+ * "+CEDRXRDP: 4,"1001","1001","0011""
+ */
+static bool negotiateEDRX() {
+  char cmd[32];
+  snprintf(cmd, sizeof(cmd), "AT+CEDRX=1,4,\"%s\"", MODEM_EDRX_CYCLE);
+  if (!sendATCommand(cmd, "OK")) return false;
+
+  clearSerialBuffer();
+  simSerial.println("AT+CEDRXRDP");
+  beginATTrace("AT+CEDRXRDP", sizeof("AT+CEDRXRDP") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  int tag = response.indexOf("+CEDRXRDP: ");
+  if (tag == -1 || response.substring(tag + 11).toInt() == 0) return false;
+
+  // Network-provided cycle is the second quoted value
+  int quote = response.indexOf('"', tag);
+  for (int i = 0; i < 2 && quote != -1; i++) {
+    quote = response.indexOf('"', quote + 1);
+  }
+  if (quote == -1 || response.charAt(quote + 1) == '"') return false;
+
+  Serial.printf("💤 eDRX granted, cycle %s\n", response.substring(quote + 1, quote + 5).c_str());
+  return true;
+}
+
+/*
+ * Negotiate timers and select the sleep mode for a report interval
+ * Only talks to the network when the interval changed since the last
+ * negotiation (or the module was powered off). Long intervals try PSM
+ * first, short ones eDRX. The power policy then picks the cheapest mode.
+ *
+ * @return mode used between the following sessions
+ */
+ModemSleepMode configureModemSleep(uint16_t reportIntervalSec) {
+  if (reportIntervalSec != modemSleepInterval) {
+    ModemSleepMode granted = SLEEP_MODE_CFUN;
+    if (reportIntervalSec >= MODEM_PSM_MIN_INTERVAL && negotiatePSM(reportIntervalSec)) {
+      granted = SLEEP_MODE_PSM;
+    } else {
+      sendATCommand("AT+CPSMS=0", "OK");
+      if (negotiateEDRX()) {
+        granted = SLEEP_MODE_EDRX;
+      } else {
+        sendATCommand("AT+CEDRX=0", "OK");
+      }
+    }
+    modemNetworkMode = granted;
+    modemSleepInterval = reportIntervalSec;
+  }
+
+  ModemSleepMode mode = selectPowerMode(reportIntervalSec);
+  if (mode != modemSleepMode) {
+    // Transitions behave differently per mode - relearn them
+    resetModemTransitionEstimates();
+    Serial.printf("💤 Modem sleep mode: %s for %us reports (network allows %s)\n",
+                  modeName(mode), reportIntervalSec, modeName(modemNetworkMode));
+  }
+
+  modemSleepMode = mode;
+  return mode;
+}
+
+/*
+ * Get negotiated sleep mode
+ */
+ModemSleepMode getModemSleepMode() {
+  return modemSleepMode;
+}
+
+/*
+ * Check if the module stays attached between sessions
+ */
+bool isModemSleepEnabled() {
+  return modemSleepMode == SLEEP_MODE_EDRX || modemSleepMode == SLEEP_MODE_PSM;
+}
+
+/*
+ * Let the module sleep while staying registered
+ * GNSS must already be off
+ */
+bool enterModemSleep() {
+  if (!isModemSleepEnabled()) return false;
+
+  if (!sendATCommand("AT+CSCLK=1", "OK")) {
+    Serial.println("❌ Failed to enable modem slow clock");
+    return false;
+  }
+  setDTR(true);
+  Serial.printf("💤 Modem sleeping in %s, still attached\n", modeName(modemSleepMode));
+  return true;
+}
+
+/*
+ * Switch the module fully off until the next wake
+ * Normal power down detaches from the network; PWRKEY is the fallback
+ */
+bool powerOffModem() {
+  if (!sendATCommand("AT+CPOWD=1", "NORMAL POWER DOWN", 5000)) {
+    Serial.println("⚠️ AT+CPOWD failed - holding PWRKEY");
+    pinMode(MODEM_PWRKEY_PIN, OUTPUT);
+    digitalWrite(MODEM_PWRKEY_PIN, HIGH);
+    delay(MODEM_PWRKEY_OFF_MS);
+    digitalWrite(MODEM_PWRKEY_PIN, LOW);
+  }
+
+  modemPoweredOff = true;
+  modemSleepInterval = 0;  // Renegotiate timers after the next boot
+  noteGNSSPowerLoss();
+  Serial.println("💤 Modem powered off");
+  return true;
+}
+
+/*
+ * Check if the module was switched off by powerOffModem()
+ */
+bool isModemPoweredOff() {
+  return modemPoweredOff;
+}
+
+/*
+ * Power the module on and learn its boot time
+ */
+static bool powerOnModem() {
+  uint32_t start = millis();
+  pulsePWRKEY(MODEM_PWRKEY_ON_MS);
+
+  // Module boots at the rate saved with AT&W
+  while (millis() - start < MODEM_BOOT_TIMEOUT_MS) {
+    if (sendATCommand("AT", "OK", 500)) {
+      uint32_t elapsed = millis() - start;
+      updateAverage(modemBootMs, elapsed);
+      modemPoweredOff = false;
+      Serial.printf("💤 Modem powered on in %lu ms\n", elapsed);
+      return true;
+    }
+  }
+
+  if (!probeModemLink()) return false;
+  modemPoweredOff = false;
+  return true;
+}
+
+/*
+ * Wake the module UART and, if it is in PSM or off, the module itself
+ *
+ * @return true if the module answers AT
+ */
+bool wakeModem() {
+  setDTR(false);
+  if (modemPoweredOff) return powerOnModem();
+  delay(50);
+
+  // Saved rate only - silence here is usually PSM, not a rate change
+  for (int i = 0; i < MODEM_WAKE_PROBES; i++) {
+    if (probeModemLink(false)) return true;
+  }
+
+  Serial.println("💤 Modem not answering - pulsing PWRKEY");
+  pulsePWRKEY(MODEM_PWRKEY_WAKE_MS);
+  for (int i = 0; i < MODEM_WAKE_PROBES * 2; i++) {
+    delay(500);
+    if (probeModemLink(false)) return true;
+  }
+
+  // Awake but silent at the saved rate - it may have restarted at another
+  return probeModemLink(true);
+}
+
+/*
+ * ESP32 wake lead time so the module is ready at the report time
+ * Only a powered-off module needs it; the other modes resume within
+ * the session estimate.
+ */
+uint32_t getModemWakeLeadMs() {
+  if (modemSleepMode != SLEEP_MODE_POWEROFF) return 0;
+  return modemBootMs ? modemBootMs : MODEM_DEFAULT_BOOT_MS;
+}
+
+/*
+ * Record time from session start to network ready for the active mode
+ */
+void recordModemAttach(uint32_t attachMs) {
+  updateAverage(modemAttachMs[modemSleepMode], attachMs);
+  if (modemAttachCount[modemSleepMode] < UINT16_MAX) modemAttachCount[modemSleepMode]++;
+}
+
+/*
+ * Print attach time and estimated average module current per report
+ * cycle for each mode that has been measured
+ */
+void printModemSleepStats(uint16_t reportIntervalSec) {
+  uint32_t cycleMs = reportIntervalSec * 1000UL;
+
+  Serial.printf("\nModem sleep: %s (network allows %s, boot %lu ms)\n",
+                modeName(modemSleepMode), modeName(modemNetworkMode), modemBootMs);
+  for (int m = 0; m < SLEEP_MODE_COUNT; m++) {
+    ModemSleepMode mode = (ModemSleepMode)m;
+    Serial.printf("  %-6s: resume %lu ms (%u cycles measured), ~%lu uA average over %us\n",
+                  modeName(mode), resumeEstimate(mode), modemAttachCount[m],
+                  (unsigned long)(cycleCharge(mode, cycleMs) / cycleMs), reportIntervalSec);
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * modem_sleep.h
+ *
+ * SIM7070G sleep-mode manager
+ * Negotiates PSM or eDRX timers with the network so the module stays
+ * attached while the ESP32 is in deep sleep, and wakes it over DTR /
+ * PWRKEY for reports. Falls back to AT+CFUN=0 when the network grants
+ * neither. Attach time and estimated current per report cycle are kept
+ * per mode, and the power policy uses them to pick between staying
+ * attached, CFUN=0 and switching the module fully off.
+ */
+
+#ifndef MODEM_SLEEP_H
+#define MODEM_SLEEP_H
+
+#include <Arduino.h>
+
+// Control pins (free GPIOs on the ESP32-C3 SuperMini)
+#define MODEM_DTR_PIN             10    // Low = UART awake, high = slow clock sleep allowed
+#define MODEM_PWRKEY_PIN          3     // Drives PWRKEY through an NPN (high = PWRKEY low)
+#define MODEM_PWRKEY_ON_MS        1000  // PWRKEY low time that powers on (datasheet Ton min)
+#define MODEM_PWRKEY_WAKE_MS      300   // PWRKEY low time that wakes from PSM, far from power-off
+#define MODEM_PWRKEY_OFF_MS       1500  // PWRKEY low time that powers off (>= 1.2 s)
+#define MODEM_WAKE_PROBES         3     // AT probes before pulsing PWRKEY
+#define MODEM_BOOT_TIMEOUT_MS     10000 // Power on to first AT response
+
+// Requested timers
+#define MODEM_PSM_ACTIVE_TIME     "00000001"  // T3324: 2 s of paging after each session
+#define MODEM_EDRX_CYCLE          "1001"      // 163.84 s (LTE-M)
+#define MODEM_PSM_MIN_INTERVAL    300         // Shorter report intervals use eDRX (s)
+
+// Estimated module current per state (uA) for the cycle energy model
+#define MODEM_ACTIVE_UA           80000  // Attach / registration
+#define MODEM_CFUN0_UA            700
+#define MODEM_EDRX_UA             250
+#define MODEM_PSM_UA              9
+#define MODEM_POWEROFF_UA         1      // Leakage with the module off
+#define MODEM_GNSS_UA             30000  // GNSS searching (cold-start penalty after full-off)
+
+// Resume time estimates before anything was measured (ms)
+#define MODEM_DEFAULT_ATTACH_MS   6000   // CFUN=0 -> registered
+#define MODEM_DEFAULT_RESUME_MS   1500   // PSM/eDRX -> registered
+#define MODEM_DEFAULT_BOOT_MS     5000   // Power on -> AT ready
+
+enum ModemSleepMode : uint8_t {
+  SLEEP_MODE_CFUN,   // AT+CFUN=0 between sessions, full re-attach on wake
+  SLEEP_MODE_EDRX,   // Attached, paging every eDRX cycle
+  SLEEP_MODE_PSM,    // Attached, unreachable until TAU or PWRKEY wake
+  SLEEP_MODE_POWEROFF,  // Module off (AT+CPOWD), boot and attach on wake
+  SLEEP_MODE_COUNT
+};
+
+// Sleep-mode negotiation (call with RF enabled and registered)
+ModemSleepMode configureModemSleep(uint16_t reportIntervalSec);
+ModemSleepMode getModemSleepMode();
+bool isModemSleepEnabled();
+
+// Sleep and wake (called by setModemState / initializeSIM7070G)
+bool enterModemSleep();
+bool powerOffModem();
+bool isModemPoweredOff();
+bool wakeModem();
+uint32_t getModemWakeLeadMs();
+
+// Attach statistics
+void recordModemAttach(uint32_t attachMs);
+void printModemSleepStats(uint16_t reportIntervalSec);
+
+#endif // MODEM_SLEEP_H
@@ -0,0 +1,204 @@
+/*
+ * modem_transcript.cpp
+ *
+ * Implementation of the UART transcript recorder
+ *
+ * Bytes are staged in RAM and coalesced into records while the
+ * direction stays the same and the line is not quiet for longer than
+ * TRANSCRIPT_GAP_MS. The staging buffer is written to flash when it is
+ * full and before deep sleep. The write offset survives deep sleep; after
+ * a cold boot the end of the transcript is found by walking the records.
+ */
+
+#include "modem_transcript.h"
+#include <esp_partition.h>
+
+#define TRANSCRIPT_HEADER_LEN  6
+#define TRANSCRIPT_SECTOR      4096
+
+// Write position (survives deep sleep)
+RTC_DATA_ATTR uint32_t transcriptOffset = 0;
+RTC_DATA_ATTR uint32_t transcriptErasedTo = 0;  // Flash erased up to here
+RTC_DATA_ATTR uint32_t transcriptWake = 0;
+RTC_DATA_ATTR bool transcriptFull = false;
+
+static const esp_partition_t* partition = nullptr;
+static bool started = false;
+
+static uint8_t staging[TRANSCRIPT_BUFFER_SIZE];
+static size_t stagingLen = 0;
+static int openRecord = -1;       // Offset of the record being extended
+static uint32_t lastByteMs = 0;
+
+/*
+ * Find the end of an existing transcript (cold boot)
+ */
+static uint32_t findTranscriptEnd() {
+  uint32_t offset = 0;
+  uint8_t header[TRANSCRIPT_HEADER_LEN];
+
+  while (offset + TRANSCRIPT_HEADER_LEN <= partition->size) {
+    if (esp_partition_read(partition, offset, header, sizeof(header)) != ESP_OK) break;
+    bool known = header[0] == TRANSCRIPT_TX || header[0] == TRANSCRIPT_RX || header[0] == TRANSCRIPT_WAKE;
+    if (!known || header[1] == 0) break;
+    offset += TRANSCRIPT_HEADER_LEN + header[1];
+  }
+  return offset;
+}
+
+/*
+ * Locate the partition and mark the wake, once per boot
+ */
+static bool startTranscript() {
+  if (!MODEM_TRANSCRIPT) return false;
+  if (started) return partition != nullptr;
+  started = true;
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                       TRANSCRIPT_PARTITION_LABEL);
+  if (!partition) {
+    Serial.println("⚠️ Transcript partition not found - recording disabled");
+    return false;
+  }
+
+  if (transcriptOffset == 0 && transcriptErasedTo == 0) {
+    transcriptOffset = findTranscriptEnd();
+    // Erased space after the last record ends at the next sector boundary
+    transcriptErasedTo = (transcriptOffset + TRANSCRIPT_SECTOR - 1) / TRANSCRIPT_SECTOR * TRANSCRIPT_SECTOR;
+  }
+
+  transcriptWake++;
+  uint8_t wake[4];
+  memcpy(wake, &transcriptWake, sizeof(wake));
+  recordTranscript(TRANSCRIPT_WAKE, wake, sizeof(wake));
+  return true;
+}
+
+/*
+ * Write the staged records to flash
+ */
+void flushModemTranscript() {
+  openRecord = -1;
+  if (stagingLen == 0 || !partition) return;
+
+  if (transcriptOffset + stagingLen > partition->size) {
+    if (!transcriptFull) Serial.println("⚠️ Transcript partition full - recording stopped");
+    transcriptFull = true;
+  } else {
+    while (transcriptErasedTo < transcriptOffset + stagingLen) {
+      esp_partition_erase_range(partition, transcriptErasedTo, TRANSCRIPT_SECTOR);
+      transcriptErasedTo += TRANSCRIPT_SECTOR;
+    }
+    esp_partition_write(partition, transcriptOffset, staging, stagingLen);
+    transcriptOffset += stagingLen;
+  }
+  stagingLen = 0;
+}
+
+/*
+ * Start a record in the staging buffer
+ */
+static void startRecord(uint8_t type, uint32_t now) {
+  if (stagingLen + TRANSCRIPT_HEADER_LEN + 1 > TRANSCRIPT_BUFFER_SIZE) flushModemTranscript();
+  openRecord = stagingLen;
+  staging[stagingLen++] = type;
+  staging[stagingLen++] = 0;
+  memcpy(&staging[stagingLen], &now, 4);
+  stagingLen += 4;
+}
+
+/*
+ * Append bytes, extending the open record while direction and timing allow
+ */
+void recordTranscript(uint8_t type, const uint8_t* data, size_t len) {
+  if (transcriptFull || !startTranscript()) return;
+  uint32_t now = millis();
+
+  if (type == TRANSCRIPT_WAKE) {
+    startRecord(type, now);
+    memcpy(&staging[stagingLen], data, len);
+    staging[openRecord + 1] = len;
+    stagingLen += len;
+    openRecord = -1;
+    return;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    bool extend = openRecord >= 0 && staging[openRecord] == type &&
+                  staging[openRecord + 1] < 255 && now - lastByteMs <= TRANSCRIPT_GAP_MS &&
+                  stagingLen < TRANSCRIPT_BUFFER_SIZE;
+    if (!extend) startRecord(type, now);
+
+    staging[stagingLen++] = data[i];
+    staging[openRecord + 1]++;
+  }
+  lastByteMs = now;
+}
+
+int TranscriptSerial::read() {
+  int c = HardwareSerial::read();
+  if (c >= 0) {
+    uint8_t b = c;
+    recordTranscript(TRANSCRIPT_RX, &b, 1);
+  }
+  return c;
+}
+
+size_t TranscriptSerial::write(uint8_t c) {
+  recordTranscript(TRANSCRIPT_TX, &c, 1);
+  return HardwareSerial::write(c);
+}
+
+size_t TranscriptSerial::write(const uint8_t* buffer, size_t size) {
+  recordTranscript(TRANSCRIPT_TX, buffer, size);
+  return HardwareSerial::write(buffer, size);
+}
+
+/*
+ * Print recorder state
+ */
+void printModemTranscript() {
+  if (!MODEM_TRANSCRIPT) {
+    Serial.println("\nTranscript recording not compiled in (MODEM_TRANSCRIPT = 0)");
+    return;
+  }
+  if (!startTranscript()) return;
+
+  Serial.printf("\nTranscript: %lu of %lu bytes used (+%u staged), wake %lu%s\n",
+                transcriptOffset, partition->size, stagingLen, transcriptWake,
+                transcriptFull ? ", FULL" : "");
+}
+
+/*
+ * Dump the transcript as hex lines for transcript_replay.py:
+ *   MTR <offset> <hex bytes>
+ */
+void dumpModemTranscript() {
+  if (!startTranscript()) return;
+  flushModemTranscript();
+
+  uint8_t chunk[32];
+  for (uint32_t offset = 0; offset < transcriptOffset; offset += sizeof(chunk)) {
+    size_t n = min((uint32_t)sizeof(chunk), transcriptOffset - offset);
+    esp_partition_read(partition, offset, chunk, n);
+    Serial.printf("MTR %06lx ", offset);
+    for (size_t i = 0; i < n; i++) Serial.printf("%02x", chunk[i]);
+    Serial.println();
+  }
+  Serial.println("MTR end");
+}
+
+/*
+ * Erase the partition and start a new transcript
+ */
+void clearModemTranscript() {
+  if (!startTranscript()) return;
+
+  Serial.println("🧹 Erasing transcript partition...");
+  esp_partition_erase_range(partition, 0, partition->size);
+  transcriptOffset = 0;
+  transcriptErasedTo = partition->size;
+  transcriptFull = false;
+  stagingLen = 0;
+  openRecord = -1;
+}
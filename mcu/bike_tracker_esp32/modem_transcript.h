@@ -0,0 +1,57 @@
+/*
+ * modem_transcript.h
+ *
+ * UART transcript recorder
+ * Optionally records every byte on simSerial, with millisecond
+ * timestamps, to a flash partition. Field sessions (slow +CMGS,
+ * registration flaps, CGNSINF without fix) can then be replayed against
+ * the firmware at the desk with mcu/tools/transcript_replay.py.
+ *
+ * Flash layout, records back to back from the partition start:
+ *   0  type  (TRANSCRIPT_TX, TRANSCRIPT_RX, TRANSCRIPT_WAKE, 0xFF = end)
+ *   1  payload length (1..255)
+ *   2  millis() of the first byte (uint32, little endian)
+ *   6  payload (UART bytes, or the wake number for TRANSCRIPT_WAKE)
+ * Recording stops when the partition is full.
+ */
+
+#ifndef MODEM_TRANSCRIPT_H
+#define MODEM_TRANSCRIPT_H
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+#define MODEM_TRANSCRIPT              0         // 1 = record simSerial traffic (debug builds)
+#define TRANSCRIPT_PARTITION_LABEL    "spiffs"  // Unused by the sketch in the default partition table
+#define TRANSCRIPT_BUFFER_SIZE        1024      // RAM staging before a flash write
+#define TRANSCRIPT_GAP_MS             2         // Quiet time that starts a new record
+
+#define TRANSCRIPT_TX    'T'   // Firmware -> modem
+#define TRANSCRIPT_RX    'R'   // Modem -> firmware
+#define TRANSCRIPT_WAKE  'W'   // Boot or deep sleep wake, millis() restarts
+
+/*
+ * HardwareSerial that copies its traffic to the transcript
+ * simSerial is of this type when MODEM_TRANSCRIPT is enabled
+ */
+class TranscriptSerial : public HardwareSerial {
+  public:
+    using HardwareSerial::HardwareSerial;
+    using HardwareSerial::read;
+    using HardwareSerial::write;
+
+    int read() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+};
+
+// Recording
+void recordTranscript(uint8_t type, const uint8_t* data, size_t len);
+void flushModemTranscript();
+
+// Maintenance
+void printModemTranscript();
+void dumpModemTranscript();
+void clearModemTranscript();
+
+#endif // MODEM_TRANSCRIPT_H
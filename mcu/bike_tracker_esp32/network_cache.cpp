@@ -0,0 +1,237 @@
+/*
+ * network_cache.cpp
+ *
+ * Implementation of the cached network configuration
+ *
+ * A cold attach scans every band of both LTE-M and NB-IoT. After a
+ * successful registration the serving RAT, band and PLMN are read from
+ * AT+CPSI? and kept in NVS. Later attaches set AT+CMNB and AT+CBANDCFG
+ * to just those before AT+CFUN=1. The restricted attach gets a short
+ * wait (a few times its usual time); if it does not register, the same
+ * enableRF() call searches all RATs and bands again and relearns.
+ *
+ * Operator selection stays automatic (AT+COPS=0): a manual AT+COPS can
+ * block for minutes when the PLMN is absent. The cached PLMN is checked
+ * after each attach instead, and a change of operator relearns the cache.
+ *
+ * Time-to-registration is averaged separately for restricted and wide
+ * attaches so the gain can be compared.
+ */
+
+#include "network_cache.h"
+#include "sim7070g.h"
+#include "at_trace.h"
+#include <Preferences.h>
+
+// Attach configuration applied to the module
+enum AttachScope : uint8_t {
+  SCOPE_UNKNOWN,      // Module defaults, never configured
+  SCOPE_RESTRICTED,   // Cached RAT and band
+  SCOPE_WIDE          // All RATs and bands
+};
+
+// Cache (RTC copy of NVS, survives deep sleep)
+RTC_DATA_ATTR NetworkCache networkCache = {};
+RTC_DATA_ATTR bool networkCacheLoaded = false;
+RTC_DATA_ATTR AttachScope appliedScope = SCOPE_UNKNOWN;
+RTC_DATA_ATTR bool forceWideAttach = false;    // Set after a restricted attach missed, until one registers
+
+// Time-to-registration (EWMA, ms) per scope: [0] wide, [1] restricted
+RTC_DATA_ATTR uint32_t attachTimeMs[2] = {};
+RTC_DATA_ATTR uint16_t attachCount[2] = {};
+RTC_DATA_ATTR uint16_t attachMisses = 0;
+
+static void loadNetworkCache() {
+  if (networkCacheLoaded) return;
+
+  Preferences prefs;
+  prefs.begin(NETCACHE_NAMESPACE, true);
+  if (prefs.getBytesLength("cache") == sizeof(networkCache)) {
+    prefs.getBytes("cache", &networkCache, sizeof(networkCache));
+  }
+  prefs.end();
+  networkCacheLoaded = true;
+}
+
+static void saveNetworkCache() {
+  Preferences prefs;
+  prefs.begin(NETCACHE_NAMESPACE, false);
+  prefs.putBytes("cache", &networkCache, sizeof(networkCache));
+  prefs.end();
+}
+
+static const char* ratName(uint8_t rat) {
+  switch (rat) {
+    case NETCACHE_RAT_CATM:  return "CAT-M";
+    case NETCACHE_RAT_NBIOT: return "NB-IOT";
+    default:                 return "any";
+  }
+}
+
+/*
+ * Configure module for the cached network only
+ */
+static bool applyRestricted() {
+  char cmd[40];
+  snprintf(cmd, sizeof(cmd), "AT+CMNB=%u", networkCache.rat);
+  if (!sendATCommand(cmd, "OK")) return false;
+  snprintf(cmd, sizeof(cmd), "AT+CBANDCFG=\"%s\",%u", ratName(networkCache.rat), networkCache.band);
+  return sendATCommand(cmd, "OK");
+}
+
+/*
+ * Configure module to search all RATs and bands
+ */
+static bool applyWide() {
+  bool ok = sendATCommand("AT+CMNB=" + String(NETCACHE_RAT_BOTH), "OK");
+  ok = sendATCommand("AT+CBANDCFG=\"CAT-M\"," NETCACHE_CATM_BANDS, "OK") && ok;
+  ok = sendATCommand("AT+CBANDCFG=\"NB-IOT\"," NETCACHE_NBIOT_BANDS, "OK") && ok;
+  return ok;
+}
+
+/*
+ * Learn RAT, PLMN and band of the serving cell
+ * "+CPSI: LTE CAT-M1,Online,515-02,0x5A1E,187214780,257,EUTRAN-BAND28,..."
+ */
+static bool learnServingNetwork(NetworkCache& learned) {
+  clearSerialBuffer();
+  simSerial.println("AT+CPSI?");
+  beginATTrace("AT+CPSI?", sizeof("AT+CPSI?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  int tag = response.indexOf("+CPSI: ");
+  if (tag == -1 || response.indexOf("Online", tag) == -1) return false;
+
+  int end = response.indexOf('\r', tag);
+  String line = response.substring(tag + 7, end == -1 ? response.length() : end);
+
+  if (line.startsWith("LTE CAT-M1")) learned.rat = NETCACHE_RAT_CATM;
+  else if (line.startsWith("LTE NB-IOT")) learned.rat = NETCACHE_RAT_NBIOT;
+  else return false;
+
+  // "MCC-MNC" is the third field
+  int first = line.indexOf(',');
+  int second = line.indexOf(',', first + 1);
+  int third = line.indexOf(',', second + 1);
+  if (first == -1 || second == -1 || third == -1) return false;
+  String plmn = line.substring(second + 1, third);
+  plmn.replace("-", "");
+  strncpy(learned.plmn, plmn.c_str(), sizeof(learned.plmn) - 1);
+  learned.plmn[sizeof(learned.plmn) - 1] = '\0';
+
+  int band = line.indexOf("BAND");
+  if (band == -1) return false;
+  learned.band = line.substring(band + 4).toInt();
+
+  learned.valid = learned.band > 0;
+  return learned.valid;
+}
+
+/*
+ * Restrict or widen the search before AT+CFUN=1
+ * Commands are only sent when the wanted scope differs from the applied one
+ */
+void prepareNetworkAttach() {
+  loadNetworkCache();
+
+  AttachScope wanted = (networkCache.valid && !forceWideAttach) ? SCOPE_RESTRICTED : SCOPE_WIDE;
+  if (wanted == appliedScope) return;
+
+  bool ok = (wanted == SCOPE_RESTRICTED) ? applyRestricted() : applyWide();
+  if (ok) {
+    appliedScope = wanted;
+    if (wanted == SCOPE_RESTRICTED) {
+      Serial.printf("📶 Attach restricted to %s band %u (%s)\n",
+                    ratName(networkCache.rat), networkCache.band, networkCache.plmn);
+    } else {
+      Serial.println("📶 Attach searching all RATs and bands");
+    }
+  } else {
+    appliedScope = SCOPE_UNKNOWN;
+    Serial.println("⚠️ Failed to apply attach configuration");
+  }
+}
+
+/*
+ * Registration wait for the prepared attach
+ * The cached cell answers quickly or not at all, so a restricted attach
+ * gives up early and leaves the time for the wide retry
+ */
+uint32_t getAttachWaitMs() {
+  if (appliedScope != SCOPE_RESTRICTED) return REGISTRATION_TIMEOUT_MS;
+  return constrain(attachTimeMs[1] * NETCACHE_RESTRICTED_WAIT_X,
+                   (uint32_t)NETCACHE_RESTRICTED_WAIT_MS, (uint32_t)REGISTRATION_TIMEOUT_MS);
+}
+
+/*
+ * Learn from an attach attempt
+ *
+ * @param registered Registration succeeded within the wait budget
+ * @param elapsedMs  Time from AT+CFUN=1 to registration (or giving up)
+ * @return true if a restricted attach missed and a wide one should follow now
+ */
+bool recordNetworkAttach(bool registered, uint32_t elapsedMs) {
+  loadNetworkCache();
+  bool restricted = (appliedScope == SCOPE_RESTRICTED);
+
+  if (!registered) {
+    if (restricted) {
+      attachMisses++;
+      forceWideAttach = true;
+      Serial.println("📶 Restricted attach missed - widening the search");
+    }
+    return restricted;
+  }
+
+  uint32_t& avg = attachTimeMs[restricted ? 1 : 0];
+  avg = (avg == 0) ? elapsedMs : (avg * 3 + elapsedMs) / 4;
+  if (attachCount[restricted ? 1 : 0] < UINT16_MAX) attachCount[restricted ? 1 : 0]++;
+  forceWideAttach = false;
+
+  NetworkCache learned = {};
+  if (!learnServingNetwork(learned)) return false;
+
+  if (!networkCache.valid || learned.rat != networkCache.rat ||
+      learned.band != networkCache.band || strcmp(learned.plmn, networkCache.plmn) != 0) {
+    Serial.printf("📶 Learned network %s on %s band %u\n", learned.plmn, ratName(learned.rat), learned.band);
+    networkCache = learned;
+    saveNetworkCache();
+    if (restricted) appliedScope = SCOPE_UNKNOWN;  // Reapply for the new cell
+  }
+  return false;
+}
+
+/*
+ * Get the cached network
+ */
+const NetworkCache& getNetworkCache() {
+  loadNetworkCache();
+  return networkCache;
+}
+
+/*
+ * Forget the cached network (next attach searches everything)
+ */
+void clearNetworkCache() {
+  networkCache = NetworkCache();
+  saveNetworkCache();
+  networkCacheLoaded = true;
+  forceWideAttach = false;
+  Serial.println("📶 Network cache cleared");
+}
+
+/*
+ * Print cache and time-to-registration statistics
+ */
+void printNetworkCache() {
+  loadNetworkCache();
+  if (networkCache.valid) {
+    Serial.printf("\nNetwork cache: %s, %s band %u%s\n", networkCache.plmn,
+                  ratName(networkCache.rat), networkCache.band,
+                  forceWideAttach ? " (widened after miss)" : "");
+  } else {
+    Serial.println("\nNetwork cache: empty");
+  }
+  Serial.printf("  Registration: restricted %lu ms (%u), wide %lu ms (%u), %u misses\n",
+                attachTimeMs[1], attachCount[1], attachTimeMs[0], attachCount[0], attachMisses);
+}
@@ -0,0 +1,47 @@
+/*
+ * network_cache.h
+ *
+ * Cached operator, RAT and band configuration for faster attach
+ * Learns the PLMN, radio access technology (AT+CMNB) and band
+ * (AT+CBANDCFG) of the last successful registration and restricts the
+ * next attach to them, widening the search in the same attach after a miss.
+ */
+
+#ifndef NETWORK_CACHE_H
+#define NETWORK_CACHE_H
+
+#include <Arduino.h>
+
+#define NETCACHE_NAMESPACE      "net-cache"
+#define NETCACHE_PLMN_MAX_LEN   7     // "MCCMNC" + terminator
+#define NETCACHE_RESTRICTED_WAIT_MS  15000  // Min registration wait on the cached network
+#define NETCACHE_RESTRICTED_WAIT_X   3      // ... or this many times its average attach
+
+// AT+CMNB preferred access technology
+#define NETCACHE_RAT_CATM       1
+#define NETCACHE_RAT_NBIOT      2
+#define NETCACHE_RAT_BOTH       3
+
+// Full band lists restored when widening the search
+#define NETCACHE_CATM_BANDS     "1,2,3,4,5,8,12,13,18,19,20,25,26,28,66,85"
+#define NETCACHE_NBIOT_BANDS    "1,2,3,4,5,8,12,13,18,19,20,25,26,28,66,71,85"
+
+// Last successful registration
+struct NetworkCache {
+  bool valid;
+  char plmn[NETCACHE_PLMN_MAX_LEN];
+  uint8_t rat;     // NETCACHE_RAT_CATM or NETCACHE_RAT_NBIOT
+  uint8_t band;
+};
+
+// Attach hooks (called by enableRF around AT+CFUN=1)
+void prepareNetworkAttach();
+uint32_t getAttachWaitMs();
+bool recordNetworkAttach(bool registered, uint32_t elapsedMs);   // true = retry wide now
+
+// Cache state
+const NetworkCache& getNetworkCache();
+void clearNetworkCache();
+void printNetworkCache();
+
+#endif // NETWORK_CACHE_H
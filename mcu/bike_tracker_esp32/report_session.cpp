@@ -0,0 +1,177 @@
+/*
+ * report_session.cpp
+ *
+ * Implementation of the report session planner
+ *
+ * GNSS and LTE share the RF path, so every wake is a sequence of modem
+ * states. The planner runs GNSS first (reports carry the fix, and the fix
+ * provides UTC for time sync), then a single RF phase for sends, outbox
+ * retries and inbound commands, then powers both down. When the fix is
+ * expected to be slow or to fail, a short RF phase for the cell tower
+ * position comes first. Phase and transition times are learned in RTC
+ * memory to predict the next session.
+ */
+
+#include "report_session.h"
+
+// Learned work time per phase (EWMA, ms) - survives deep sleep
+RTC_DATA_ATTR uint32_t sessionGNSSWorkMs = 0;
+RTC_DATA_ATTR uint32_t sessionMessageMs = 0;   // RF phase time per message
+RTC_DATA_ATTR uint32_t sessionCellMs = 0;      // RF phase before GNSS (cell lookup)
+RTC_DATA_ATTR uint32_t lastSessionPredictedMs = 0;
+RTC_DATA_ATTR uint32_t lastSessionMeasuredMs = 0;
+
+// Running session
+static SessionPlan activePlan;
+static bool sessionActive = false;
+static ModemState activePhase = MODEM_UNKNOWN;
+static uint32_t sessionStart = 0;
+static uint32_t phaseStart = 0;
+
+/*
+ * Fold a measurement into an average (alpha = 1/4)
+ */
+static void updateAverage(uint32_t& avg, uint32_t sample) {
+  avg = (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+/*
+ * Expected work time of a phase, excluding the transition into it
+ */
+static uint32_t phaseWorkEstimate(ModemState phase, uint8_t messages) {
+  switch (phase) {
+    case MODEM_GNSS:
+      return sessionGNSSWorkMs ? sessionGNSSWorkMs : SESSION_DEFAULT_GNSS_MS;
+    case MODEM_RF:
+      return (sessionMessageMs ? sessionMessageMs : SESSION_DEFAULT_MESSAGE_MS) * max((int)messages, 1);
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Short name of a modem state for logs
+ */
+static const char* phaseName(ModemState phase) {
+  switch (phase) {
+    case MODEM_OFF:  return "OFF";
+    case MODEM_GNSS: return "GNSS";
+    case MODEM_RF:   return "RF";
+    default:         return "?";
+  }
+}
+
+/*
+ * Order pending work into modem phases
+ *
+ * A fix or time sync needs a GNSS phase, messages or an inbound check
+ * need an RF phase. GNSS comes before the sends so the reports can use
+ * the fix, which gives three transitions: OFF -> GNSS -> RF -> OFF. A
+ * cell-first session adds one: OFF -> RF -> GNSS -> RF -> OFF.
+ */
+SessionPlan planReportSession(const SessionWork& work) {
+  SessionPlan plan = {};
+  plan.messages = work.messages;
+
+  bool gnss = work.needFix || work.timeSync;
+  if (gnss && work.cellFirst) plan.phases[plan.phaseCount++] = MODEM_RF;
+  if (gnss) plan.phases[plan.phaseCount++] = MODEM_GNSS;
+  if (work.messages > 0 || work.inboundCheck) plan.phases[plan.phaseCount++] = MODEM_RF;
+  plan.phases[plan.phaseCount++] = MODEM_OFF;
+
+  ModemState prev = getModemState();
+  for (int i = 0; i < plan.phaseCount; i++) {
+    plan.predictedMs += getModemTransitionEstimate(prev, plan.phases[i]);
+    if (plan.phases[i] == MODEM_RF && i + 1 < plan.phaseCount && plan.phases[i + 1] == MODEM_GNSS) {
+      plan.predictedMs += sessionCellMs ? sessionCellMs : SESSION_DEFAULT_CELL_MS;
+    } else {
+      plan.predictedMs += phaseWorkEstimate(plan.phases[i], plan.messages);
+    }
+    prev = plan.phases[i];
+  }
+
+  return plan;
+}
+
+/*
+ * Start timing a planned session
+ */
+void beginReportSession(const SessionPlan& plan) {
+  activePlan = plan;
+  sessionActive = true;
+  activePhase = MODEM_UNKNOWN;
+  sessionStart = millis();
+  phaseStart = sessionStart;
+
+  Serial.print("🗓️ Session plan:");
+  for (int i = 0; i < plan.phaseCount; i++) {
+    Serial.printf(" %s%s", i ? "-> " : "", phaseName(plan.phases[i]));
+  }
+  Serial.printf(", predicted %lu ms\n", plan.predictedMs);
+}
+
+/*
+ * Finish the current phase and move the modem to the next one
+ * Work time of the finished phase is learned for later predictions
+ */
+bool enterSessionPhase(ModemState phase) {
+  uint32_t now = millis();
+
+  if (sessionActive && activePhase == MODEM_GNSS) {
+    updateAverage(sessionGNSSWorkMs, now - phaseStart);
+  } else if (sessionActive && activePhase == MODEM_RF && phase == MODEM_GNSS) {
+    updateAverage(sessionCellMs, now - phaseStart);
+  } else if (sessionActive && activePhase == MODEM_RF) {
+    updateAverage(sessionMessageMs, (now - phaseStart) / max((int)activePlan.messages, 1));
+  }
+
+  bool ok = setModemState(phase);
+  activePhase = phase;
+  phaseStart = millis();
+  return ok;
+}
+
+/*
+ * Power the modem down and log predicted vs measured duration
+ *
+ * @return measured session duration in milliseconds
+ */
+uint32_t endReportSession() {
+  enterSessionPhase(MODEM_OFF);
+  uint32_t measured = millis() - sessionStart;
+
+  if (sessionActive) {
+    lastSessionPredictedMs = activePlan.predictedMs;
+    lastSessionMeasuredMs = measured;
+    Serial.printf("📊 Session done: predicted %lu ms, measured %lu ms\n",
+                  activePlan.predictedMs, measured);
+  }
+
+  sessionActive = false;
+  activePhase = MODEM_UNKNOWN;
+  return measured;
+}
+
+/*
+ * Get predicted and measured duration of the last session
+ */
+void getLastSessionTimes(uint32_t& predictedMs, uint32_t& measuredMs) {
+  predictedMs = lastSessionPredictedMs;
+  measuredMs = lastSessionMeasuredMs;
+}
+
+/*
+ * Print learned phase and transition estimates
+ */
+void printSessionEstimates() {
+  Serial.printf("\nSession: last predicted %lu ms, measured %lu ms\n",
+                lastSessionPredictedMs, lastSessionMeasuredMs);
+  Serial.printf("  GNSS phase: %lu ms\n", phaseWorkEstimate(MODEM_GNSS, 0));
+  Serial.printf("  RF per message: %lu ms\n", phaseWorkEstimate(MODEM_RF, 1));
+  Serial.printf("  Cell lookup before GNSS: %lu ms\n", sessionCellMs ? sessionCellMs : SESSION_DEFAULT_CELL_MS);
+  Serial.printf("  OFF->GNSS %lu, GNSS->OFF %lu, OFF->RF %lu, RF->OFF %lu ms\n",
+                getModemTransitionEstimate(MODEM_OFF, MODEM_GNSS),
+                getModemTransitionEstimate(MODEM_GNSS, MODEM_OFF),
+                getModemTransitionEstimate(MODEM_OFF, MODEM_RF),
+                getModemTransitionEstimate(MODEM_RF, MODEM_OFF));
+}
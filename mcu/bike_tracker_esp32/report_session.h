@@ -0,0 +1,50 @@
+/*
+ * report_session.h
+ *
+ * Report session planner
+ * Orders the work of one wake (GNSS fix, SMS sends, outbox flush,
+ * inbound commands) so the modem switches between GNSS and RF as few
+ * times as possible, and compares predicted with measured duration.
+ */
+
+#ifndef REPORT_SESSION_H
+#define REPORT_SESSION_H
+
+#include <Arduino.h>
+#include "sim7070g.h"
+
+#define SESSION_MAX_PHASES  4   // RF (cell), GNSS, RF, OFF
+
+// Default work estimates until sessions have been measured (ms)
+#define SESSION_DEFAULT_GNSS_MS     30000
+#define SESSION_DEFAULT_MESSAGE_MS  8000
+#define SESSION_DEFAULT_CELL_MS     6000
+
+// Work pending for this wake
+struct SessionWork {
+  bool needFix;        // Fresh GNSS fix wanted
+  uint8_t messages;    // Reports to send + queued outbox messages
+  bool timeSync;       // Wall clock needed (taken from GNSS UTC)
+  bool inboundCheck;   // Read SMS commands
+  bool cellFirst;      // Cell tower position before GNSS (slow or doubtful fix)
+};
+
+// Ordered modem phases for one session
+struct SessionPlan {
+  ModemState phases[SESSION_MAX_PHASES];  // Always ends with MODEM_OFF
+  uint8_t phaseCount;
+  uint8_t messages;
+  uint32_t predictedMs;
+};
+
+// Session planning and execution
+SessionPlan planReportSession(const SessionWork& work);
+void beginReportSession(const SessionPlan& plan);
+bool enterSessionPhase(ModemState phase);
+uint32_t endReportSession();
+
+// Session statistics
+void getLastSessionTimes(uint32_t& predictedMs, uint32_t& measuredMs);
+void printSessionEstimates();
+
+#endif // REPORT_SESSION_H
@@ -0,0 +1,214 @@
+/*
+ * signal_quality.cpp
+ *
+ * Implementation of signal-quality history and transmission scheduling
+ *
+ * RSRP/RSRQ/RSSI come from AT+CPSI? on LTE, RSSI from AT+CSQ otherwise.
+ * The latest sample decides the current session: in poor coverage a
+ * non-urgent report is skipped (the fix is already in the track log and
+ * the next report supersedes it) up to SIGNAL_MAX_DEFERRALS times, while
+ * urgent alerts keep trying with longer SMS and uplink timeouts.
+ */
+
+#include "signal_quality.h"
+#include "sim7070g.h"
+#include "at_trace.h"
+
+// History ring (survives deep sleep)
+RTC_DATA_ATTR SignalSample signalHistory[SIGNAL_HISTORY_SIZE];
+RTC_DATA_ATTR uint8_t signalHistoryIndex = 0;
+RTC_DATA_ATTR uint8_t signalHistoryCount = 0;
+RTC_DATA_ATTR uint8_t signalDeferrals = 0;         // Consecutive deferred sessions
+RTC_DATA_ATTR uint16_t signalDeferredTotal = 0;
+
+static bool transmissionUrgent = false;
+
+/*
+ * Classify a measurement, RSRP when on LTE, RSSI otherwise
+ */
+static SignalLevel classifySignal(const SignalSample& s) {
+  if (s.rsrp != 0) {
+    if (s.rsrp >= SIGNAL_RSRP_GOOD) return SIGNAL_GOOD;
+    if (s.rsrp >= SIGNAL_RSRP_FAIR) return SIGNAL_FAIR;
+    if (s.rsrp >= SIGNAL_RSRP_POOR) return SIGNAL_POOR;
+    return SIGNAL_NONE;
+  }
+  if (s.rssi != 0) {
+    if (s.rssi >= SIGNAL_RSSI_GOOD) return SIGNAL_GOOD;
+    if (s.rssi >= SIGNAL_RSSI_FAIR) return SIGNAL_FAIR;
+    if (s.rssi >= SIGNAL_RSSI_POOR) return SIGNAL_POOR;
+  }
+  return SIGNAL_NONE;
+}
+
+static const char* levelName(SignalLevel level) {
+  switch (level) {
+    case SIGNAL_GOOD: return "good";
+    case SIGNAL_FAIR: return "fair";
+    case SIGNAL_POOR: return "poor";
+    default:          return "none";
+  }
+}
+
+/*
+ * Read RSSI from "+CSQ: <rssi>,<ber>"
+ * 0..31 maps to -113..-51 dBm, 99 = unknown
+ */
+static int8_t readCSQ() {
+  clearSerialBuffer();
+  simSerial.println("AT+CSQ");
+  beginATTrace("AT+CSQ", sizeof("AT+CSQ") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  int tag = response.indexOf("+CSQ: ");
+  if (tag == -1) return 0;
+  int csq = response.substring(tag + 6).toInt();
+  if (csq > 31) return 0;
+  return -113 + 2 * csq;
+}
+
+/*
+ * Read RSRQ/RSRP/RSSI from the LTE serving cell
+ * "+CPSI: LTE CAT-M1,Online,515-02,0x5A1E,187214780,257,EUTRAN-BAND28,9410,3,3,-11,-98,-70,12"
+ */
+static bool readCPSI(SignalSample& s) {
+  clearSerialBuffer();
+  simSerial.println("AT+CPSI?");
+  beginATTrace("AT+CPSI?", sizeof("AT+CPSI?") + 1);
+  String response = readResponse(DEFAULT_TIMEOUT);
+
+  int tag = response.indexOf("+CPSI: LTE");
+  if (tag == -1 || response.indexOf("Online", tag) == -1) return false;
+
+  int end = response.indexOf('\r', tag);
+  if (end == -1) end = response.length();
+
+  // Fields 10..12 are RSRQ, RSRP, RSSI
+  int field = 0;
+  int pos = tag;
+  while (field < 10) {
+    pos = response.indexOf(',', pos);
+    if (pos == -1 || pos >= end) return false;
+    pos++;
+    field++;
+  }
+
+  int rsrq = response.substring(pos).toInt();
+  pos = response.indexOf(',', pos);
+  if (pos == -1 || pos >= end) return false;
+  int rsrp = response.substring(pos + 1).toInt();
+  pos = response.indexOf(',', pos + 1);
+  int rssi = (pos != -1 && pos < end) ? response.substring(pos + 1).toInt() : 0;
+
+  s.rsrq = constrain(rsrq, -128, 0);
+  s.rsrp = constrain(rsrp, -200, 0);
+  if (rssi != 0) s.rssi = constrain(rssi, -128, 0);
+  return s.rsrp != 0;
+}
+
+/*
+ * Measure coverage and append it to the history
+ *
+ * @return coverage class of the new sample
+ */
+SignalLevel sampleSignalQuality() {
+  SignalSample s = {};
+  s.rssi = readCSQ();
+  readCPSI(s);
+  s.level = classifySignal(s);
+
+  signalHistory[signalHistoryIndex] = s;
+  signalHistoryIndex = (signalHistoryIndex + 1) % SIGNAL_HISTORY_SIZE;
+  if (signalHistoryCount < SIGNAL_HISTORY_SIZE) signalHistoryCount++;
+
+  Serial.printf("📶 Signal %s: RSRP %d dBm, RSRQ %d dB, RSSI %d dBm\n",
+                levelName(s.level), s.rsrp, s.rsrq, s.rssi);
+  return s.level;
+}
+
+/*
+ * Coverage class of the latest sample (previous session before sampling)
+ */
+SignalLevel getSignalLevel() {
+  if (signalHistoryCount == 0) return SIGNAL_FAIR;  // Unknown - assume usable
+  int last = (signalHistoryIndex + SIGNAL_HISTORY_SIZE - 1) % SIGNAL_HISTORY_SIZE;
+  return signalHistory[last].level;
+}
+
+/*
+ * Mark the sends of the running session as urgent (alerts) or not (periodic)
+ */
+void setTransmissionUrgency(bool urgent) {
+  transmissionUrgent = urgent;
+}
+
+/*
+ * Decide whether to skip this session's sends because of coverage
+ * Urgent sends are never deferred, non-urgent ones at most
+ * SIGNAL_MAX_DEFERRALS sessions in a row.
+ */
+bool shouldDeferTransmission() {
+  if (transmissionUrgent || getSignalLevel() > SIGNAL_POOR ||
+      signalDeferrals >= SIGNAL_MAX_DEFERRALS) {
+    signalDeferrals = 0;
+    return false;
+  }
+
+  signalDeferrals++;
+  signalDeferredTotal++;
+  Serial.printf("📶 Coverage %s - deferring report (%d/%d)\n",
+                levelName(getSignalLevel()), signalDeferrals, SIGNAL_MAX_DEFERRALS);
+  return true;
+}
+
+/*
+ * Timeout for a network step given coverage and urgency
+ * Urgent sends in poor coverage get SIGNAL_URGENT_SCALE times the budget
+ */
+uint32_t getSignalTimeout(uint32_t baseMs) {
+  if (transmissionUrgent && getSignalLevel() <= SIGNAL_POOR) {
+    return baseMs * SIGNAL_URGENT_SCALE;
+  }
+  return baseMs;
+}
+
+/*
+ * Write signal statistics as a JSON object for the status characteristic
+ * {"level":"fair","rsrp":-98,"rsrq":-11,"rssi":-70,"avg_rsrp":-101,"samples":8,"deferred":2}
+ */
+int formatSignalStats(char* out, size_t outSize) {
+  SignalSample last = {};
+  if (signalHistoryCount > 0) {
+    last = signalHistory[(signalHistoryIndex + SIGNAL_HISTORY_SIZE - 1) % SIGNAL_HISTORY_SIZE];
+  }
+
+  int rsrpSum = 0;
+  int rsrpCount = 0;
+  for (int i = 0; i < signalHistoryCount; i++) {
+    if (signalHistory[i].rsrp != 0) {
+      rsrpSum += signalHistory[i].rsrp;
+      rsrpCount++;
+    }
+  }
+
+  return snprintf(out, outSize,
+    "{\"level\":\"%s\",\"rsrp\":%d,\"rsrq\":%d,\"rssi\":%d,\"avg_rsrp\":%d,"
+    "\"samples\":%d,\"deferred\":%u}",
+    signalHistoryCount ? levelName(last.level) : "unknown",
+    last.rsrp, last.rsrq, last.rssi,
+    rsrpCount ? rsrpSum / rsrpCount : 0,
+    signalHistoryCount, signalDeferredTotal);
+}
+
+/*
+ * Print signal history, oldest first
+ */
+void printSignalHistory() {
+  Serial.printf("\nSignal history (%d samples, %u deferred):\n", signalHistoryCount, signalDeferredTotal);
+  int first = (signalHistoryIndex + SIGNAL_HISTORY_SIZE - signalHistoryCount) % SIGNAL_HISTORY_SIZE;
+  for (int i = 0; i < signalHistoryCount; i++) {
+    const SignalSample& s = signalHistory[(first + i) % SIGNAL_HISTORY_SIZE];
+    Serial.printf("  %d: %-4s RSRP %4d dBm  RSRQ %3d dB  RSSI %4d dBm\n",
+                  i + 1, levelName(s.level), s.rsrp, s.rsrq, s.rssi);
+  }
+}
@@ -0,0 +1,57 @@
+/*
+ * signal_quality.h
+ *
+ * Signal-quality history and transmission scheduling
+ * Samples RSSI/RSRP/RSRQ in every RF session, keeps a short history in
+ * RTC memory, defers non-urgent sends in bad coverage and gives urgent
+ * ones longer timeouts.
+ */
+
+#ifndef SIGNAL_QUALITY_H
+#define SIGNAL_QUALITY_H
+
+#include <Arduino.h>
+
+#define SIGNAL_HISTORY_SIZE       8     // Samples kept across deep sleep
+
+// LTE thresholds (RSRP, dBm)
+#define SIGNAL_RSRP_GOOD          -95
+#define SIGNAL_RSRP_FAIR          -105
+#define SIGNAL_RSRP_POOR          -118  // Below this the cell is treated as unusable
+
+// Fallback thresholds when only AT+CSQ is available (RSSI, dBm)
+#define SIGNAL_RSSI_GOOD          -85
+#define SIGNAL_RSSI_FAIR          -95
+#define SIGNAL_RSSI_POOR          -105
+
+#define SIGNAL_MAX_DEFERRALS      3     // Non-urgent sessions deferred in a row before sending anyway
+#define SIGNAL_URGENT_SCALE       2     // Timeout multiplier for urgent sends in poor coverage
+
+// Coverage classes, ordered worst to best
+enum SignalLevel : uint8_t {
+  SIGNAL_NONE,   // Not registered / no measurement
+  SIGNAL_POOR,
+  SIGNAL_FAIR,
+  SIGNAL_GOOD
+};
+
+// One RF session measurement (0 = not reported)
+struct SignalSample {
+  int16_t rsrp;    // dBm (LTE)
+  int8_t rsrq;     // dB (LTE)
+  int8_t rssi;     // dBm
+  SignalLevel level;
+};
+
+// Sampling and scheduling (call with RF enabled)
+SignalLevel sampleSignalQuality();
+SignalLevel getSignalLevel();
+void setTransmissionUrgency(bool urgent);
+bool shouldDeferTransmission();
+uint32_t getSignalTimeout(uint32_t baseMs);
+
+// Statistics
+int formatSignalStats(char* out, size_t outSize);
+void printSignalHistory();
+
+#endif // SIGNAL_QUALITY_H
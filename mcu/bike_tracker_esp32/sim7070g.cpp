@@ -5,13 +5,135 @@
  */
 
 #include "sim7070g.h"
+#include "modem_sleep.h"
+#include "network_cache.h"
+#include "modem_recovery.h"
+#include "at_stats.h"
+#include "at_trace.h"
+#include "gnss_profile.h"
+#include <Preferences.h>
 
 // Hardware serial instance for SIM7070G communication
+#if MODEM_TRANSCRIPT
+TranscriptSerial simSerial(1);
+#else
 HardwareSerial simSerial(1);
+#endif
 
-// Track initialization state
+// Supported link rates, fastest first
+static const uint32_t SIM_BAUD_RATES[] = {921600, 460800, 230400, 115200};
+
+// Link rate the module is set to, and the fastest rate still worth
+// trying (0 = all). RTC copies of the NVS values.
+RTC_DATA_ATTR uint32_t simBaudRate = 0;
+RTC_DATA_ATTR uint32_t simBaudCeiling = 0;
+RTC_DATA_ATTR uint16_t simBaudCeilingAge = 0;   // Negotiations since the ceiling was set
+static bool uartStarted = false;
+static volatile uint16_t uartErrorCount = 0;   // Overflow / framing errors from the UART driver
+
+// Track initialization state (UART set up since boot/wake)
 static bool sim7070gInitialized = false;
 
+// Modem session state - the module keeps running while the ESP32 deep
+// sleeps, so its configuration and power state survive in RTC memory
+RTC_DATA_ATTR bool modemConfigured = false;      // Text mode, SMS params and URCs applied
+RTC_DATA_ATTR bool modemRegistered = false;      // Registered when RF was last used
+RTC_DATA_ATTR uint16_t modemResumeCount = 0;     // Wakes that skipped the full init
+RTC_DATA_ATTR uint16_t modemFullInitCount = 0;
+
+// Modem power state and learned transition times (EWMA, ms)
+RTC_DATA_ATTR ModemState modemState = MODEM_UNKNOWN;
+RTC_DATA_ATTR uint32_t modemTransitionMs[MODEM_STATE_COUNT][MODEM_STATE_COUNT] = {};
+
+// Default transition estimates before anything was measured
+static const uint32_t DEFAULT_TRANSITION_MS[MODEM_STATE_COUNT][MODEM_STATE_COUNT] = {
+  //  OFF    GNSS   RF
+  {      0,   500, 6000},  // from OFF
+  {    300,     0, 6300},  // from GNSS
+  {   1500,  2000,    0}   // from RF
+};
+
+// Last failed command
+static ModemError lastModemError = MODEM_ERR_NONE;
+static int lastModemErrorCode = 0;
+
+// Unsolicited result code tracking
+static char urcLine[32];
+static uint8_t urcLineLen = 0;
+static bool inboundSMSNotified = false;
+
+static ModemIdleHandler modemIdleHandler = nullptr;
+
+/*
+ * Feed received byte to the URC tracker
+ * Flags "+CMTI:" (new SMS stored) notifications seen on any read path
+ */
+static void trackURC(char c) {
+  if (c == '\n' || c == '\r') {
+    urcLine[urcLineLen] = '\0';
+    if (strncmp(urcLine, "+CMTI:", 6) == 0) {
+      inboundSMSNotified = true;
+    }
+    urcLineLen = 0;
+  } else if (urcLineLen < sizeof(urcLine) - 1) {
+    urcLine[urcLineLen++] = c;
+  }
+}
+
+/*
+ * Check if a +CMTI notification arrived since last cleared
+ */
+bool hasInboundSMSNotification() {
+  return inboundSMSNotified;
+}
+
+void clearInboundSMSNotification() {
+  inboundSMSNotified = false;
+}
+
+/*
+ * Read one received byte for callers that parse the UART themselves
+ * Feeds the URC tracker so notifications between responses are not lost
+ */
+char readModemByte() {
+  char c = simSerial.read();
+  trackURC(c);
+  return c;
+}
+
+/*
+ * Register work to run while waiting on the module
+ * Report sessions spend most of their time in these waits, the handler
+ * keeps sampling the IMU through them
+ */
+void setModemIdleHandler(ModemIdleHandler handler) {
+  modemIdleHandler = handler;
+}
+
+/*
+ * Wait for the module, running the idle handler every MODEM_IDLE_SLICE_MS
+ */
+void waitModem(uint32_t ms) {
+  uint32_t start = millis();
+  uint32_t elapsed = 0;
+  do {
+    if (modemIdleHandler) modemIdleHandler();
+    elapsed = millis() - start;
+    if (elapsed < ms) delay(min(ms - elapsed, (uint32_t)MODEM_IDLE_SLICE_MS));
+  } while (millis() - start < ms);
+}
+
+/*
+ * Print cached modem session state
+ */
+void printModemSession() {
+  Serial.printf("  Modem: state %d, %lu baud, %s, %s, %u resumed / %u full inits\n",
+                modemState, simBaudRate,
+                modemConfigured ? "configured" : "not configured",
+                modemRegistered ? "registered" : "not registered",
+                modemResumeCount, modemFullInitCount);
+}
+
 /*
  * Check if SIM7070G is initialized
  */
@@ -19,9 +141,179 @@ bool isSIM7070GInitialized() {
   return sim7070gInitialized;
 }
 
+/*
+ * UART driver error event (runs in the driver's event task)
+ * Buffer overflows mean dropped bytes, framing errors a rate mismatch
+ */
+static void onUARTError(hardwareSerial_error_t error) {
+  if (error != UART_NO_ERROR) uartErrorCount++;
+}
+
+/*
+ * Save link rate settings to NVS
+ */
+static void saveBaudSettings() {
+  Preferences prefs;
+  prefs.begin(SIM_PREFS_NAMESPACE, false);
+  prefs.putUInt("baud", simBaudRate);
+  prefs.putUInt("baudMax", simBaudCeiling);
+  prefs.end();
+}
+
+/*
+ * Start the UART at the last good rate
+ * The RX buffer must be sized before the driver is installed
+ */
+static void beginUART() {
+  if (simBaudRate == 0) {
+    Preferences prefs;
+    prefs.begin(SIM_PREFS_NAMESPACE, true);
+    simBaudRate = prefs.getUInt("baud", SIM_BAUD_DEFAULT);
+    simBaudCeiling = prefs.getUInt("baudMax", 0);
+    prefs.end();
+  }
+
+  if (uartStarted) {
+    simSerial.updateBaudRate(simBaudRate);
+    return;
+  }
+  simSerial.setRxBufferSize(SIM_RX_BUFFER_SIZE);
+  simSerial.begin(simBaudRate, SERIAL_8N1, SIM_RX_PIN, SIM_TX_PIN);
+  simSerial.onReceiveError(onUARTError);
+  uartStarted = true;
+}
+
+/*
+ * Switch the ESP32 side of the link
+ */
+static void setLinkRate(uint32_t baud) {
+  simSerial.flush();
+  simSerial.updateBaudRate(baud);
+  delay(20);
+  clearSerialBuffer();
+  uartErrorCount = 0;
+}
+
+/*
+ * Check the link carries several round trips without errors
+ * AT+CGMR returns a longer line than AT, so dropped bytes show up
+ */
+static bool verifyLink() {
+  uartErrorCount = 0;
+  for (int i = 0; i < SIM_BAUD_VERIFY_PROBES; i++) {
+    if (!sendATCommand(i % 2 ? "AT+CGMR" : "AT", "OK", 500)) return false;
+  }
+  return uartErrorCount == 0;
+}
+
+/*
+ * Check the module answers, scanning the supported rates if it does not
+ * answer at the stored one (e.g. it rebooted with another saved rate)
+ *
+ * @param scanRates Try the other rates when the stored one gets no answer
+ * @return true if the module answers AT
+ */
+bool probeModemLink(bool scanRates) {
+  if (sendATCommand("AT", "OK", 500)) return true;
+  if (!scanRates) return false;
+
+  for (uint32_t baud : SIM_BAUD_RATES) {
+    if (baud == simBaudRate) continue;
+    setLinkRate(baud);
+    if (sendATCommand("AT", "OK", 300) && sendATCommand("AT", "OK", 300)) {
+      Serial.printf("⚠️ SIM7070G answered at %lu baud, expected %lu\n", baud, simBaudRate);
+      simBaudRate = baud;
+      saveBaudSettings();
+      return true;
+    }
+  }
+
+  setLinkRate(simBaudRate);
+  return false;
+}
+
+/*
+ * Move the link to the fastest rate that verifies reliably
+ *
+ * Each faster rate is set with AT+IPR and checked with clean round
+ * trips, with one more round before giving up on it. A failed rate is
+ * reverted and recorded as the ceiling, so it is not retried on every
+ * init; after SIM_BAUD_CEILING_INITS negotiations the ceiling is lifted
+ * and the faster rates get another chance. The result is saved in NVS
+ * and in the module (AT&W), so both sides start at the same rate after
+ * a wake.
+ *
+ * @return true if the link runs at a verified rate
+ */
+bool negotiateBaudRate() {
+  const int rateCount = sizeof(SIM_BAUD_RATES) / sizeof(SIM_BAUD_RATES[0]);
+
+  // Age kept in RTC only - a reboot restarts it instead of wearing NVS
+  if (simBaudCeiling != 0 && ++simBaudCeilingAge >= SIM_BAUD_CEILING_INITS) {
+    Serial.printf("📡 Retrying rates above the %lu baud ceiling\n", simBaudCeiling);
+    simBaudCeiling = 0;
+    simBaudCeilingAge = 0;
+    saveBaudSettings();
+  }
+  for (int i = 0; i < rateCount - 1; i++) {
+    uint32_t baud = SIM_BAUD_RATES[i];
+    if (baud <= simBaudRate) break;
+    if (simBaudCeiling != 0 && baud > simBaudCeiling) continue;
+
+    uint32_t previous = simBaudRate;
+    char cmd[20];
+    snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", baud);
+    if (!sendATCommand(cmd, "OK")) continue;
+
+    setLinkRate(baud);
+    bool reliable = false;
+    for (int t = 0; t < SIM_BAUD_VERIFY_TRIES && !reliable; t++) {
+      reliable = verifyLink();
+    }
+    if (reliable) {
+      simBaudRate = baud;
+      simBaudCeiling = baud;
+      sendATCommand("AT&W", "OK");
+      saveBaudSettings();
+      Serial.printf("✅ SIM7070G link at %lu baud\n", baud);
+      return true;
+    }
+
+    // Unreliable - go back to the previous rate
+    Serial.printf("⚠️ %lu baud unreliable (%u UART errors), falling back\n", baud, uartErrorCount);
+    snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", previous);
+    sendATCommand(cmd, "OK");
+    setLinkRate(previous);
+    simBaudCeiling = SIM_BAUD_RATES[i + 1];
+    simBaudCeilingAge = 0;
+    saveBaudSettings();
+    if (!probeModemLink()) return false;
+  }
+
+  return verifyLink();
+}
+
+/*
+ * Get current link rate
+ */
+uint32_t getSIMBaudRate() {
+  return simBaudRate;
+}
+
+/*
+ * Cheap liveness check for a module configured before deep sleep
+ * Text mode is volatile and defaults to PDU after a module restart, so
+ * "+CMGF: 1" shows the module kept running with our settings.
+ */
+static bool checkModemSession() {
+  return wakeModem() && sendATCommand("AT+CMGF?", "+CMGF: 1", 1000);
+}
+
 /*
  * Initialize the SIM7070G module
- * Sets up UART, performs module reset, and configures basic settings
+ * Sets up UART, performs module reset, and configures basic settings.
+ * After a deep sleep wake the cached session is reused when the module
+ * passes the liveness check; the full sequence runs only when it fails.
  */
 bool initializeSIM7070G() {
   // If already initialized, just return true
@@ -29,20 +321,38 @@ bool initializeSIM7070G() {
     Serial.println("📡 SIM7070G already initialized");
     return true;
   }
-  // Initialize serial communication
-  simSerial.begin(115200, SERIAL_8N1, SIM_RX_PIN, SIM_TX_PIN);
-  delay(2000);
+  // Initialize serial communication at the last good rate
+  beginUART();
+
+  if (modemConfigured) {
+    uint32_t start = millis();
+    if (checkModemSession()) {
+      sim7070gInitialized = true;
+      modemResumeCount++;
+      Serial.printf("✅ SIM7070G session resumed in %lu ms (state %d)\n", millis() - start, modemState);
+      return true;
+    }
+    Serial.println("⚠️ SIM7070G lost its configuration - full init");
+    modemConfigured = false;
+    modemRegistered = false;
+    modemState = MODEM_UNKNOWN;
+  }
+  if (isModemPoweredOff()) {
+    modemState = MODEM_UNKNOWN;  // Boots with default functionality
+  }
   
   Serial.println("📡 Initializing SIM7070G module...");
   
-  // Check if module responds
+  // Check if module responds (DTR low, PWRKEY if in PSM or powered off)
   int attempts = 0;
-  while (!sendATCommand("AT", "OK") && attempts < 5) {
+  bool responding = wakeModem();
+  while (!responding && attempts < 5) {
     delay(1000);
+    responding = sendATCommand("AT", "OK");
     attempts++;
   }
   
-  if (attempts >= 5) {
+  if (!responding) {
     Serial.println("❌ SIM7070G not responding");
     return false;
   }
@@ -54,51 +364,167 @@ bool initializeSIM7070G() {
   
   // Check signal quality
   sendATCommand("AT+CSQ", "OK", 5000);
-  delay(1000);
   
   // Configure SMS text mode
   sendATCommand("AT+CMGF=1", "OK");
   sendATCommand("AT+CSMP=17,167,0,0", "OK");
   
+  // Numeric +CME ERROR codes for the recovery policy
+  sendATCommand("AT+CMEE=1", "OK");
+
+  // Store incoming SMS and raise +CMTI so commands can be read during RF sessions
+  sendATCommand("AT+CNMI=2,1,0,0,0", "OK");
+
+  // Faster link for GNSS, SMS and data bearer traffic
+  negotiateBaudRate();
+  
   Serial.println("✅ SIM7070G initialization complete");
   sim7070gInitialized = true;
+  modemConfigured = true;
+  modemFullInitCount++;
   return true;
 }
 
+/*
+ * Map a +CME ERROR code
+ */
+static ModemError classifyCME(int code) {
+  if (code == 3 || code == 4) return MODEM_ERR_NOT_ALLOWED;
+  if (code >= 10 && code <= 18) return MODEM_ERR_SIM;
+  if (code >= 20 && code <= 23) return MODEM_ERR_MEMORY;
+  if (code >= 30 && code <= 32) return MODEM_ERR_NO_NETWORK;
+  return MODEM_ERR_GENERIC;
+}
+
+/*
+ * Map a +CMS ERROR code
+ */
+static ModemError classifyCMS(int code) {
+  if (code >= 1 && code <= 127) return MODEM_ERR_SMS_REJECTED;
+  if (code >= 300 && code <= 305) return MODEM_ERR_SMS_MODE;
+  if (code >= 310 && code <= 316) return MODEM_ERR_SIM;
+  if (code >= 320 && code <= 322) return MODEM_ERR_MEMORY;
+  if (code >= 330 && code <= 332) return MODEM_ERR_NO_NETWORK;
+  return MODEM_ERR_GENERIC;
+}
+
+/*
+ * Classify an error response and remember it as the last error
+ * Responses without ERROR count as a timeout
+ */
+ModemError recordModemError(const String& response) {
+  int cme = response.indexOf("+CME ERROR: ");
+  int cms = response.indexOf("+CMS ERROR: ");
+
+  if (cme != -1) {
+    lastModemErrorCode = response.substring(cme + 12).toInt();
+    lastModemError = classifyCME(lastModemErrorCode);
+  } else if (cms != -1) {
+    lastModemErrorCode = response.substring(cms + 12).toInt();
+    lastModemError = classifyCMS(lastModemErrorCode);
+  } else {
+    lastModemErrorCode = 0;
+    lastModemError = response.indexOf("ERROR") != -1 ? MODEM_ERR_GENERIC : MODEM_ERR_TIMEOUT;
+  }
+  return lastModemError;
+}
+
+/*
+ * Get the error of the last failed command
+ */
+ModemError getLastModemError() {
+  return lastModemError;
+}
+
+int getLastModemErrorCode() {
+  return lastModemErrorCode;
+}
+
+/*
+ * Short name of an error for logs
+ */
+const char* modemErrorName(ModemError error) {
+  switch (error) {
+    case MODEM_ERR_NONE:         return "none";
+    case MODEM_ERR_TIMEOUT:      return "timeout";
+    case MODEM_ERR_NOT_ALLOWED:  return "not allowed";
+    case MODEM_ERR_SIM:          return "SIM";
+    case MODEM_ERR_MEMORY:       return "memory";
+    case MODEM_ERR_NO_NETWORK:   return "no network";
+    case MODEM_ERR_SMS_MODE:     return "SMS mode";
+    case MODEM_ERR_SMS_REJECTED: return "SMS rejected";
+    default:                     return "error";
+  }
+}
+
 /*
  * Send AT command and wait for expected response
+ * The timeout is learned from earlier responses (at_stats.h), with the
+ * given value as default. A final OK without the expected text ends the
+ * wait early. On failure the typed error is available from
+ * getLastModemError().
  */
 bool sendATCommand(const String& cmd, const String& expectedResp, uint32_t timeout) {
   // Clear any pending data
-  while (simSerial.available()) {
-    simSerial.read();
-  }
+  clearSerialBuffer();
   
   // Send command
   simSerial.println(cmd);
+  beginATTrace(cmd.c_str(), cmd.length() + 2);
   
   // Wait for response
   uint32_t start = millis();
+  uint32_t limit = getAdaptiveTimeout(cmd, timeout);
   String buffer = "";
   
-  while (millis() - start < timeout) {
+  while (millis() - start < limit) {
     while (simSerial.available()) {
       char c = simSerial.read();
       buffer += c;
+      trackURC(c);
+      noteATFirstByte();
       
       // Check if we got expected response
       if (buffer.indexOf(expectedResp) != -1) {
+        recordATLatency(cmd, millis() - start, false);
+        lastModemError = MODEM_ERR_NONE;
+        endATTrace(AT_TRACE_OK, buffer.length());
         return true;
       }
+
+      // Final OK without the expected text - negative answer, not a slow one
+      if (c == '\n' && buffer.endsWith("\nOK\r\n")) {
+        recordATLatency(cmd, millis() - start, false);
+        lastModemError = MODEM_ERR_NONE;
+        endATTrace(AT_TRACE_NEGATIVE, buffer.length());
+        return false;
+      }
       
-      // Check for error
-      if (buffer.indexOf("ERROR") != -1) {
+      // Check for error, the code follows on the same line
+      int error = buffer.indexOf("ERROR");
+      if (error != -1) {
+        uint32_t lineStart = millis();
+        while (buffer.indexOf('\n', error) == -1 && millis() - lineStart < 100) {
+          if (simSerial.available()) {
+            c = simSerial.read();
+            buffer += c;
+            trackURC(c);
+          } else {
+            delay(1);
+          }
+        }
+        recordATLatency(cmd, millis() - start, false);
+        recordModemError(buffer);
+        endATTrace(AT_TRACE_ERROR, buffer.length());
         return false;
       }
     }
-    delay(10);
+    waitModem(10);
   }
   
+  recordATLatency(cmd, limit, true);
+  recordModemError(buffer);
+  endATTrace(AT_TRACE_TIMEOUT, buffer.length());
   return false;
 }
 
@@ -108,18 +534,14 @@ bool sendATCommand(const String& cmd, const String& expectedResp, uint32_t timeo
 bool checkNetworkRegistration() {
   Serial.println("📶 Checking network registration...");
   
-  int attempts = 0;
-  while (attempts < 30) {
+  uint32_t start = millis();
+  while (millis() - start < REGISTRATION_TIMEOUT_MS) {
     if (sendATCommand("AT+CREG?", "0,1", NETWORK_TIMEOUT) || 
         sendATCommand("AT+CREG?", "0,5", NETWORK_TIMEOUT)) {
       Serial.println("✅ Network registered");
-      
-      // Check operator
-      sendATCommand("AT+COPS?", "OK", 5000);
       return true;
     }
-    delay(2000);
-    attempts++;
+    waitModem(REGISTRATION_POLL_MS);
   }
   
   Serial.println("❌ Network registration failed");
@@ -134,12 +556,15 @@ bool isModuleReady() {
 }
 
 /*
- * Enable GNSS power
+ * Enable GNSS power with the selected profile (gnss_profile.h)
  */
 bool enableGNSSPower() {
   Serial.println("🛰️ Enabling GPS...");
+  configureGNSSProfile();
   bool result = sendATCommand("AT+CGNSPWR=1", "OK", 5000);
   if (result) {
+    modemState = MODEM_GNSS;
+    startGNSSProfile();
     Serial.println("✅ GPS powered on");
   } else {
     Serial.println("❌ Failed to power on GPS");
@@ -154,6 +579,8 @@ bool disableGNSSPower() {
   Serial.println("🛰️ Disabling GPS...");
   bool result = sendATCommand("AT+CGNSPWR=0", "OK", 5000);
   if (result) {
+    if (modemState == MODEM_GNSS) modemState = MODEM_OFF;
+    endGNSSSession();
     Serial.println("✅ GPS powered off");
   } else {
     Serial.println("❌ Failed to power off GPS");
@@ -166,12 +593,13 @@ bool disableGNSSPower() {
  */
 void clearSerialBuffer() {
   while (simSerial.available()) {
-    simSerial.read();
+    trackURC(simSerial.read());
   }
 }
 
 /*
  * Read response from module
+ * Closes the traced transaction of the command it answers, if any
  */
 String readResponse(uint32_t timeout) {
   String response = "";
@@ -181,15 +609,18 @@ String readResponse(uint32_t timeout) {
     while (simSerial.available()) {
       char c = simSerial.read();
       response += c;
+      trackURC(c);
+      noteATFirstByte();
     }
     
     if (response.length() > 0 && 
         (response.indexOf("OK") != -1 || response.indexOf("ERROR") != -1)) {
       break;
     }
-    delay(10);
+    waitModem(10);
   }
   
+  endATTrace(classifyATResponse(response), response.length());
   return response;
 }
 
@@ -201,7 +632,10 @@ bool resetModule() {
   bool result = sendATCommand("AT+CFUN=1,1", "OK", 10000);
   
   if (result) {
-    delay(10000);  // Wait for module to restart
+    modemState = MODEM_UNKNOWN;  // Module restarts with its default functionality
+    modemConfigured = false;     // and default settings
+    modemRegistered = false;
+    waitModem(10000);  // Wait for module to restart
     
     // Verify module is ready
     int attempts = 0;
@@ -215,6 +649,24 @@ bool resetModule() {
   return false;
 }
 
+/*
+ * Forget the cached session so the next use runs the full init
+ * (after a reset or power cycle outside initializeSIM7070G)
+ */
+void invalidateModemSession() {
+  sim7070gInitialized = false;
+  modemConfigured = false;
+  modemRegistered = false;
+  modemState = MODEM_UNKNOWN;
+}
+
+/*
+ * Check if the last RF enable ended registered
+ */
+bool isNetworkRegistered() {
+  return modemRegistered;
+}
+
 /*
  * Disable RF functionality (AT+CFUN=0)
  * This turns off all RF circuits to save power
@@ -223,6 +675,8 @@ bool disableRF() {
   Serial.println("📡 Disabling RF (AT+CFUN=0)...");
   bool result = sendATCommand("AT+CFUN=0", "OK", 5000);
   if (result) {
+    if (modemState == MODEM_RF) modemState = MODEM_OFF;
+    modemRegistered = false;
     Serial.println("✅ RF disabled - minimum power mode");
     delay(1000);  // Let module stabilize
   } else {
@@ -233,28 +687,136 @@ bool disableRF() {
 
 /*
  * Enable RF functionality (AT+CFUN=1)
- * This turns on RF circuits for normal operation
+ * This turns on RF circuits for normal operation. An attach restricted
+ * to the cached network that does not register is widened and retried
+ * right away instead of on the next wake.
  */
 bool enableRF() {
-  Serial.println("📡 Enabling RF (AT+CFUN=1)...");
-  bool result = sendATCommand("AT+CFUN=1", "OK", 10000);
-  if (result) {
+  bool result = false;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    // Restrict the search to the cached network (needs CFUN=0)
+    if (!modemRegistered) prepareNetworkAttach();
+
+    Serial.println("📡 Enabling RF (AT+CFUN=1)...");
+    uint32_t attachStart = millis();
+    result = sendATCommand("AT+CFUN=1", "OK", 10000);
+    if (!result) {
+      Serial.println("❌ Failed to enable RF");
+      break;
+    }
+    modemState = MODEM_RF;
     Serial.println("✅ RF enabled - full functionality");
-    delay(2000);  // Wait for RF to stabilize
-    
-    // Wait for network registration after enabling RF
-    int attempts = 0;
-    while (attempts < 10) {
+
+    // Wait for network registration after enabling RF (polling, no fixed settle delay)
+    bool wasRegistered = modemRegistered;
+    uint32_t limit = wasRegistered ? REGISTRATION_TIMEOUT_MS : getAttachWaitMs();
+    modemRegistered = false;
+    while (millis() - attachStart < limit) {
       if (sendATCommand("AT+CREG?", "0,1", 2000) || 
           sendATCommand("AT+CREG?", "0,5", 2000)) {
-        Serial.println("✅ Network registered after RF enable");
+        Serial.printf("✅ Network registered after RF enable (%lu ms)\n", millis() - attachStart);
+        modemRegistered = true;
         break;
       }
-      delay(1000);
-      attempts++;
+      waitModem(REGISTRATION_POLL_MS);
     }
-  } else {
-    Serial.println("❌ Failed to enable RF");
+    if (wasRegistered || !recordNetworkAttach(modemRegistered, millis() - attachStart)) break;
+
+    // Band and RAT can only change with RF off
+    disableRF();
   }
   return result;
-}
\ No newline at end of file
+}
+
+/*
+ * Move modem to target power state with the fewest commands
+ *
+ * GNSS and LTE share the RF path, so GNSS needs CFUN=0 and SMS needs GNSS
+ * off. Transitions to the current state are skipped, and the time of each
+ * transition is folded into an RTC-kept average used by the session planner.
+ */
+bool setModemState(ModemState target) {
+  if (target == MODEM_UNKNOWN) return false;
+  if (modemState == target) return true;
+  if (isModemPoweredOff() && !initializeSIM7070G()) return false;
+
+  ModemState from = modemState;
+  uint32_t start = millis();
+  bool ok = true;
+
+  switch (target) {
+    case MODEM_OFF:
+      if (from != MODEM_RF) ok = disableGNSSPower() && ok;
+      if (getModemSleepMode() == SLEEP_MODE_POWEROFF) {
+        ok = powerOffModem() && ok;  // Settings are lost, next use runs the full init
+        sim7070gInitialized = false;
+        modemConfigured = false;
+        modemRegistered = false;
+      } else if (isModemSleepEnabled()) {
+        ok = enterModemSleep() && ok;  // Stay attached
+      } else if (from != MODEM_GNSS) {
+        ok = disableRF() && ok;
+      }
+      break;
+
+    case MODEM_GNSS:
+      // In PSM/eDRX GNSS uses the RF path while LTE is idle, no CFUN=0 needed
+      if (from == MODEM_OFF && isModemSleepEnabled()) ok = wakeModem();
+      else if (from != MODEM_OFF && !isModemSleepEnabled()) ok = disableRF();
+      ok = ok && enableGNSSPower();
+      break;
+
+    case MODEM_RF:
+      if (from == MODEM_OFF && isModemSleepEnabled()) wakeModem();
+      if (from != MODEM_OFF) disableGNSSPower();
+      ok = enableRF();
+      break;
+
+    default:
+      break;
+  }
+
+  if (!ok) {
+    // Typed recovery, then one more try (recoverModem escalates and is time bounded)
+    Serial.printf("❌ Modem %d -> %d failed (%s)\n", from, target, modemErrorName(lastModemError));
+    return recoverModem(lastModemError) && setModemState(target);
+  }
+  modemState = target;
+  resetModemRecovery();
+  if (target == MODEM_RF) recordModemAttach(millis() - start);
+
+  // Learn transition time (EWMA, alpha = 1/4)
+  if (from != MODEM_UNKNOWN) {
+    uint32_t elapsed = millis() - start;
+    uint32_t& avg = modemTransitionMs[from][target];
+    avg = (avg == 0) ? elapsed : (avg * 3 + elapsed) / 4;
+  }
+  return true;
+}
+
+/*
+ * Forget learned transition times (e.g. after the sleep mode changed)
+ */
+void resetModemTransitionEstimates() {
+  memset(modemTransitionMs, 0, sizeof(modemTransitionMs));
+}
+
+/*
+ * Get tracked modem power state
+ */
+ModemState getModemState() {
+  return modemState;
+}
+
+/*
+ * Expected duration of a modem state transition in milliseconds
+ */
+uint32_t getModemTransitionEstimate(ModemState from, ModemState to) {
+  if (from == to) return 0;
+  if (from == MODEM_UNKNOWN) from = MODEM_RF;  // Worst case
+  if (to == MODEM_UNKNOWN) return 0;
+
+  uint32_t measured = modemTransitionMs[from][to];
+  return measured ? measured : DEFAULT_TRANSITION_MS[from][to];
+}
@@ -10,27 +10,80 @@
 
 #include <Arduino.h>
 #include <HardwareSerial.h>
+#include "modem_transcript.h"
 
 // Pin definitions for UART communication
 #define SIM_TX_PIN 4
 #define SIM_RX_PIN 5
 
+// UART link
+#define SIM_BAUD_DEFAULT        115200  // Module factory rate
+#define SIM_RX_BUFFER_SIZE      4096    // Driver RX buffer, holds CARECV/CMGL bursts at high rates
+#define SIM_BAUD_VERIFY_PROBES  5       // Clean round trips required to accept a rate
+#define SIM_BAUD_VERIFY_TRIES   2       // Verify rounds before a rate counts as unreliable
+#define SIM_BAUD_CEILING_INITS  50      // Full inits before a lowered ceiling is tried again
+#define SIM_PREFS_NAMESPACE     "sim7070g"
+
 // Timeout values
 #define DEFAULT_TIMEOUT 2000
 #define NETWORK_TIMEOUT 5000
 #define SMS_TIMEOUT 30000
 #define GPS_TIMEOUT 10000
+#define REGISTRATION_TIMEOUT_MS 45000  // Wait for network registration
+#define REGISTRATION_POLL_MS    500
+#define MODEM_IDLE_SLICE_MS     20     // waitModem() runs the idle handler at least this often
+
+// Modem power states used by report sessions
+enum ModemState {
+  MODEM_OFF,      // CFUN=0 (or PSM/eDRX sleep, see modem_sleep.h), GNSS off
+  MODEM_GNSS,     // CFUN=0, GNSS on (GNSS and LTE share the RF path)
+  MODEM_RF,       // CFUN=1, GNSS off
+  MODEM_UNKNOWN   // Not yet commanded since boot/wake
+};
+#define MODEM_STATE_COUNT 3  // Known states (excludes MODEM_UNKNOWN)
+
+// Typed modem errors (from +CME ERROR / +CMS ERROR codes, AT+CMEE=1)
+enum ModemError : uint8_t {
+  MODEM_ERR_NONE,
+  MODEM_ERR_TIMEOUT,       // No final result code
+  MODEM_ERR_GENERIC,       // Plain ERROR or unknown code
+  MODEM_ERR_NOT_ALLOWED,   // CME 3/4 - operation not allowed in the current mode
+  MODEM_ERR_SIM,           // CME 10-18, CMS 310-316 - SIM missing, locked or busy
+  MODEM_ERR_MEMORY,        // CME 20-23, CMS 320-322 - storage full or failure
+  MODEM_ERR_NO_NETWORK,    // CME 30-32, CMS 330-332 - no service or network timeout
+  MODEM_ERR_SMS_MODE,      // CMS 300-305 - SMS command not valid in the current mode
+  MODEM_ERR_SMS_REJECTED,  // CMS 1-127 - network refused the message
+  MODEM_ERR_COUNT
+};
 
 // External serial object (defined in .cpp)
+#if MODEM_TRANSCRIPT
+extern TranscriptSerial simSerial;
+#else
 extern HardwareSerial simSerial;
+#endif
 
 // Module initialization and control
 bool initializeSIM7070G();
 bool isSIM7070GInitialized();
+void printModemSession();
 bool sendATCommand(const String& cmd, const String& expectedResp, uint32_t timeout = DEFAULT_TIMEOUT);
 bool checkNetworkRegistration();
 bool isModuleReady();
 bool resetModule();
+void invalidateModemSession();
+bool isNetworkRegistered();
+
+// Error reporting
+ModemError recordModemError(const String& response);
+ModemError getLastModemError();
+int getLastModemErrorCode();
+const char* modemErrorName(ModemError error);
+
+// Baud rate negotiation (AT+IPR)
+bool negotiateBaudRate();
+bool probeModemLink(bool scanRates = true);
+uint32_t getSIMBaudRate();
 
 // Power management
 bool enableGNSSPower();
@@ -38,6 +91,22 @@ bool disableGNSSPower();
 bool disableRF();  // Turn off RF with AT+CFUN=0
 bool enableRF();   // Turn on RF with AT+CFUN=1
 
+// Modem state tracking (skips redundant transitions)
+bool setModemState(ModemState target);
+ModemState getModemState();
+uint32_t getModemTransitionEstimate(ModemState from, ModemState to);
+void resetModemTransitionEstimates();
+
+// Unsolicited result codes
+bool hasInboundSMSNotification();
+void clearInboundSMSNotification();
+char readModemByte();
+
+// Work done while waiting on the module (IMU sampling for the track filter)
+typedef void (*ModemIdleHandler)();
+void setModemIdleHandler(ModemIdleHandler handler);
+void waitModem(uint32_t ms);   // delay() that keeps the idle handler running
+
 // Utility functions
 void clearSerialBuffer();
 String readResponse(uint32_t timeout = DEFAULT_TIMEOUT);
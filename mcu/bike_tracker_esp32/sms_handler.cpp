@@ -6,16 +6,30 @@
 
 #include "sms_handler.h"
 #include "sim7070g.h"
+#include "sms_outbox.h"
+#include "signal_quality.h"
+#include "modem_recovery.h"
+#include "at_stats.h"
+#include "at_trace.h"
+#include "sms_report.h"
 #include <Preferences.h>
 
 // Constants
 static const uint16_t SMS_MAX_LENGTH = 160;  // Standard SMS character limit
 static const uint16_t SMS_TIMEOUT_MS = 10000;
 static const uint16_t SMS_PROMPT_TIMEOUT_MS = 2000;
+static const uint16_t SMS_PART_PROMPT_TIMEOUT_MS = 5000;
+static const uint16_t SMS_CONFIRM_TIMEOUT_MS = 15000;
+static const uint16_t SMS_INBOX_TIMEOUT_MS = 5000;
 
 // Track last SMS time
 static unsigned long lastSMSTime = 0;
 static Preferences smsPrefs;
+static SMSCommandHandler smsCommandHandler = nullptr;
+
+// Concatenated SMS reference, kept across deep sleep so parts of messages
+// from consecutive wakes never share a reference on the phone
+RTC_DATA_ATTR uint8_t concatRef = 0;
 
 /*
  * Send SMS message to specified phone number
@@ -42,12 +56,15 @@ bool sendSMS(const String& phoneNumber, const String& message) {
   // Send recipient number
   clearSerialBuffer();
   simSerial.println("AT+CMGS=\"" + phoneNumber + "\"");
+  beginATTrace("AT+CMGS", phoneNumber.length() + message.length() + 13);
   delay(100);
   
   // Wait for prompt
   uint32_t start = millis();
   while (millis() - start < SMS_PROMPT_TIMEOUT_MS) {
-    if (simSerial.available() && simSerial.read() == '>') {
+    if (simSerial.available() && readModemByte() == '>') {
+      noteATFirstByte();
+
       // Send message
       simSerial.print(message);
       simSerial.write(26);  // Ctrl+Z
@@ -57,23 +74,26 @@ bool sendSMS(const String& phoneNumber, const String& message) {
       start = millis();
       while (millis() - start < SMS_TIMEOUT_MS) {
         if (simSerial.available()) {
-          response += (char)simSerial.read();
+          response += readModemByte();
           if (response.indexOf("+CMGS:") != -1) {
+            endATTrace(AT_TRACE_OK, response.length());
             updateLastSMSTime();
             return true;
           }
           if (response.indexOf("ERROR") != -1 || response.indexOf("+CMS ERROR") != -1) {
+            endATTrace(AT_TRACE_ERROR, response.length());
             Serial.println("❌ SMS send error");
             return false;
           }
         }
-        delay(10);
+        waitModem(10);
       }
       break;
     }
   }
   
   // Cleanup on failure
+  endATTrace(AT_TRACE_TIMEOUT, 0);
   simSerial.write(27);
   clearSerialBuffer();
   Serial.println("❌ SMS send timeout");
@@ -81,259 +101,416 @@ bool sendSMS(const String& phoneNumber, const String& message) {
 }
 
 /*
- * Send SMS pair - optimized for two messages
+ * Map an ASCII character to GSM 03.38 default alphabet septets
+ * Characters from the extension table take two septets (ESC + code)
+ * Returns number of septets written (0 if out of space)
  */
-bool sendSMSPair(const String& phoneNumber, const String& firstMsg, const String& secondMsg) {
-  // Clear pending mode
-  simSerial.write(27);
-  delay(500);  // Reduced delay
-  
-  // Quick module check
-  if (!sendATCommand("AT", "OK", 1000)) {
-    Serial.println("❌ Module not responding");
-    return false;
+static int asciiToGSM7(char c, uint8_t* out, int space) {
+  uint8_t ext = 0;
+  uint8_t code;
+
+  switch (c) {
+    case '@': code = 0x00; break;
+    case '$': code = 0x02; break;
+    case '_': code = 0x11; break;
+    case '^': ext = 0x14; break;
+    case '{': ext = 0x28; break;
+    case '}': ext = 0x29; break;
+    case '\\': ext = 0x2F; break;
+    case '[': ext = 0x3C; break;
+    case '~': ext = 0x3D; break;
+    case ']': ext = 0x3E; break;
+    case '|': ext = 0x40; break;
+    case '\n': code = 0x0A; break;
+    case '\r': code = 0x0D; break;
+    default:
+      // Remaining printable ASCII shares its code point with GSM 7-bit
+      code = (c >= 0x20 && c <= 0x7E && c != '`') ? (uint8_t)c : '?';
+      break;
   }
-  
-  if (!checkNetworkRegistration()) {
-    Serial.println("❌ Network not registered");
-    return false;
+
+  if (ext) {
+    if (space < 2) return 0;
+    out[0] = 0x1B;
+    out[1] = ext;
+    return 2;
   }
-  delay(1000);  // Reduced delay
-  
-  // Send first message
-  Serial.println("📱 Sending first SMS (geo URI)...");
-  if (!sendATCommand("AT+CMGF=1", "OK")) {
-    Serial.println("❌ Failed to set text mode");
-    return false;
+
+  if (space < 1) return 0;
+  out[0] = code;
+  return 1;
+}
+
+/*
+ * Encode phone number as TP-DA (length, type, swapped BCD digits)
+ * Returns number of octets written
+ */
+static int encodeAddress(const String& phoneNumber, uint8_t* out) {
+  const char* num = phoneNumber.c_str();
+  uint8_t type = 0x81;  // Unknown/national
+
+  if (*num == '+') {
+    type = 0x91;  // International
+    num++;
   }
-  delay(500);
-  
-  String cmd = "AT+CMGS=\"" + phoneNumber + "\"";
-  simSerial.print(cmd);
-  simSerial.println();
-  
-  delay(1000);  // Reduced delay
+
+  int digits = 0;
+  int pos = 2;
+  for (; *num; num++) {
+    if (*num < '0' || *num > '9') continue;
+    uint8_t d = *num - '0';
+    if (digits % 2 == 0) {
+      out[pos] = 0xF0 | d;
+    } else {
+      out[pos] = (out[pos] & 0x0F) | (d << 4);
+      pos++;
+    }
+    digits++;
+  }
+  if (digits % 2) pos++;
+
+  out[0] = digits;
+  out[1] = type;
+  return pos;
+}
+
+/*
+ * Build one SMS-SUBMIT TPDU (without SMSC field)
+ * Septets are packed after an optional concatenation UDH, with fill bits
+ * so the text starts on a septet boundary
+ * Returns TPDU length in octets
+ */
+static int buildSubmitPDU(uint8_t* pdu, const String& phoneNumber,
+                          const uint8_t* septets, int septetCount,
+                          uint8_t ref, uint8_t totalParts, uint8_t partNum) {
+  bool concat = totalParts > 1;
+  int pos = 0;
+
+  pdu[pos++] = concat ? 0x51 : 0x11;  // SMS-SUBMIT, relative VP, UDHI if concatenated
+  pdu[pos++] = 0x00;                  // Message reference (set by module)
+  pos += encodeAddress(phoneNumber, pdu + pos);
+  pdu[pos++] = 0x00;                  // PID
+  pdu[pos++] = 0x00;                  // DCS: GSM 7-bit default alphabet
+  pdu[pos++] = 0xA7;                  // VP: 24 hours (matches AT+CSMP=17,167)
+
+  int udhSeptets = concat ? SMS_UDH_SEPTETS : 0;
+  pdu[pos++] = udhSeptets + septetCount;  // UDL in septets
+
+  uint8_t* ud = pdu + pos;
+  int udOctets = ((udhSeptets + septetCount) * 7 + 7) / 8;
+  memset(ud, 0, udOctets);
+
+  if (concat) {
+    ud[0] = 0x05;        // UDHL
+    ud[1] = 0x00;        // IEI: concatenated SMS, 8-bit reference
+    ud[2] = 0x03;        // IEDL
+    ud[3] = ref;
+    ud[4] = totalParts;
+    ud[5] = partNum;
+  }
+
+  // Pack septets LSB first, starting after the UDH septets
+  int bit = udhSeptets * 7;
+  for (int i = 0; i < septetCount; i++, bit += 7) {
+    int byteIdx = bit / 8;
+    int shift = bit % 8;
+    ud[byteIdx] |= (uint8_t)(septets[i] << shift);
+    if (shift > 1) {
+      ud[byteIdx + 1] |= septets[i] >> (8 - shift);
+    }
+  }
+
+  return pos + udOctets;
+}
+
+/*
+ * Submit one PDU with AT+CMGS and wait for confirmation
+ * Modem must already be in PDU mode (AT+CMGF=0)
+ */
+static bool submitPDU(const uint8_t* pdu, int len) {
+  static const char hex[] = "0123456789ABCDEF";
+
+  char cmd[16];
+  snprintf(cmd, sizeof(cmd), "AT+CMGS=%d", len);
+  clearSerialBuffer();
+  simSerial.println(cmd);
+  beginATTrace(cmd, strlen(cmd) + 2 + (len + 1) * 2 + 1);  // Command, hex PDU with SMSC byte, Ctrl+Z
+
+  // Wait for prompt
   bool promptReceived = false;
-  unsigned long start = millis();
-  
-  while (millis() - start < 3000) {  // Reduced timeout
+  uint32_t start = millis();
+  while (millis() - start < SMS_PART_PROMPT_TIMEOUT_MS) {
     if (simSerial.available()) {
-      char c = simSerial.read();
-      if (c == '>') {
+      noteATFirstByte();
+      if (readModemByte() == '>') {
         promptReceived = true;
         break;
       }
     }
-    delay(10);
+    delay(5);
   }
-  
+
   if (!promptReceived) {
-    Serial.println("❌ No SMS prompt for first message");
+    endATTrace(AT_TRACE_TIMEOUT, 0);
+    Serial.println("❌ No SMS prompt");
     simSerial.write(27);
-    delay(500);
     clearSerialBuffer();
     return false;
   }
-  
-  // Send first message content
-  delay(100);
-  simSerial.print(firstMsg);
-  delay(100);
+
+  // "00" = use SMSC stored on the SIM
+  simSerial.print("00");
+  for (int i = 0; i < len; i++) {
+    simSerial.write(hex[pdu[i] >> 4]);
+    simSerial.write(hex[pdu[i] & 0x0F]);
+  }
   simSerial.write(26);  // Ctrl+Z
-  
-  // Wait for first message confirmation
-  start = millis();
+
+  // Wait for confirmation (learned network submit time, longer for urgent sends in poor coverage)
   String response = "";
-  bool firstSent = false;
-  
-  while (millis() - start < 15000) {  // Reduced timeout
-    if (simSerial.available()) {
-      char c = simSerial.read();
-      response += c;
-      if (response.indexOf("+CMGS:") != -1 && response.indexOf("OK") != -1) {
-        firstSent = true;
-        Serial.println("✅ First SMS sent");
-        break;
-      }
-      if (response.indexOf("ERROR") != -1 || response.indexOf("+CMS ERROR") != -1) {
-        Serial.println("❌ First SMS failed - aborting");
-        return false;
-      }
+  uint32_t limit = getSignalTimeout(getAdaptiveTimeout("AT+CMGS", SMS_CONFIRM_TIMEOUT_MS));
+  start = millis();
+  while (millis() - start < limit) {
+    while (simSerial.available()) {
+      response += readModemByte();
     }
-    delay(10);
+    if (response.indexOf("+CMGS:") != -1 && response.indexOf("OK") != -1) {
+      recordATLatency("AT+CMGS", millis() - start, false);
+      endATTrace(AT_TRACE_OK, response.length());
+      return true;
+    }
+    if (response.indexOf("ERROR") != -1) {
+      recordModemError(response);
+      endATTrace(AT_TRACE_ERROR, response.length());
+      Serial.printf("❌ SMS part rejected (%s): %s\n", modemErrorName(getLastModemError()), response.c_str());
+      return false;
+    }
+    waitModem(10);
   }
-  
-  if (!firstSent) {
-    Serial.println("❌ First SMS timeout");
+
+  recordATLatency("AT+CMGS", limit, true);
+  endATTrace(AT_TRACE_TIMEOUT, response.length());
+  Serial.println("❌ SMS part confirmation timeout");
+  return false;
+}
+
+/*
+ * Checks module and registration and switches to PDU mode
+ */
+static bool preparePDUMode() {
+  // Exit any pending SMS mode
+  simSerial.write(27);
+  clearSerialBuffer();
+
+  if (!sendATCommand("AT", "OK", 1000)) {
+    Serial.println("❌ Module not responding");
     return false;
   }
-  
-  // Send second message with minimal delay
-  delay(2000);  // Reduced delay between messages
-  Serial.println("📱 Sending second SMS (instructions)...");
-  
-  // Clear buffer and send second message
-  clearSerialBuffer();
-  
-  // Re-set text mode quickly
+
+  if (!checkNetworkRegistration()) {
+    Serial.println("❌ Network not registered");
+    return false;
+  }
+
+  if (!sendATCommand("AT+CMGF=0", "OK", 1000)) {
+    Serial.println("❌ Failed to set PDU mode");
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Prepare modem for PDU submissions once per RF session
+ * A failure goes through the recovery policy before one more try
+ */
+bool beginSMSSession() {
+  if (preparePDUMode()) {
+    resetModemRecovery();
+    return true;
+  }
+  ModemError error = getLastModemError();
+  if (!isNetworkRegistered()) error = MODEM_ERR_NO_NETWORK;
+  return recoverModem(error) && preparePDUMode();
+}
+
+/*
+ * Restore text mode for the rest of the firmware
+ */
+void endSMSSession() {
   sendATCommand("AT+CMGF=1", "OK", 1000);
-  delay(300);  // Reduced delay
-  
-  cmd = "AT+CMGS=\"" + phoneNumber + "\"";
-  simSerial.print(cmd);
-  simSerial.println();
-  
-  delay(2000);
-  promptReceived = false;
-  start = millis();
-  
-  while (millis() - start < 5000) {
-    if (simSerial.available()) {
-      char c = simSerial.read();
-      if (c == '>') {
-        promptReceived = true;
-        break;
-      }
+}
+
+/*
+ * Submit message as a single (possibly concatenated) SMS
+ *
+ * Text is encoded in the GSM 7-bit alphabet and split into parts of
+ * SMS_CONCAT_SEPTETS with a concatenation UDH, so the phone shows one
+ * message. Parts are submitted back-to-back without fixed delays.
+ * Extension characters are never split across parts.
+ * Requires beginSMSSession().
+ */
+bool submitConcatenatedSMS(const String& phoneNumber, const String& message) {
+  static uint8_t septets[SMS_MAX_PARTS * SMS_CONCAT_SEPTETS];
+  static uint8_t pdu[SMS_PDU_MAX_OCTETS];
+
+  // Convert text to septets
+  int septetCount = 0;
+  for (unsigned int i = 0; i < message.length(); i++) {
+    int n = asciiToGSM7(message[i], septets + septetCount, sizeof(septets) - septetCount);
+    if (n == 0) {
+      Serial.println("⚠️ SMS text truncated to max parts");
+      break;
     }
-    delay(10);
+    septetCount += n;
   }
-  
-  if (!promptReceived) {
-    Serial.println("⚠️ No prompt for second message");
-    simSerial.write(27);
-    delay(500);
-    clearSerialBuffer();
-    return true;  // First message was sent
+
+  // Count parts without splitting escape sequences
+  int partStart[SMS_MAX_PARTS + 1];
+  int totalParts = 0;
+  if (septetCount <= SMS_SINGLE_SEPTETS) {
+    partStart[0] = 0;
+    totalParts = 1;
+  } else {
+    int pos = 0;
+    while (pos < septetCount && totalParts < SMS_MAX_PARTS) {
+      partStart[totalParts++] = pos;
+      int end = min(pos + SMS_CONCAT_SEPTETS, septetCount);
+      if (end < septetCount && septets[end - 1] == 0x1B) end--;
+      pos = end;
+    }
+    septetCount = pos;
   }
-  
-  // Send second message content
-  delay(100);
-  simSerial.print(secondMsg);
-  delay(100);
-  simSerial.write(26);  // Ctrl+Z
-  
-  // Wait for second message confirmation
-  start = millis();
-  response = "";
-  
-  while (millis() - start < 30000) {
-    if (simSerial.available()) {
-      char c = simSerial.read();
-      response += c;
-      if (response.indexOf("+CMGS:") != -1 && response.indexOf("OK") != -1) {
-        Serial.println("✅ Second SMS sent");
-        updateLastSMSTime();
-        return true;
-      }
-      if (response.indexOf("ERROR") != -1 || response.indexOf("+CMS ERROR") != -1) {
-        Serial.println("⚠️ Second SMS failed");
-        break;
-      }
+  partStart[totalParts] = septetCount;
+
+  Serial.printf("📱 Sending SMS to %s (%d septets, %d part%s)...\n", phoneNumber.c_str(),
+                septetCount, totalParts, totalParts > 1 ? "s" : "");
+
+  concatRef++;
+  for (int part = 0; part < totalParts; part++) {
+    int len = buildSubmitPDU(pdu, phoneNumber,
+                             septets + partStart[part],
+                             partStart[part + 1] - partStart[part],
+                             concatRef, totalParts, part + 1);
+    if (!submitPDU(pdu, len)) {
+      Serial.printf("❌ SMS part %d/%d failed\n", part + 1, totalParts);
+      return false;
     }
-    delay(10);
+    Serial.printf("✅ SMS part %d/%d sent\n", part + 1, totalParts);
   }
-  
-  updateLastSMSTime();  // Update time since first message was sent
-  return true;  // Success if first message was sent
+
+  updateLastSMSTime();
+  return true;
+}
+
+/*
+ * Send message as a single (possibly concatenated) SMS using PDU mode
+ */
+bool sendConcatenatedSMS(const String& phoneNumber, const String& message) {
+  if (!beginSMSSession()) return false;
+  bool success = submitConcatenatedSMS(phoneNumber, message);
+  endSMSSession();
+  return success;
+}
+
+/*
+ * Collect numbers of recipients subscribed to an alert type
+ */
+static int selectRecipients(const SMSRecipientList& recipients, AlertType type, const char* numbers[]) {
+  int count = 0;
+  for (int i = 0; i < recipients.count && i < MAX_SMS_RECIPIENTS; i++) {
+    const SMSRecipient& r = recipients.entries[i];
+    if (r.number[0] != '\0' && (r.alertMask & ALERT_MASK(type))) {
+      numbers[count++] = r.number;
+    }
+  }
+  return count;
 }
 
 /*
  * Send location SMS with GPS coordinates
- * Sends two messages: 1st with geo URI, 2nd with instructions
+ * Report text is chosen by encodeReport() to use the fewest segments.
+ * Test alerts only go to the primary number.
  */
-bool sendLocationSMS(const String& phoneNumber, const GPSData& gpsData, AlertType type) {
+bool sendLocationSMS(const SMSRecipientList& recipients, const GPSData& gpsData, AlertType type) {
   if (!gpsData.valid) {
     Serial.println("⚠️ Invalid GPS data, cannot send location SMS");
     return false;
   }
+
+  // Test alerts only go to the primary; nobody subscribed - no RF session for nothing
+  const char* primary = recipients.entries[0].number;
+  const char* numbers[MAX_SMS_RECIPIENTS];
+  int count = selectRecipients(recipients, type, numbers);
+  if (type != ALERT_TEST && count == 0) return true;
   
   // CRITICAL: Enable RF for SMS operation (GPS and SMS share RF)
-  // First disable GPS if it was on
-  disableGNSSPower();
-  delay(500);
-  // Then enable RF for SMS
-  enableRF();
-  delay(1000);  // Let RF stabilize
-  
-  // First message: geo URI only
-  String firstMessage = "geo:" + gpsData.latitude + "," + gpsData.longitude;
-  
-  // Second message: instructions with coordinates
-  String secondMessage;
-  secondMessage.reserve(150);
-  secondMessage = "If the map did not load, Please Copy and Paste the Lat and Long to your Map application.\n";
-  secondMessage += "Location: " + gpsData.latitude + " " + gpsData.longitude + "\n";
-  secondMessage += "Speed: ";
-  secondMessage += (gpsData.speed.length() > 0) ? 
-    (String(gpsData.speed.toFloat(), 1) + " km/h") : "N/A";
-  
-  // Add alert type indicator
-  switch (type) {
-    case ALERT_LOCATION_UPDATE:
-      secondMessage += "\nLocation Update";
-      break;
-    case ALERT_TEST:
-      secondMessage += "\nTest Alert";
-      break;
-    case ALERT_LOW_BATTERY:
-      secondMessage += "\nLow Battery Alert";
-      break;
-    case ALERT_BLE_DISCONNECT:
-      secondMessage += "\nBLE Disconnected Alert";
-      break;
-    default:
-      break;
+  // Turns GPS off first if it was on; no-op if RF is already up
+  setModemState(MODEM_RF);
+  
+  static char message[REPORT_MAX_LEN + 1];
+  ReportInfo report = {REPORT_LOCATION, type, &gpsData, false, 0};
+  encodeReport(report, message, sizeof(message));
+  
+  // Test alerts are interactive and not queued; other reports go through the outbox
+  bool result;
+  if (type == ALERT_TEST) {
+    result = sendConcatenatedSMS(primary, message);
+    if (result) flushSMSOutbox();
+  } else {
+    OutboxKind kind = (type == ALERT_LOW_BATTERY) ? OUTBOX_ALERT : OUTBOX_REPORT;
+    result = sendOrQueueSMS(kind, numbers, count, message) == count;
   }
   
-  // Use the optimized SMS pair function
-  bool result = sendSMSPair(phoneNumber, firstMessage, secondMessage);
-  
-  // After SMS, disable RF to save power
-  Serial.println("📡 Disabling RF after SMS...");
-  disableRF();
-  
+  // Pick up commands while RF is still on
+  checkInboundSMS(primary);
+    
   return result;
 }
 
+/*
+ * Queue a report for the extra recipients of an uplinked report
+ * The data uplink already reached the primary number (clear its mask in
+ * the list), the others subscribed to ALERT_BLE_DISCONNECT get the SMS
+ * from the session's next flushSMSOutbox().
+ *
+ * @return number of recipients queued
+ */
+int queueReportSMS(const SMSRecipientList& recipients, const char* message) {
+  const char* numbers[MAX_SMS_RECIPIENTS];
+  int count = selectRecipients(recipients, ALERT_BLE_DISCONNECT, numbers);
+  queueSMS(OUTBOX_REPORT, numbers, count, message);
+  return count;
+}
+
 /*
  * Send BLE disconnect SMS with device status
  * Includes GPS location, user presence, and SMS interval
+ * Delivered to every recipient subscribed to ALERT_BLE_DISCONNECT
  */
-bool sendDisconnectSMS(const String& phoneNumber, const GPSData& gpsData, bool userPresent, uint16_t updateInterval) {
+bool sendDisconnectSMS(const SMSRecipientList& recipients, const GPSData& gpsData, bool userPresent, uint16_t updateInterval) {
   // Note: GPS validity should be checked before calling this function
   // Use sendNoLocationSMS() for cases where GPS is unavailable
 
+  // Nobody subscribed - no RF session for nothing
+  const char* numbers[MAX_SMS_RECIPIENTS];
+  int count = selectRecipients(recipients, ALERT_BLE_DISCONNECT, numbers);
+  if (count == 0) return true;
+
   // CRITICAL: Enable RF for SMS operation (GPS and SMS share RF)
-  // First disable GPS if it was on
-  disableGNSSPower();
-  delay(500);
-  // Then enable RF for SMS
-  enableRF();
-  delay(1000);  // Let RF stabilize
-  
-  // First message: geo URI only
-  String firstMessage = "geo:" + gpsData.latitude + "," + gpsData.longitude;
+  // Turns GPS off first if it was on; no-op if RF is already up
+  setModemState(MODEM_RF);
   
-  // Second message: optimized string building
-  String secondMessage;
-  secondMessage.reserve(200);
-  secondMessage = "If map did not load, copy coordinates to your map app\n";
-  secondMessage += "Location: " + gpsData.latitude + "," + gpsData.longitude + "\n";
-  secondMessage += "Speed: ";
-  secondMessage += (gpsData.speed.length() > 0) ? 
-    (String(gpsData.speed.toFloat(), 1) + " km/h") : "N/A";
-  secondMessage += "\n\nDevice Status\n";
-  secondMessage += "User: ";
-  secondMessage += userPresent ? "Present" : "Away";
-  secondMessage += "\nSMS Interval: " + String(updateInterval) + " sec";
+  static char message[REPORT_MAX_LEN + 1];
+  ReportInfo report = {REPORT_STATUS, ALERT_BLE_DISCONNECT, &gpsData, userPresent, updateInterval};
+  encodeReport(report, message, sizeof(message));
   
-  // Use the optimized SMS pair function
-  bool result = sendSMSPair(phoneNumber, firstMessage, secondMessage);
-  
-  // After SMS, disable RF to save power
-  Serial.println("📡 Disabling RF after SMS...");
-  disableRF();
+  // Send now or keep in outbox (replaces any older pending report)
+  bool result = sendOrQueueSMS(OUTBOX_REPORT, numbers, count, message) == count;
   
+  // Pick up commands while RF is still on
+  checkInboundSMS(recipients.entries[0].number);
+    
   return result;
 }
 
@@ -345,77 +522,79 @@ bool sendDisconnectSMS(const String& phoneNumber, const GPSData& gpsData, bool u
  * - GPS acquisition completely fails (GPS_NONE)
  * - Cached GPS limit reached (CACHED_GPS_LIMIT consecutive cached sends)
  *
- * Uses char buffer instead of String to avoid heap fragmentation.
+ * A failed send is kept in the SMS outbox for the next RF session.
  *
- * @param phoneNumber    Phone number to send SMS to
+ * @param recipients     Recipients (those subscribed to ALERT_BLE_DISCONNECT get it)
  * @param userPresent    Whether IR sensor detects user presence
  * @param hasCachedGPS   Whether valid cached GPS data exists
  * @param cachedGPS      Last known GPS data (may be outdated)
  * @param updateInterval SMS update interval in seconds
- * @return true if SMS sent successfully, false otherwise
+ * @return true if SMS sent successfully, false if it failed or was queued
  */
-bool sendNoLocationSMS(const String& phoneNumber, bool userPresent, bool hasCachedGPS, const GPSData& cachedGPS, uint16_t updateInterval) {
+bool sendNoLocationSMS(const SMSRecipientList& recipients, bool userPresent, bool hasCachedGPS, const GPSData& cachedGPS, uint16_t updateInterval) {
+  const char* numbers[MAX_SMS_RECIPIENTS];
+  int count = selectRecipients(recipients, ALERT_BLE_DISCONNECT, numbers);
+  if (count == 0) return true;
+
   Serial.println("📱 Sending no-location alert SMS...");
 
   // CRITICAL: Enable RF for SMS operation
-  disableGNSSPower();
-  delay(500);
-  enableRF();
-  delay(1000);
+  setModemState(MODEM_RF);
 
-  // Use char buffer to avoid String heap fragmentation
-  // Keep message under SMS_MAX_LENGTH to fit in single SMS
-  static char message[SMS_MAX_LENGTH];
-  int offset = 0;
-
-  if (hasCachedGPS && cachedGPS.valid) {
-    // Validate GPS strings before using them
-    const char* lat = cachedGPS.latitude.c_str();
-    const char* lon = cachedGPS.longitude.c_str();
-
-    // Check if coordinates are valid (not empty and not "0.000000")
-    if (lat && lon && strlen(lat) > 0 && strlen(lon) > 0 &&
-        strcmp(lat, "0.000000") != 0 && strcmp(lon, "0.000000") != 0) {
-      // Compact format with last known location
-      offset += snprintf(message + offset, sizeof(message) - offset,
-                        "ALERT: GPS FAIL\n"
-                        "Last known:\n"
-                        "geo:%s,%s\n"
-                        "(OUTDATED)\n"
-                        "User:%s Int:%ds",
-                        lat, lon,
-                        userPresent ? "Yes" : "No",
-                        updateInterval);
-      Serial.printf("🗺️ Including cached GPS: %s, %s\n", lat, lon);
-    } else {
-      Serial.println("⚠️ Cached GPS coordinates invalid, skipping");
-      offset += snprintf(message + offset, sizeof(message) - offset,
-                        "ALERT: GPS FAIL\n"
-                        "No location available\n"
-                        "GPS never acquired\n"
-                        "User:%s Int:%ds",
-                        userPresent ? "Yes" : "No",
-                        updateInterval);
-    }
-  } else {
-    // No cached GPS at all
-    offset += snprintf(message + offset, sizeof(message) - offset,
-                      "ALERT: GPS FAIL\n"
-                      "No location available\n"
-                      "GPS never acquired\n"
-                      "User:%s Int:%ds",
-                      userPresent ? "Yes" : "No",
-                      updateInterval);
+  // Only include cached coordinates that look valid (not "0.000000")
+  bool useCached = hasCachedGPS && cachedGPS.valid &&
+                   cachedGPS.latitude != "0.000000" && cachedGPS.longitude != "0.000000";
+  if (hasCachedGPS && !useCached) {
+    Serial.println("⚠️ Cached GPS coordinates invalid, skipping");
   }
 
-  Serial.printf("📝 SMS message length: %d bytes\n", offset);
+  static char message[REPORT_MAX_LEN + 1];
+  ReportInfo report = {REPORT_NO_FIX, ALERT_LOCATION_UPDATE, useCached ? &cachedGPS : nullptr,
+                       userPresent, updateInterval};
+  int length = encodeReport(report, message, sizeof(message));
+
+  Serial.printf("📝 SMS message length: %d bytes\n", length);
   Serial.printf("📄 SMS content:\n%s\n", message);
 
-  bool result = sendSMS(phoneNumber, String(message));
+  bool result = sendOrQueueSMS(OUTBOX_REPORT, numbers, count, message) == count;
+
+  // Pick up commands while RF is still on
+  checkInboundSMS(recipients.entries[0].number);
+
+  return result;
+}
+
+/*
+ * Send SMS with a cell tower location when GPS failed
+ *
+ * Uses the LBS position when it was resolved, otherwise the serving cell
+ * identity so the location can still be looked up by the recipient.
+ *
+ * @param recipients     Recipients (those subscribed to ALERT_BLE_DISCONNECT get it)
+ * @param cell           Result of locateByCell()
+ * @param userPresent    Whether IR sensor detects user presence
+ * @param updateInterval SMS update interval in seconds
+ * @return true if SMS sent successfully, false if it failed or was queued
+ */
+bool sendCellLocationSMS(const SMSRecipientList& recipients, const CellLocation& cell, bool userPresent, uint16_t updateInterval) {
+  const char* numbers[MAX_SMS_RECIPIENTS];
+  int count = selectRecipients(recipients, ALERT_BLE_DISCONNECT, numbers);
+  if (count == 0) return true;
+
+  Serial.println("📱 Sending cell location SMS...");
 
-  // After SMS, disable RF to save power
-  Serial.println("📡 Disabling RF after SMS...");
-  disableRF();
+  // CRITICAL: Enable RF for SMS operation
+  setModemState(MODEM_RF);
+
+  static char message[REPORT_MAX_LEN + 1];
+  ReportInfo report = {REPORT_CELL, ALERT_BLE_DISCONNECT, cell.resolved ? &cell.position : nullptr,
+                       userPresent, updateInterval, &cell};
+  encodeReport(report, message, sizeof(message));
+
+  bool result = sendOrQueueSMS(OUTBOX_REPORT, numbers, count, message) == count;
+
+  // Pick up commands while RF is still on
+  checkInboundSMS(recipients.entries[0].number);
 
   return result;
 }
@@ -433,17 +612,181 @@ bool sendTestSMS(const String& phoneNumber) {
            millis() / 1000);
 
   // Enable RF for SMS
-  enableRF();
-  delay(1000);
+  setModemState(MODEM_RF);
 
   bool result = sendSMS(phoneNumber, String(message));
-
-  // Disable RF after SMS to save power
-  disableRF();
+  if (result) flushSMSOutbox();  // Deliver anything left from earlier sessions
+  checkInboundSMS(phoneNumber);
 
   return result;
 }
 
+/*
+ * Register handler for authenticated inbound SMS commands
+ */
+void setSMSCommandHandler(SMSCommandHandler handler) {
+  smsCommandHandler = handler;
+}
+
+/*
+ * Parse command text (case-insensitive)
+ * Supported: LOCATE, STATUS, SET INTERVAL <sec>
+ */
+SMSCommand parseSMSCommand(const String& text, long& arg) {
+  String cmd = text;
+  cmd.trim();
+  cmd.toUpperCase();
+  arg = 0;
+
+  if (cmd == "LOCATE") return SMS_CMD_LOCATE;
+  if (cmd == "STATUS") return SMS_CMD_STATUS;
+  if (cmd.startsWith("SET INTERVAL ")) {
+    arg = cmd.substring(13).toInt();
+    return SMS_CMD_SET_INTERVAL;
+  }
+  return SMS_CMD_NONE;
+}
+
+/*
+ * Compare two phone numbers in full international (E.164) form
+ *
+ * Both must start with '+' and carry the same digits; separators are
+ * ignored. A trailing-digit match would accept any sender that shares
+ * the subscriber number under another country or area code.
+ */
+static bool phoneNumbersMatch(const char* a, const char* b) {
+  if (a[0] != '+' || b[0] != '+') return false;
+
+  int ia = 1, ib = 1;
+  while (true) {
+    while (a[ia] && (a[ia] < '0' || a[ia] > '9')) ia++;
+    while (b[ib] && (b[ib] < '0' || b[ib] > '9')) ib++;
+    if (!a[ia] || !b[ib]) break;
+    if (a[ia++] != b[ib++]) return false;
+  }
+
+  return !a[ia] && !b[ib] && ia > 1;
+}
+
+/*
+ * Check for the final error result of a listing
+ * Only a bare ERROR line or a +CMS ERROR line at the very end counts -
+ * message bodies may contain the word anywhere
+ */
+static bool endsWithFinalError(const String& response) {
+  if (response.endsWith("\r\nERROR\r\n")) return true;
+  int line = response.lastIndexOf("\r\n+CMS ERROR:");
+  return line != -1 && response.indexOf('\n', line + 2) == (int)response.length() - 1;
+}
+
+/*
+ * Read one text-mode listing of unread messages
+ * Waits for the final result on its own line, since message bodies may
+ * contain "OK" or "ERROR"
+ */
+static String listUnreadSMS() {
+  clearSerialBuffer();
+  simSerial.println("AT+CMGL=\"REC UNREAD\"");
+  beginATTrace("AT+CMGL", sizeof("AT+CMGL=\"REC UNREAD\"") + 1);
+
+  String response = "";
+  uint32_t start = millis();
+  while (millis() - start < SMS_INBOX_TIMEOUT_MS) {
+    while (simSerial.available()) {
+      response += readModemByte();
+      noteATFirstByte();
+    }
+    if (response.endsWith("\r\nOK\r\n") || endsWithFinalError(response)) break;
+    waitModem(10);
+  }
+  endATTrace(classifyATResponse(response), response.length());
+  return response;
+}
+
+/*
+ * Process unread SMS commands from the authorized number
+ *
+ * Called near the end of each RF session. Messages sent while the modem
+ * was off are held by the network and delivered once it re-attaches, so
+ * no extra wake-ups are needed to pick them up. Replies are sent in the
+ * same session, and every listed message is deleted afterwards.
+ *
+ * @param authorizedNumber Configured phone number allowed to send commands (+<country code>...)
+ * @return number of commands handled
+ */
+int checkInboundSMS(const String& authorizedNumber) {
+  if (!smsCommandHandler || authorizedNumber.length() == 0) return 0;
+  if (authorizedNumber[0] != '+') {
+    Serial.println("⚠️ SMS commands need the phone number in +<country code> format");
+  }
+
+  static char reply[REPORT_MAX_LEN + 1];
+  int handled = 0;
+
+  // One extra pass if +CMTI arrives while we process the first batch
+  for (int pass = 0; pass < 2; pass++) {
+    clearInboundSMSNotification();
+    if (!sendATCommand("AT+CMGF=1", "OK", 1000)) return handled;
+
+    String listing = listUnreadSMS();
+    int indices[SMS_INBOX_MAX_PER_SESSION];
+    int count = 0;
+    int pos = 0;
+
+    while (count < SMS_INBOX_MAX_PER_SESSION) {
+      int header = listing.indexOf("+CMGL:", pos);
+      if (header == -1) break;
+      int headerEnd = listing.indexOf('\n', header);
+      if (headerEnd == -1) break;
+
+      // +CMGL: <index>,"REC UNREAD","<sender>",...
+      int index = listing.substring(header + 6).toInt();
+      int q1 = listing.indexOf('"', header);
+      int q2 = listing.indexOf('"', q1 + 1);
+      int q3 = listing.indexOf('"', q2 + 1);
+      int q4 = listing.indexOf('"', q3 + 1);
+      String sender = (q3 != -1 && q4 != -1 && q4 < headerEnd) ? listing.substring(q3 + 1, q4) : "";
+
+      int bodyEnd = listing.indexOf('\n', headerEnd + 1);
+      if (bodyEnd == -1) bodyEnd = listing.length();
+      String body = listing.substring(headerEnd + 1, bodyEnd);
+      pos = bodyEnd;
+
+      indices[count++] = index;
+
+      if (!phoneNumbersMatch(sender.c_str(), authorizedNumber.c_str())) {
+        Serial.printf("⚠️ Ignoring SMS from unauthorized number %s\n", sender.c_str());
+        continue;
+      }
+
+      long arg;
+      SMSCommand cmd = parseSMSCommand(body, arg);
+      if (cmd == SMS_CMD_NONE) {
+        Serial.println("⚠️ Unknown SMS command: " + body);
+        continue;
+      }
+
+      Serial.println("📨 SMS command: " + body);
+      reply[0] = '\0';
+      if (smsCommandHandler(cmd, arg, reply, sizeof(reply))) {
+        handled++;
+        if (reply[0] != '\0') {
+          sendConcatenatedSMS(authorizedNumber, reply);
+        }
+      }
+    }
+
+    // Delete everything we listed, authorized or not
+    for (int i = 0; i < count; i++) {
+      sendATCommand("AT+CMGD=" + String(indices[i]), "OK", 2000);
+    }
+
+    if (!hasInboundSMSNotification()) break;
+  }
+
+  return handled;
+}
+
 /*
  * Update the last SMS sent timestamp
  */
@@ -9,6 +9,14 @@
 
 #include <Arduino.h>
 #include "gps_handler.h"
+#include "cell_locator.h"
+
+// PDU mode limits (GSM 7-bit alphabet)
+#define SMS_SINGLE_SEPTETS   160  // Single-part message
+#define SMS_CONCAT_SEPTETS   153  // Per part with 6-octet concatenation UDH
+#define SMS_UDH_SEPTETS      7    // 6 UDH octets + 1 fill bit
+#define SMS_MAX_PARTS        4
+#define SMS_PDU_MAX_OCTETS   176  // Header (max 25) + 140 octets user data
 
 // SMS alert types
 enum AlertType {
@@ -18,13 +26,55 @@ enum AlertType {
   ALERT_BLE_DISCONNECT
 };
 
-// SMS functions
+// Report recipients
+#define MAX_SMS_RECIPIENTS        4
+#define RECIPIENT_NUMBER_MAX_LEN  20
+#define ALERT_MASK(type)          (1 << (type))
+#define ALERT_MASK_ALL            0xFF
+
+struct SMSRecipient {
+  char number[RECIPIENT_NUMBER_MAX_LEN];
+  uint8_t alertMask;  // ALERT_MASK() bits this recipient receives
+};
+
+struct SMSRecipientList {
+  SMSRecipient entries[MAX_SMS_RECIPIENTS];  // entries[0] is the primary (command) number
+  uint8_t count;
+};
+
+// Inbound SMS commands
+enum SMSCommand {
+  SMS_CMD_NONE,
+  SMS_CMD_LOCATE,        // Reply with current location report
+  SMS_CMD_STATUS,        // Reply with device status
+  SMS_CMD_SET_INTERVAL   // "SET INTERVAL <seconds>"
+};
+
+#define SMS_INBOX_MAX_PER_SESSION  5   // Inbound messages handled per RF session
+
+// Command handler fills reply (empty = no reply), returns true if handled
+typedef bool (*SMSCommandHandler)(SMSCommand cmd, long arg, char* reply, size_t replySize);
+
+// SMS functions (switch RF on if needed and leave it on - the caller,
+// normally the report session planner, decides when the modem goes off)
 bool sendSMS(const String& phoneNumber, const String& message);
-bool sendSMSPair(const String& phoneNumber, const String& firstMsg, const String& secondMsg);
-bool sendLocationSMS(const String& phoneNumber, const GPSData& gpsData, AlertType type = ALERT_LOCATION_UPDATE);
-bool sendDisconnectSMS(const String& phoneNumber, const GPSData& gpsData, bool userPresent, uint16_t updateInterval);
-bool sendNoLocationSMS(const String& phoneNumber, bool userPresent, bool hasCachedGPS, const GPSData& cachedGPS, uint16_t updateInterval);
+bool sendConcatenatedSMS(const String& phoneNumber, const String& message);
+bool sendLocationSMS(const SMSRecipientList& recipients, const GPSData& gpsData, AlertType type = ALERT_LOCATION_UPDATE);
+bool sendDisconnectSMS(const SMSRecipientList& recipients, const GPSData& gpsData, bool userPresent, uint16_t updateInterval);
+bool sendNoLocationSMS(const SMSRecipientList& recipients, bool userPresent, bool hasCachedGPS, const GPSData& cachedGPS, uint16_t updateInterval);
+bool sendCellLocationSMS(const SMSRecipientList& recipients, const CellLocation& cell, bool userPresent, uint16_t updateInterval);
 bool sendTestSMS(const String& phoneNumber);
+int queueReportSMS(const SMSRecipientList& recipients, const char* message);
+
+// PDU session (one setup per RF session, then one submit per recipient)
+bool beginSMSSession();
+bool submitConcatenatedSMS(const String& phoneNumber, const String& message);
+void endSMSSession();
+
+// Inbound command channel (call with RF enabled)
+void setSMSCommandHandler(SMSCommandHandler handler);
+SMSCommand parseSMSCommand(const String& text, long& arg);
+int checkInboundSMS(const String& authorizedNumber);
 
 // SMS tracking
 void updateLastSMSTime();
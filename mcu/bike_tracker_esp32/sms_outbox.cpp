@@ -0,0 +1,330 @@
+/*
+ * sms_outbox.cpp
+ *
+ * Implementation of the flash-backed SMS outbox
+ *
+ * Backoff is counted in RF sessions instead of milliseconds because
+ * millis() restarts on every deep sleep wake. Each call to sendOrQueueSMS()
+ * opens a new session; a message that failed k times is retried after
+ * 2^(k-1) sessions (capped at OUTBOX_MAX_BACKOFF).
+ */
+
+#include "sms_outbox.h"
+#include "sms_handler.h"
+#include "sms_report.h"
+#include <Preferences.h>
+
+#define OUTBOX_STORE_VERSION 2
+
+static_assert(OUTBOX_TEXT_MAX_LEN > REPORT_MAX_LEN, "Outbox entry too small for encoded reports");
+
+struct OutboxEntry {
+  uint8_t kind;          // OutboxKind
+  uint8_t attempts;      // Failed delivery attempts so far
+  uint16_t nextSession;  // First RF session allowed to retry
+  char phone[OUTBOX_PHONE_MAX_LEN];
+  char text[OUTBOX_TEXT_MAX_LEN];
+};
+
+struct OutboxStore {
+  uint16_t version;
+  uint16_t session;      // RF session counter
+  OutboxEntry entries[OUTBOX_MAX_ENTRIES];  // Oldest first
+};
+
+static Preferences outboxPrefs;
+static OutboxStore outbox;
+static bool outboxLoaded = false;
+static uint32_t queuedTotal = 0;   // Messages queued since boot
+
+/*
+ * Load outbox from flash on first use
+ */
+static void loadOutbox() {
+  if (outboxLoaded) return;
+
+  memset(&outbox, 0, sizeof(outbox));
+  outboxPrefs.begin(OUTBOX_NAMESPACE, true);
+  size_t len = outboxPrefs.getBytes("store", &outbox, sizeof(outbox));
+  outboxPrefs.end();
+
+  // Discard missing or incompatible data
+  if (len != sizeof(outbox) || outbox.version != OUTBOX_STORE_VERSION) {
+    memset(&outbox, 0, sizeof(outbox));
+    outbox.version = OUTBOX_STORE_VERSION;
+  }
+
+  outboxLoaded = true;
+}
+
+/*
+ * Write outbox to flash
+ */
+static void saveOutbox() {
+  outboxPrefs.begin(OUTBOX_NAMESPACE, false);
+  outboxPrefs.putBytes("store", &outbox, sizeof(outbox));
+  outboxPrefs.end();
+}
+
+/*
+ * Remove entry at index, keeping the remaining entries in order
+ */
+static void removeEntry(int index) {
+  for (int i = index; i < OUTBOX_MAX_ENTRIES - 1; i++) {
+    outbox.entries[i] = outbox.entries[i + 1];
+  }
+  memset(&outbox.entries[OUTBOX_MAX_ENTRIES - 1], 0, sizeof(OutboxEntry));
+}
+
+/*
+ * Number of RF sessions to wait after the given number of failures
+ */
+static uint16_t backoffSessions(uint8_t attempts) {
+  uint16_t wait = 1 << min((int)attempts - 1, 4);
+  return min(wait, (uint16_t)OUTBOX_MAX_BACKOFF);
+}
+
+/*
+ * Store a message that failed to send (attempts 1), or one not tried yet
+ * that is due at the next flush (attempts 0)
+ */
+static void queueEntry(OutboxKind kind, const String& phoneNumber, const String& message, uint8_t attempts = 1) {
+  int slot = -1;
+  for (int i = 0; i < OUTBOX_MAX_ENTRIES; i++) {
+    if (outbox.entries[i].kind == OUTBOX_EMPTY) {
+      slot = i;
+      break;
+    }
+  }
+
+  // Outbox full - drop the oldest message
+  if (slot < 0) {
+    Serial.println("⚠️ SMS outbox full, dropping oldest message");
+    removeEntry(0);
+    slot = OUTBOX_MAX_ENTRIES - 1;
+  }
+
+  OutboxEntry& entry = outbox.entries[slot];
+  memset(&entry, 0, sizeof(entry));
+  entry.kind = kind;
+  entry.attempts = attempts;
+  entry.nextSession = outbox.session + (attempts > 0 ? backoffSessions(attempts) : 0);
+  strncpy(entry.phone, phoneNumber.c_str(), sizeof(entry.phone) - 1);
+  strncpy(entry.text, message.c_str(), sizeof(entry.text) - 1);
+  if (attempts > 0) queuedTotal++;
+
+  Serial.printf("📥 SMS queued in outbox (%d pending)\n", getSMSOutboxCount());
+}
+
+/*
+ * Deliver due entries over an open SMS session
+ * Stops at the first failure since the link is likely down
+ */
+static int flushDueEntries(bool& changed) {
+  int delivered = 0;
+  int i = 0;
+
+  while (i < OUTBOX_MAX_ENTRIES && outbox.entries[i].kind != OUTBOX_EMPTY) {
+    OutboxEntry& entry = outbox.entries[i];
+
+    // Not due yet (signed difference handles counter wrap)
+    if ((int16_t)(outbox.session - entry.nextSession) < 0) {
+      i++;
+      continue;
+    }
+
+    Serial.printf("📤 Sending queued SMS (attempt %d)\n", entry.attempts + 1);
+    changed = true;
+
+    if (submitConcatenatedSMS(entry.phone, entry.text)) {
+      removeEntry(i);
+      delivered++;
+      continue;
+    }
+
+    entry.attempts++;
+    if (entry.attempts >= OUTBOX_MAX_ATTEMPTS) {
+      Serial.println("❌ Queued SMS dropped after max attempts");
+      removeEntry(i);
+    } else {
+      entry.nextSession = outbox.session + backoffSessions(entry.attempts);
+      Serial.printf("⏳ Next retry in %d sessions\n", entry.nextSession - outbox.session);
+    }
+    break;
+  }
+
+  return delivered;
+}
+
+/*
+ * Check if any entry's backoff has expired
+ */
+static bool hasDueEntries() {
+  for (int i = 0; i < OUTBOX_MAX_ENTRIES; i++) {
+    if (outbox.entries[i].kind != OUTBOX_EMPTY &&
+        (int16_t)(outbox.session - outbox.entries[i].nextSession) >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Drop pending reports to any of the numbers, a newer one supersedes them
+ *
+ * @return true if an entry was removed
+ */
+static bool replacePendingReports(const char* const* numbers, int count) {
+  bool changed = false;
+  for (int i = OUTBOX_MAX_ENTRIES - 1; i >= 0; i--) {
+    if (outbox.entries[i].kind != OUTBOX_REPORT) continue;
+    for (int r = 0; r < count; r++) {
+      if (strcmp(outbox.entries[i].phone, numbers[r]) == 0) {
+        Serial.println("📤 Replacing pending report with newer location");
+        removeEntry(i);
+        changed = true;
+        break;
+      }
+    }
+  }
+  return changed;
+}
+
+/*
+ * Send a message to every number now, or keep it for a later RF session
+ *
+ * Opens a new outbox session. Module check, registration and PDU mode
+ * setup are done once for all recipients. A new OUTBOX_REPORT replaces
+ * any pending report to the same number, so only the newest location is
+ * delivered. After the first failed submission the remaining numbers are
+ * queued without trying, and due messages are flushed only if every
+ * submission worked.
+ *
+ * @return number of recipients the message was delivered to now
+ */
+int sendOrQueueSMS(OutboxKind kind, const char* const* numbers, int count, const String& message) {
+  if (count <= 0) return 0;  // Nobody to send to - no session, no registration wait
+
+  loadOutbox();
+  outbox.session++;
+
+  // Coalesce: newer report supersedes pending ones
+  bool changed = (kind == OUTBOX_REPORT) && replacePendingReports(numbers, count);
+
+  uint32_t sessionStart = millis();
+  bool linkUp = beginSMSSession();
+  uint32_t setupTime = millis() - sessionStart;
+  uint32_t firstTime = 0;
+  int delivered = 0;
+
+  for (int r = 0; r < count; r++) {
+    uint32_t start = millis();
+    if (linkUp && submitConcatenatedSMS(numbers[r], message)) {
+      delivered++;
+      if (r == 0) firstTime = millis() - start;
+    } else {
+      linkUp = false;
+      queueEntry(kind, numbers[r], message);
+      changed = true;
+    }
+  }
+
+  // Session cost: setup once, then per recipient
+  if (delivered > 1) {
+    uint32_t total = millis() - sessionStart;
+    Serial.printf("📊 SMS fan-out: %d recipients in %lu ms (setup %lu ms, first %lu ms, +%lu ms per extra)\n",
+                  delivered, total, setupTime, firstTime,
+                  (total - setupTime - firstTime) / (delivered - 1));
+  }
+
+  if (linkUp && delivered == count) {
+    flushDueEntries(changed);
+  }
+  endSMSSession();
+
+  if (changed) saveOutbox();
+  return delivered;
+}
+
+/*
+ * Keep a message for the next flush without trying to send it now
+ *
+ * For a report that already went out another way (data uplink) and
+ * still has to reach these numbers by SMS: flushSMSOutbox() later in the
+ * same RF session delivers it, a failure backs off like any other entry.
+ * Not counted by getSMSQueuedTotal().
+ */
+void queueSMS(OutboxKind kind, const char* const* numbers, int count, const String& message) {
+  if (count <= 0) return;
+
+  loadOutbox();
+  if (kind == OUTBOX_REPORT) replacePendingReports(numbers, count);
+  for (int r = 0; r < count; r++) {
+    queueEntry(kind, numbers[r], message, 0);
+  }
+  saveOutbox();
+}
+
+/*
+ * Deliver pending messages whose backoff has expired
+ * Opens its own SMS session only when something is due
+ *
+ * @return number of messages delivered
+ */
+int flushSMSOutbox() {
+  loadOutbox();
+  if (!hasDueEntries()) return 0;
+
+  bool changed = false;
+  int delivered = 0;
+  if (beginSMSSession()) {
+    delivered = flushDueEntries(changed);
+  }
+  endSMSSession();
+
+  if (changed) saveOutbox();
+  return delivered;
+}
+
+/*
+ * Get number of pending messages
+ */
+int getSMSOutboxCount() {
+  loadOutbox();
+
+  int count = 0;
+  for (int i = 0; i < OUTBOX_MAX_ENTRIES; i++) {
+    if (outbox.entries[i].kind != OUTBOX_EMPTY) count++;
+  }
+  return count;
+}
+
+/*
+ * Check if any message is waiting for delivery
+ */
+bool hasPendingSMS() {
+  return getSMSOutboxCount() > 0;
+}
+
+/*
+ * Get number of messages queued since boot
+ * Compare before and after a send to tell whether that send was queued
+ */
+uint32_t getSMSQueuedTotal() {
+  return queuedTotal;
+}
+
+/*
+ * Drop all pending messages
+ */
+void clearSMSOutbox() {
+  memset(&outbox, 0, sizeof(outbox));
+  outbox.version = OUTBOX_STORE_VERSION;
+  outboxLoaded = true;
+
+  outboxPrefs.begin(OUTBOX_NAMESPACE, false);
+  outboxPrefs.clear();
+  outboxPrefs.end();
+
+  Serial.println("📤 SMS outbox cleared");
+}
@@ -0,0 +1,41 @@
+/*
+ * sms_outbox.h
+ *
+ * Flash-backed outbox for SMS reports that could not be delivered.
+ * Failed messages are kept in NVS and retried during later RF sessions
+ * with exponential backoff, so a bad-coverage wake does not have to
+ * repeat the whole GNSS + SMS sequence.
+ */
+
+#ifndef SMS_OUTBOX_H
+#define SMS_OUTBOX_H
+
+#include <Arduino.h>
+
+// Outbox configuration
+#define OUTBOX_NAMESPACE           "sms-outbox"
+#define OUTBOX_MAX_ENTRIES         4    // Pending messages kept in flash
+#define OUTBOX_PHONE_MAX_LEN       20
+#define OUTBOX_TEXT_MAX_LEN        320  // Fits any encoded report (REPORT_MAX_LEN)
+#define OUTBOX_MAX_ATTEMPTS        8    // Drop message after this many failures
+#define OUTBOX_MAX_BACKOFF         16   // Max RF sessions skipped between retries
+
+// Kind of queued message
+enum OutboxKind : uint8_t {
+  OUTBOX_EMPTY = 0,
+  OUTBOX_REPORT,   // Location/status report - only the newest one is kept
+  OUTBOX_ALERT     // One-off alert - every message is kept
+};
+
+// Outbox functions (call with RF enabled)
+int sendOrQueueSMS(OutboxKind kind, const char* const* numbers, int count, const String& message);
+int flushSMSOutbox();
+void queueSMS(OutboxKind kind, const char* const* numbers, int count, const String& message);
+
+// Outbox state
+int getSMSOutboxCount();
+bool hasPendingSMS();
+uint32_t getSMSQueuedTotal();
+void clearSMSOutbox();
+
+#endif // SMS_OUTBOX_H
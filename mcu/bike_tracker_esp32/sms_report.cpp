@@ -0,0 +1,264 @@
+/*
+ * sms_report.cpp
+ *
+ * Implementation of the size-optimized SMS report encoder
+ *
+ * Every report type has three templates, from most readable to densest.
+ * The densest template sets the minimum number of segments; the encoder
+ * then sends the most readable template that needs no more segments than
+ * that. All templates use the GSM 7-bit basic alphabet only (one septet
+ * per character) and their worst-case length is checked at compile time.
+ */
+
+#include "sms_report.h"
+
+// Maximum field lengths (characters)
+#define COORD_MAX_LEN     10   // "-180.00000"
+#define LABEL_MAX_LEN     12   // "Disconnected"
+#define SPEED_MAX_LEN     10   // "999.9 km/h"
+#define USER_MAX_LEN      7    // "Present"
+#define INTERVAL_MAX_LEN  5    // "65535"
+#define ACCURACY_MAX_LEN  5    // "65535" meters
+#define CELLID_MAX_LEN    21   // "999-999-FFFF-FFFFFFFF"
+
+// Templates - each "%s" is replaced by the next field in order
+// Location report: lat, lon, label, speed
+#define LOCATION_VERBOSE  "geo:%s,%s\nBike Tracker: %s\nSpeed: %s\n" \
+                          "If the map did not open, copy the coordinates into your map app."
+#define LOCATION_COMPACT  "geo:%s,%s\n%s, %s"
+#define LOCATION_DENSE    "geo:%s,%s\n%s"
+
+// Status report: lat, lon, label, speed, user, interval
+#define STATUS_VERBOSE    "geo:%s,%s\nBike Tracker: %s\nSpeed: %s\nUser: %s\nSMS Interval: %s sec\n" \
+                          "If the map did not open, copy the coordinates into your map app."
+#define STATUS_COMPACT    "geo:%s,%s\n%s, %s\nUser:%s Int:%ss"
+#define STATUS_DENSE      "geo:%s,%s\n%s"
+
+// No-fix report with last known location: lat, lon, user, interval
+#define LASTKNOWN_VERBOSE "ALERT: GPS FAIL\nLast known location (OUTDATED):\ngeo:%s,%s\nUser: %s\nSMS Interval: %s sec"
+#define LASTKNOWN_COMPACT "GPS FAIL, last known (OUTDATED):\ngeo:%s,%s\nUser:%s Int:%ss"
+#define LASTKNOWN_DENSE   "GPS FAIL, old fix:\ngeo:%s,%s"
+
+// No-fix report without location: user, interval
+#define NOFIX_VERBOSE     "ALERT: GPS FAIL\nNo location available\nGPS never acquired\nUser: %s\nSMS Interval: %s sec"
+#define NOFIX_COMPACT     "GPS FAIL, no location\nUser:%s Int:%ss"
+#define NOFIX_DENSE       "GPS FAIL, no location"
+
+// Cell tower location: lat, lon, accuracy (geo URI uncertainty), user, interval
+#define CELL_VERBOSE      "GPS FAIL, cell tower location\ngeo:%s,%s;u=%s\nUser: %s\nSMS Interval: %s sec"
+#define CELL_COMPACT      "Cell location:\ngeo:%s,%s;u=%s\nUser:%s Int:%ss"
+#define CELL_DENSE        "Cell:\ngeo:%s,%s;u=%s"
+
+// Serving cell only (LBS unavailable): cell ID, user, interval
+#define CELLID_VERBOSE    "ALERT: GPS FAIL\nNo location available\nServing cell: %s\nUser: %s\nSMS Interval: %s sec"
+#define CELLID_COMPACT    "GPS FAIL, cell %s\nUser:%s Int:%ss"
+#define CELLID_DENSE      "GPS FAIL, cell %s"
+
+#define TEMPLATES_PER_REPORT 3
+
+static constexpr uint8_t LOCATION_FIELD_MAX[]  = {COORD_MAX_LEN, COORD_MAX_LEN, LABEL_MAX_LEN, SPEED_MAX_LEN};
+static constexpr uint8_t STATUS_FIELD_MAX[]    = {COORD_MAX_LEN, COORD_MAX_LEN, LABEL_MAX_LEN, SPEED_MAX_LEN,
+                                                  USER_MAX_LEN, INTERVAL_MAX_LEN};
+static constexpr uint8_t LASTKNOWN_FIELD_MAX[] = {COORD_MAX_LEN, COORD_MAX_LEN, USER_MAX_LEN, INTERVAL_MAX_LEN};
+static constexpr uint8_t NOFIX_FIELD_MAX[]     = {USER_MAX_LEN, INTERVAL_MAX_LEN};
+static constexpr uint8_t CELL_FIELD_MAX[]      = {COORD_MAX_LEN, COORD_MAX_LEN, ACCURACY_MAX_LEN,
+                                                  USER_MAX_LEN, INTERVAL_MAX_LEN};
+static constexpr uint8_t CELLID_FIELD_MAX[]    = {CELLID_MAX_LEN, USER_MAX_LEN, INTERVAL_MAX_LEN};
+
+/*
+ * Worst-case rendered length of a template given per-field maxima
+ */
+static constexpr int worstCaseLen(const char* f, const uint8_t* fieldMax) {
+  return *f == '\0' ? 0 :
+         (f[0] == '%' && f[1] == 's') ? fieldMax[0] + worstCaseLen(f + 2, fieldMax + 1) :
+         1 + worstCaseLen(f + 1, fieldMax);
+}
+
+/*
+ * True if the text only uses single-septet GSM 7-bit characters
+ */
+static constexpr bool isBasicGSM7(const char* f) {
+  return *f == '\0' ? true :
+         (*f == '[' || *f == ']' || *f == '{' || *f == '}' || *f == '\\' ||
+          *f == '^' || *f == '~' || *f == '|' || *f == '`') ? false :
+         isBasicGSM7(f + 1);
+}
+
+// Verbose templates may span two segments, compact and dense must fit one
+#define CHECK_TEMPLATE(fmt, fields, limit) \
+  static_assert(isBasicGSM7(fmt), #fmt " uses non-basic GSM-7 characters"); \
+  static_assert(worstCaseLen(fmt, fields) <= (limit), #fmt " exceeds its segment budget")
+
+CHECK_TEMPLATE(LOCATION_VERBOSE,  LOCATION_FIELD_MAX,  REPORT_MAX_LEN);
+CHECK_TEMPLATE(LOCATION_COMPACT,  LOCATION_FIELD_MAX,  SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(LOCATION_DENSE,    LOCATION_FIELD_MAX,  SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(STATUS_VERBOSE,    STATUS_FIELD_MAX,    REPORT_MAX_LEN);
+CHECK_TEMPLATE(STATUS_COMPACT,    STATUS_FIELD_MAX,    SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(STATUS_DENSE,      STATUS_FIELD_MAX,    SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(LASTKNOWN_VERBOSE, LASTKNOWN_FIELD_MAX, REPORT_MAX_LEN);
+CHECK_TEMPLATE(LASTKNOWN_COMPACT, LASTKNOWN_FIELD_MAX, SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(LASTKNOWN_DENSE,   LASTKNOWN_FIELD_MAX, SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(NOFIX_VERBOSE,     NOFIX_FIELD_MAX,     REPORT_MAX_LEN);
+CHECK_TEMPLATE(NOFIX_COMPACT,     NOFIX_FIELD_MAX,     SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(NOFIX_DENSE,       NOFIX_FIELD_MAX,     SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(CELL_VERBOSE,      CELL_FIELD_MAX,      REPORT_MAX_LEN);
+CHECK_TEMPLATE(CELL_COMPACT,      CELL_FIELD_MAX,      SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(CELL_DENSE,        CELL_FIELD_MAX,      SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(CELLID_VERBOSE,    CELLID_FIELD_MAX,    REPORT_MAX_LEN);
+CHECK_TEMPLATE(CELLID_COMPACT,    CELLID_FIELD_MAX,    SMS_SINGLE_SEPTETS);
+CHECK_TEMPLATE(CELLID_DENSE,      CELLID_FIELD_MAX,    SMS_SINGLE_SEPTETS);
+
+// Template tables, most readable first
+static const char* const LOCATION_TEMPLATES[]  = {LOCATION_VERBOSE,  LOCATION_COMPACT,  LOCATION_DENSE};
+static const char* const STATUS_TEMPLATES[]    = {STATUS_VERBOSE,    STATUS_COMPACT,    STATUS_DENSE};
+static const char* const LASTKNOWN_TEMPLATES[] = {LASTKNOWN_VERBOSE, LASTKNOWN_COMPACT, LASTKNOWN_DENSE};
+static const char* const NOFIX_TEMPLATES[]     = {NOFIX_VERBOSE,     NOFIX_COMPACT,     NOFIX_DENSE};
+static const char* const CELL_TEMPLATES[]      = {CELL_VERBOSE,      CELL_COMPACT,      CELL_DENSE};
+static const char* const CELLID_TEMPLATES[]    = {CELLID_VERBOSE,    CELLID_COMPACT,    CELLID_DENSE};
+
+/*
+ * Number of SMS segments needed for a GSM 7-bit text
+ */
+int getSMSSegmentCount(int septets) {
+  if (septets <= SMS_SINGLE_SEPTETS) return 1;
+  return (septets + SMS_CONCAT_SEPTETS - 1) / SMS_CONCAT_SEPTETS;
+}
+
+/*
+ * Pick coordinate decimals so the rounding step stays below fix accuracy
+ * 5 decimals ~1.1 m, 4 decimals ~11 m, 3 decimals ~111 m
+ */
+int getCoordinateDecimals(const GPSData& data) {
+  float accuracy = getGPSAccuracy(data);
+  if (accuracy <= 0) return 5;  // Accuracy unknown - keep full precision
+
+  if (accuracy < 11.0f) return 5;
+  if (accuracy < 111.0f) return 4;
+  return 3;
+}
+
+/*
+ * Render template, replacing each "%s" with the next field
+ * Fields are clipped to their compile-time maximum length
+ */
+static int renderTemplate(const char* fmt, const char* const* fields, const uint8_t* fieldMax,
+                          char* out, size_t outSize) {
+  size_t len = 0;
+  int field = 0;
+
+  for (const char* f = fmt; *f && len < outSize - 1; f++) {
+    if (f[0] == '%' && f[1] == 's') {
+      const char* value = fields[field];
+      for (int i = 0; value[i] && i < fieldMax[field] && len < outSize - 1; i++) {
+        out[len++] = value[i];
+      }
+      field++;
+      f++;
+    } else {
+      out[len++] = *f;
+    }
+  }
+
+  out[len] = '\0';
+  return len;
+}
+
+/*
+ * Short label for the alert type
+ */
+static const char* alertLabel(AlertType type) {
+  switch (type) {
+    case ALERT_LOCATION_UPDATE: return "Update";
+    case ALERT_LOW_BATTERY:     return "Low battery";
+    case ALERT_TEST:            return "Test";
+    case ALERT_BLE_DISCONNECT:  return "Disconnected";
+    default:                    return "Alert";
+  }
+}
+
+/*
+ * Encode a report into out using the best fitting template
+ *
+ * @param info     Report contents
+ * @param out      Output buffer (at least REPORT_MAX_LEN + 1 bytes)
+ * @param outSize  Size of output buffer
+ * @return length of the encoded report
+ */
+int encodeReport(const ReportInfo& info, char* out, size_t outSize) {
+  static char scratch[REPORT_MAX_LEN + 1];
+
+  // Format fields
+  char lat[16] = "", lon[16] = "", speed[16] = "N/A", interval[8];
+  bool hasLocation = info.gps && info.gps->valid &&
+                     info.gps->latitude.length() > 0 && info.gps->longitude.length() > 0;
+
+  if (hasLocation) {
+    int decimals = getCoordinateDecimals(*info.gps);
+    snprintf(lat, sizeof(lat), "%.*f", decimals, strtod(info.gps->latitude.c_str(), nullptr));
+    snprintf(lon, sizeof(lon), "%.*f", decimals, strtod(info.gps->longitude.c_str(), nullptr));
+    if (info.gps->speed.length() > 0) {
+      snprintf(speed, sizeof(speed), "%.1f km/h", min(info.gps->speed.toFloat(), 999.9f));
+    }
+  }
+  snprintf(interval, sizeof(interval), "%u", info.updateInterval);
+
+  char accuracy[8] = "", cellId[CELL_ID_MAX_LEN] = "";
+  if (info.cell) {
+    snprintf(accuracy, sizeof(accuracy), "%u", info.cell->accuracyM);
+    if (info.cell->hasCell) formatCellId(*info.cell, cellId, sizeof(cellId));
+  }
+  const char* user = info.userPresent ? "Present" : "Away";
+  const char* label = alertLabel(info.alert);
+
+  // Select template family and its fields
+  const char* const* templates;
+  const uint8_t* fieldMax;
+  const char* fields[6];
+
+  if (info.type == REPORT_CELL && hasLocation) {
+    templates = CELL_TEMPLATES;
+    fieldMax = CELL_FIELD_MAX;
+    fields[0] = lat; fields[1] = lon; fields[2] = accuracy; fields[3] = user; fields[4] = interval;
+  } else if (info.type == REPORT_CELL && cellId[0]) {
+    templates = CELLID_TEMPLATES;
+    fieldMax = CELLID_FIELD_MAX;
+    fields[0] = cellId; fields[1] = user; fields[2] = interval;
+  } else if ((info.type == REPORT_NO_FIX || info.type == REPORT_CELL) && !hasLocation) {
+    templates = NOFIX_TEMPLATES;
+    fieldMax = NOFIX_FIELD_MAX;
+    fields[0] = user; fields[1] = interval;
+  } else if (info.type == REPORT_NO_FIX) {
+    templates = LASTKNOWN_TEMPLATES;
+    fieldMax = LASTKNOWN_FIELD_MAX;
+    fields[0] = lat; fields[1] = lon; fields[2] = user; fields[3] = interval;
+  } else if (info.type == REPORT_STATUS) {
+    templates = STATUS_TEMPLATES;
+    fieldMax = STATUS_FIELD_MAX;
+    fields[0] = lat; fields[1] = lon; fields[2] = label; fields[3] = speed;
+    fields[4] = user; fields[5] = interval;
+  } else {
+    templates = LOCATION_TEMPLATES;
+    fieldMax = LOCATION_FIELD_MAX;
+    fields[0] = lat; fields[1] = lon; fields[2] = label; fields[3] = speed;
+  }
+
+  // Densest template sets the segment target
+  int segments[TEMPLATES_PER_REPORT];
+  for (int i = 0; i < TEMPLATES_PER_REPORT; i++) {
+    segments[i] = getSMSSegmentCount(renderTemplate(templates[i], fields, fieldMax, scratch, sizeof(scratch)));
+  }
+  int target = segments[TEMPLATES_PER_REPORT - 1];
+
+  int chosen = TEMPLATES_PER_REPORT - 1;
+  for (int i = 0; i < TEMPLATES_PER_REPORT; i++) {
+    if (segments[i] <= target) {
+      chosen = i;
+      break;
+    }
+  }
+
+  int len = renderTemplate(templates[chosen], fields, fieldMax, out, outSize);
+  Serial.printf("📝 Report template %d/%d: %d chars, %d segment(s)\n",
+                chosen + 1, TEMPLATES_PER_REPORT, len, segments[chosen]);
+  return len;
+}
@@ -0,0 +1,45 @@
+/*
+ * sms_report.h
+ *
+ * Size-optimized SMS report encoder
+ * Picks the most readable template that still needs the fewest SMS segments
+ */
+
+#ifndef SMS_REPORT_H
+#define SMS_REPORT_H
+
+#include <Arduino.h>
+#include "gps_handler.h"
+#include "sms_handler.h"
+#include "cell_locator.h"
+#include "track_fusion.h"
+
+// Largest report any template can produce (two concatenated segments)
+#define REPORT_MAX_LEN          (2 * SMS_CONCAT_SEPTETS)
+
+// Report layouts
+enum ReportType {
+  REPORT_LOCATION,   // Location + alert type
+  REPORT_STATUS,     // Location + alert type + user presence + interval
+  REPORT_NO_FIX,     // GPS failed, optional last known location
+  REPORT_CELL        // GPS failed, cell tower location or serving cell ID
+};
+
+// Report contents
+struct ReportInfo {
+  ReportType type;
+  AlertType alert;
+  const GPSData* gps;       // Location to include, nullptr if none
+  bool userPresent;
+  uint16_t updateInterval;  // seconds
+  const CellLocation* cell; // Cell fallback for REPORT_CELL, nullptr if none
+  bool unverified;          // Location failed the plausibility check (fix_validator.h)
+  const FusedState* fused;  // Track filter estimate (uplink only), nullptr if none
+};
+
+// Report encoding
+int encodeReport(const ReportInfo& info, char* out, size_t outSize);
+int getCoordinateDecimals(const GPSData& data);
+int getSMSSegmentCount(int septets);
+
+#endif // SMS_REPORT_H
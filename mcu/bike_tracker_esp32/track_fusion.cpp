@@ -0,0 +1,380 @@
+/*
+ * track_fusion.cpp
+ *
+ * Implementation of the IMU/GNSS track filter
+ *
+ * Each axis (east, north) is a constant-velocity Kalman filter with
+ * position in mm, velocity in mm/s and covariance in int64. Gains are
+ * Q16. The origin moves to the fused position at every fix, so the
+ * position is the displacement since the last fix and stays small.
+ *
+ * The IMU gives no heading here (the sensor's mounting is unknown), so
+ * it only drives the process noise (acceleration sigma from the motion
+ * intensity) and zero-velocity updates while the bike stands still. A
+ * quiet IMU alone does not mean still: a bike carried in a van or ridden
+ * on smooth tarmac stays under the threshold too. The last GNSS speed
+ * has to agree before the velocity is pinned to zero.
+ *
+ * Process noise is the white-acceleration model: q*dt^3/3 on the
+ * position, q*dt^2/2 on the cross term and q*dt on the velocity.
+ * Integer only - tools/fusion_replay.py mirrors it bit for bit.
+ *
+ * The state lives in RTC memory and times are on the RTC clock, so the
+ * track carries over deep sleep. A sleep armed for motion wake is
+ * watched by the IMU: the bike stood still until the wake, and the
+ * filter resumes from the parked position (fuseWatchedSleep). Any other
+ * sleep is unobserved, its gap exceeds FUSION_MAX_GAP_MS and the filter
+ * restarts at the next fix.
+ */
+
+#include "track_fusion.h"
+#include "fix_validator.h"
+#include <sys/time.h>
+
+struct AxisFilter {
+  int32_t pos;   // mm from the origin
+  int32_t vel;   // mm/s
+  int64_t p00;   // mm^2
+  int64_t p01;   // mm^2/s
+  int64_t p11;   // (mm/s)^2
+};
+
+struct UpdateStats {
+  uint32_t count;
+  uint64_t cycles;
+  uint32_t cyclesMax;
+};
+
+// Filter state (survives deep sleep, times on the RTC clock)
+static RTC_DATA_ATTR AxisFilter east = {};
+static RTC_DATA_ATTR AxisFilter north = {};
+static RTC_DATA_ATTR int32_t originLatE6 = 0;
+static RTC_DATA_ATTR int32_t originLonE6 = 0;
+static RTC_DATA_ATTR bool active = false;
+static RTC_DATA_ATTR uint32_t lastUpdateMs = 0;
+
+// IMU motion
+static RTC_DATA_ATTR uint32_t lastIMUMs = 0;
+static RTC_DATA_ATTR uint32_t lastMotionMs = 0;
+static RTC_DATA_ATTR uint32_t motionIntensity = 0;   // mg
+static RTC_DATA_ATTR int32_t gnssSpeedMms = 0;       // Receiver speed of the last fix
+static RTC_DATA_ATTR bool still = false;             // IMU quiet and the last fix slow
+static RTC_DATA_ATTR bool imuSeen = false;
+
+// Statistics
+static RTC_DATA_ATTR UpdateStats imuStats = {};
+static RTC_DATA_ATTR UpdateStats gnssStats = {};
+static RTC_DATA_ATTR uint32_t restarts = 0;
+
+#define MM_PER_UDEG_NUM  11132   // 1e-6 degree of latitude = 111.32 mm
+#define MM_PER_UDEG_DEN  100
+#define COS_MIN_Q15      512     // Near the poles
+
+// atan(2^-i) in centidegrees
+static const int16_t cordicAtan[14] = {
+  4500, 2657, 1404, 713, 358, 179, 90, 45, 22, 11, 6, 3, 1, 1
+};
+
+/*
+ * Divide rounding half away from zero (b > 0)
+ */
+static int64_t divRound(int64_t a, int64_t b) {
+  return a >= 0 ? (a + b / 2) / b : (a - b / 2) / b;
+}
+
+static uint32_t isqrt64(uint64_t value) {
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value) bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/*
+ * Heading of a velocity, CORDIC vectoring
+ *
+ * @return centidegrees from north, clockwise, 0..35999
+ */
+static int32_t headingCdeg(int32_t velEast, int32_t velNorth) {
+  int64_t x = (int64_t)velNorth * 256;
+  int64_t y = (int64_t)velEast * 256;
+  int32_t angle = 0;
+  if (x < 0) {
+    x = -x;
+    y = -y;
+    angle = 18000;
+  }
+  for (int i = 0; i < 14; i++) {
+    int64_t dx = x >> i;
+    int64_t dy = y >> i;
+    if (y > 0) {
+      x += dy;
+      y -= dx;
+      angle += cordicAtan[i];
+    } else {
+      x -= dy;
+      y += dx;
+      angle -= cordicAtan[i];
+    }
+  }
+  angle %= 36000;
+  return angle < 0 ? angle + 36000 : angle;
+}
+
+/*
+ * Milliseconds on the RTC clock, continues through deep sleep (wraps)
+ */
+static uint32_t fusionClockMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint32_t)((uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+static void noteCycles(UpdateStats& stats, uint32_t cycles) {
+  stats.count++;
+  stats.cycles += cycles;
+  if (cycles > stats.cyclesMax) stats.cyclesMax = cycles;
+}
+
+static void predictAxis(AxisFilter& a, int32_t dtMs, int64_t accelVar) {
+  a.pos += (int32_t)divRound((int64_t)a.vel * dtMs, 1000);
+  int64_t p11dt = a.p11 * dtMs / 1000;
+  int64_t qdt = accelVar * dtMs / 1000;
+  int64_t qdt2 = qdt * dtMs / 1000;
+  a.p00 += 2 * a.p01 * dtMs / 1000 + p11dt * dtMs / 1000 + qdt2 * dtMs / 3000;
+  a.p01 += p11dt + qdt2 / 2;
+  a.p11 += qdt;
+}
+
+static void updatePosition(AxisFilter& a, int32_t z, int64_t r) {
+  int64_t s = a.p00 + r;
+  int64_t k0 = a.p00 * 65536 / s;
+  int64_t k1 = a.p01 * 65536 / s;
+  int64_t y = (int64_t)z - a.pos;
+  int64_t p00 = a.p00, p01 = a.p01;
+
+  a.pos += (int32_t)((k0 * y) >> 16);
+  a.vel += (int32_t)((k1 * y) >> 16);
+  a.p00 = max(p00 - ((k0 * p00) >> 16), (int64_t)1);
+  a.p01 = p01 - ((k0 * p01) >> 16);
+  a.p11 = max(a.p11 - ((k1 * p01) >> 16), (int64_t)1);
+}
+
+static void updateVelocity(AxisFilter& a, int32_t z, int64_t r) {
+  int64_t s = a.p11 + r;
+  int64_t k0 = a.p01 * 65536 / s;
+  int64_t k1 = a.p11 * 65536 / s;
+  int64_t y = (int64_t)z - a.vel;
+  int64_t p01 = a.p01, p11 = a.p11;
+
+  a.pos += (int32_t)((k0 * y) >> 16);
+  a.vel += (int32_t)((k1 * y) >> 16);
+  a.p00 = max(a.p00 - ((k0 * p01) >> 16), (int64_t)1);
+  a.p01 = p01 - ((k0 * p11) >> 16);
+  a.p11 = max(p11 - ((k1 * p11) >> 16), (int64_t)1);
+}
+
+/*
+ * Propagate to nowMs
+ *
+ * @return false if the gap is too long - the filter restarts at the next fix
+ */
+static bool predictTo(uint32_t nowMs) {
+  uint32_t dt = nowMs - lastUpdateMs;
+  if (dt > FUSION_MAX_GAP_MS) {
+    active = false;
+    restarts++;
+    return false;
+  }
+
+  int64_t sigma = FUSION_ACCEL_UNKNOWN_MMS2;
+  if (imuSeen && nowMs - lastIMUMs <= 4 * FUSION_IMU_PERIOD_MS) {
+    sigma = still ? 0 : max((int64_t)motionIntensity * 981 / 100, (int64_t)FUSION_ACCEL_MIN_MMS2);
+  }
+  predictAxis(east, dt, sigma * sigma);
+  predictAxis(north, dt, sigma * sigma);
+  lastUpdateMs = nowMs;
+  return true;
+}
+
+/*
+ * Move the origin to the current position (position becomes 0)
+ */
+static void recenter() {
+  int32_t dLat = (int32_t)divRound((int64_t)north.pos * MM_PER_UDEG_DEN, MM_PER_UDEG_NUM);
+  int32_t cosLat = max(cosQ15(originLatE6 + dLat), (int32_t)COS_MIN_Q15);
+  int32_t dLon = (int32_t)divRound((int64_t)east.pos * MM_PER_UDEG_DEN * 32768,
+                                   (int64_t)MM_PER_UDEG_NUM * cosLat);
+
+  originLatE6 += dLat;
+  originLonE6 += dLon;
+  if (originLonE6 > 180000000) originLonE6 -= 360000000;
+  if (originLonE6 < -180000000) originLonE6 += 360000000;
+  north.pos = 0;
+  east.pos = 0;
+}
+
+static void start(int32_t latE6, int32_t lonE6, int32_t velEast, int32_t velNorth,
+                  int64_t posVar, int64_t velVar, uint32_t nowMs) {
+  originLatE6 = latE6;
+  originLonE6 = lonE6;
+  east = {0, velEast, posVar, 0, velVar};
+  north = {0, velNorth, posVar, 0, velVar};
+  lastUpdateMs = nowMs;
+  active = true;
+}
+
+/*
+ * IMU motion sample (every FUSION_IMU_PERIOD_MS while awake)
+ *
+ * @param intensityMg |acceleration| - 1 g, in mg
+ */
+void fuseIMUMotion(uint32_t intensityMg) {
+  uint32_t begin = ESP.getCycleCount();
+  uint32_t nowMs = fusionClockMs();
+
+  if (!imuSeen || intensityMg >= FUSION_STILL_MG) lastMotionMs = nowMs;
+  imuSeen = true;
+  lastIMUMs = nowMs;
+  motionIntensity = intensityMg;
+  still = (intensityMg < FUSION_STILL_MG && nowMs - lastMotionMs >= FUSION_STILL_MS &&
+           gnssSpeedMms < FUSION_COURSE_MIN_MMS);
+
+  if (active && predictTo(nowMs) && still) {
+    updateVelocity(east, 0, FUSION_ZUPT_VAR);
+    updateVelocity(north, 0, FUSION_ZUPT_VAR);
+  }
+
+  uint32_t cycles = ESP.getCycleCount() - begin;
+  noteCycles(imuStats, cycles);
+#if TRACK_FUSION_LOG
+  Serial.printf("FUS I %lu %lu %lu\n", nowMs, intensityMg, cycles);
+#endif
+}
+
+/*
+ * GNSS fix (trusted by the fix validator)
+ * The fix itself is left as received, the estimate is read with getFusedState()
+ */
+void fuseGNSSFix(const GPSData& fix) {
+  uint32_t begin = ESP.getCycleCount();
+  uint32_t nowMs = fusionClockMs();
+
+  int32_t latE6 = parseScaled(fix.latitude.c_str(), 6);
+  int32_t lonE6 = parseScaled(fix.longitude.c_str(), 6);
+  int32_t speedMms = parseScaled(fix.speed.c_str(), 2) * 100 / 36;   // 0.01 km/h = 100/36 mm/s
+  int32_t courseCdeg = parseScaled(fix.course.c_str(), 2);
+  int64_t accuracyMm = max((int64_t)fix.accuracyCm * 10, (int64_t)FUSION_MIN_ACCURACY_MM);
+
+  // Slow: the course is noise, the receiver's speed still says "about zero"
+  int32_t velEast = 0, velNorth = 0;
+  if (speedMms >= FUSION_COURSE_MIN_MMS) {
+    velEast = (int32_t)(((int64_t)speedMms * cosQ15(90000000 - courseCdeg * 10000)) >> 15);
+    velNorth = (int32_t)(((int64_t)speedMms * cosQ15(courseCdeg * 10000)) >> 15);
+  }
+  int64_t posVar = accuracyMm * accuracyMm / 2;   // Per axis, the accuracy is horizontal
+  int64_t velVar = (int64_t)FUSION_GNSS_SPEED_SIGMA * FUSION_GNSS_SPEED_SIGMA;
+
+  if (!active || !predictTo(nowMs)) {
+    start(latE6, lonE6, velEast, velNorth, posVar, velVar, nowMs);
+  } else {
+    int32_t eastCm, northCm;
+    localOffsetCm(originLatE6, originLonE6, latE6, lonE6, eastCm, northCm);
+    updatePosition(east, eastCm * 10, posVar);
+    updatePosition(north, northCm * 10, posVar);
+    updateVelocity(east, velEast, velVar);
+    updateVelocity(north, velNorth, velVar);
+    recenter();
+  }
+  gnssSpeedMms = speedMms;
+
+  uint32_t cycles = ESP.getCycleCount() - begin;
+  noteCycles(gnssStats, cycles);
+#if TRACK_FUSION_LOG
+  Serial.printf("FUS G %lu %llu %ld %ld %ld %ld %ld %lu\n", nowMs, fix.timestamp, latE6, lonE6,
+                speedMms, courseCdeg, (long)accuracyMm, cycles);
+#endif
+
+#if TRACK_FUSION_LOG
+  FusedState state;
+  getFusedState(state);
+  Serial.printf("FUS E %lu %ld %ld %lu %ld\n", nowMs, state.latE6, state.lonE6,
+                state.uncertaintyMm, state.headingCdeg);
+#endif
+}
+
+/*
+ * Bridge a deep sleep that was armed for motion wake
+ * Call on the motion wake. The IMU would have woken the device at the
+ * first movement, so the bike stood still until now: the position
+ * carries over, the velocity is zero and the wake itself is motion.
+ */
+void fuseWatchedSleep() {
+  uint32_t nowMs = fusionClockMs();
+  if (active) {
+    east.vel = 0;
+    north.vel = 0;
+    east.p01 = 0;
+    north.p01 = 0;
+    east.p11 = FUSION_ZUPT_VAR;
+    north.p11 = FUSION_ZUPT_VAR;
+    lastUpdateMs = nowMs;
+  }
+  lastMotionMs = nowMs;
+#if TRACK_FUSION_LOG
+  Serial.printf("FUS S %lu\n", nowMs);
+#endif
+}
+
+/*
+ * Current estimate (dead reckoned since the last fix)
+ */
+void getFusedState(FusedState& state) {
+  state = {};
+  state.valid = active;
+  state.headingCdeg = -1;
+  if (!active) return;
+
+  int32_t dLat = (int32_t)divRound((int64_t)north.pos * MM_PER_UDEG_DEN, MM_PER_UDEG_NUM);
+  int32_t cosLat = max(cosQ15(originLatE6 + dLat), (int32_t)COS_MIN_Q15);
+  state.latE6 = originLatE6 + dLat;
+  state.lonE6 = originLonE6 + (int32_t)divRound((int64_t)east.pos * MM_PER_UDEG_DEN * 32768,
+                                                (int64_t)MM_PER_UDEG_NUM * cosLat);
+  state.eastMm = east.pos;
+  state.northMm = north.pos;
+  state.speedMms = (int32_t)isqrt64((uint64_t)((int64_t)east.vel * east.vel + (int64_t)north.vel * north.vel));
+  if (!still && state.speedMms >= FUSION_COURSE_MIN_MMS) {
+    state.headingCdeg = headingCdeg(east.vel, north.vel);
+  }
+  state.uncertaintyMm = isqrt64((uint64_t)(east.p00 + north.p00));
+  state.still = still;
+}
+
+/*
+ * Print the estimate and update cost
+ */
+void printTrackFusion() {
+  FusedState state;
+  getFusedState(state);
+
+  Serial.printf("\nTrack fusion: %s, %lu restarts\n", state.valid ? "active" : "waiting for a fix", restarts);
+  if (state.valid) {
+    Serial.printf("  Position %.6f,%.6f ±%lu m, moved %ld/%ld m (E/N) since the fix\n",
+                  state.latE6 / 1e6, state.lonE6 / 1e6, state.uncertaintyMm / 1000,
+                  state.eastMm / 1000, state.northMm / 1000);
+    Serial.printf("  Speed %ld mm/s, heading %s%ld deg\n", state.speedMms,
+                  state.headingCdeg < 0 ? "unknown " : "", max(state.headingCdeg, (int32_t)0) / 100);
+  }
+  Serial.printf("  IMU updates %lu: %lu cycles avg, %lu max\n", imuStats.count,
+                imuStats.count ? (uint32_t)(imuStats.cycles / imuStats.count) : 0, imuStats.cyclesMax);
+  Serial.printf("  GNSS updates %lu: %lu cycles avg, %lu max\n", gnssStats.count,
+                gnssStats.count ? (uint32_t)(gnssStats.cycles / gnssStats.count) : 0, gnssStats.cyclesMax);
+}
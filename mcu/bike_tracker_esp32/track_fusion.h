@@ -0,0 +1,54 @@
+/*
+ * track_fusion.h
+ *
+ * IMU/GNSS track filter
+ * A fixed-point Kalman filter (position and velocity per east/north
+ * axis) between GNSS fixes. IMU motion intensity sets the process noise,
+ * IMU stillness confirmed by a slow last fix pins the velocity to zero.
+ * Fixes are smoothed with the propagated track, and heading,
+ * displacement since the last fix and position uncertainty are estimated
+ * in between. The raw fix stays the record (track log, alerts), the
+ * fused estimate is kept beside it and sent with uplink reports.
+ */
+
+#ifndef TRACK_FUSION_H
+#define TRACK_FUSION_H
+
+#include <Arduino.h>
+#include "gps_handler.h"
+
+#define TRACK_FUSION_LOG          0       // 1 = print FUS lines for tools/fusion_replay.py
+
+#define FUSION_IMU_PERIOD_MS      100     // IMU sample rate into the filter
+#define FUSION_MAX_GAP_MS         30000   // Longer without updates: restart at the next fix
+#define FUSION_STILL_MG           40      // Motion intensity below this counts as still (if the last fix is slow)
+#define FUSION_STILL_MS           1000    // ... for this long
+#define FUSION_ACCEL_MIN_MMS2     500     // Process noise floor while moving
+#define FUSION_ACCEL_UNKNOWN_MMS2 3000    // Without recent IMU samples (vehicle)
+#define FUSION_ZUPT_VAR           100     // Zero-velocity pseudo-measurement, (mm/s)^2
+#define FUSION_GNSS_SPEED_SIGMA   500     // GNSS velocity, mm/s
+#define FUSION_COURSE_MIN_MMS     1000    // Slower: GNSS course is noise, velocity taken as zero
+#define FUSION_MIN_ACCURACY_MM    2000    // Floor for the GNSS position sigma
+
+struct FusedState {
+  bool valid;
+  int32_t latE6;          // Fused position
+  int32_t lonE6;
+  int32_t eastMm;         // Displacement since the last fix
+  int32_t northMm;
+  int32_t speedMms;
+  int32_t headingCdeg;    // 0 = north, clockwise, -1 = unknown (still or slow)
+  uint32_t uncertaintyMm; // 1 sigma horizontal
+  bool still;
+};
+
+// Updates (times on the RTC clock, the state survives deep sleep)
+void fuseIMUMotion(uint32_t intensityMg);
+void fuseGNSSFix(const GPSData& fix);   // Leaves the fix as received
+void fuseWatchedSleep();                // On a wake from a motion-armed sleep
+
+// State and statistics
+void getFusedState(FusedState& state);
+void printTrackFusion();
+
+#endif // TRACK_FUSION_H
@@ -0,0 +1,197 @@
+/*
+ * track_upload.cpp
+ *
+ * Implementation of the batched track uploader
+ *
+ * Every logged point has a sequence number (getGPSLogSequence()). The
+ * server acks the next point sequence it expects, so everything below it
+ * is delivered; a lost ack just resends points the server drops as
+ * duplicates. Points overwritten in the ring before upload are skipped.
+ *
+ * Batch layout (little endian):
+ *   0  uplink header ('T')       9  first point sequence (uint32)
+ *  13  point count (uint8)      14  base time (uint32, Unix seconds)
+ *  18  base latitude (int32)    22  base longitude (int32)   x TRACK_COORD_SCALE
+ *  26  points, each as varints relative to the previous point (the first
+ *      one relative to the base):
+ *        zigzag(dt seconds) << 2 | source, zigzag(dlat), zigzag(dlon),
+ *        speed x10 km/h
+ *   n  CRC-16/CCITT-FALSE of all preceding bytes (uint16)
+ */
+
+#include "track_upload.h"
+#include "data_uplink.h"
+#include "gps_handler.h"
+#include <Preferences.h>
+
+#define TRACK_POINT_MAX_BYTES  18  // Four varints, worst case
+#define TRACK_CRC_LEN          2
+
+static_assert(TRACK_BATCH_MAX_BYTES <= UPLINK_MAX_MESSAGE_LEN, "Track batch exceeds uplink message size");
+
+// Next point sequence the server has not acknowledged
+RTC_DATA_ATTR uint32_t trackAckedSequence = 0;
+RTC_DATA_ATTR bool trackAckedLoaded = false;
+
+static Preferences trackPrefs;
+
+/*
+ * Load acknowledged sequence from flash once per cold boot
+ */
+static uint32_t loadAckedSequence() {
+  if (!trackAckedLoaded) {
+    trackPrefs.begin(TRACK_UPLOAD_NAMESPACE, true);
+    trackAckedSequence = trackPrefs.getULong("acked", 0);
+    trackPrefs.end();
+    trackAckedLoaded = true;
+  }
+  return trackAckedSequence;
+}
+
+static void saveAckedSequence(uint32_t seq) {
+  trackAckedSequence = seq;
+  trackPrefs.begin(TRACK_UPLOAD_NAMESPACE, false);
+  trackPrefs.putULong("acked", seq);
+  trackPrefs.end();
+}
+
+static int putVarint(uint8_t* p, uint32_t v) {
+  int n = 0;
+  while (v >= 0x80) {
+    p[n++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  p[n++] = v;
+  return n;
+}
+
+static uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static uint16_t crc16(const uint8_t* data, int len) {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/*
+ * First sequence number still pending upload and still stored
+ */
+static uint32_t firstPendingSequence(uint32_t& total) {
+  total = getGPSLogSequence();
+  uint32_t oldest = total - getGPSHistoryCount();
+  uint32_t acked = loadAckedSequence();
+
+  if (acked > total) acked = total;  // History cleared or flash reset
+  return max(acked, oldest);
+}
+
+/*
+ * Pack pending points into one batch
+ *
+ * @return batch length including CRC, 0 if nothing is pending
+ */
+static int encodeBatch(uint8_t* out, uint16_t msgSeq, uint32_t& firstSeq, int& points) {
+  uint32_t total;
+  firstSeq = firstPendingSequence(total);
+  uint32_t oldest = total - getGPSHistoryCount();
+  points = 0;
+  if (firstSeq >= total) return 0;
+
+  writeUplinkHeader(out, UPLINK_MSG_TRACK, msgSeq);
+  putUplinkU32(out + 9, firstSeq);
+  int pos = TRACK_HEADER_LEN;
+
+  uint32_t prevTime = 0;
+  int32_t prevLat = 0, prevLon = 0;
+
+  for (uint32_t seq = firstSeq; seq < total && points < 255; seq++) {
+    if (pos + TRACK_POINT_MAX_BYTES + TRACK_CRC_LEN > TRACK_BATCH_MAX_BYTES) break;
+
+    GPSLogEntry entry;
+    if (!getGPSLogEntry(seq - oldest, entry)) break;
+
+    uint32_t fixTime = (uint32_t)(entry.timestamp / 1000);
+    int32_t lat = lroundf(entry.lat * TRACK_COORD_SCALE);
+    int32_t lon = lroundf(entry.lon * TRACK_COORD_SCALE);
+
+    if (points == 0) {
+      putUplinkU32(out + 14, fixTime);
+      putUplinkU32(out + 18, (uint32_t)lat);
+      putUplinkU32(out + 22, (uint32_t)lon);
+      prevTime = fixTime;
+      prevLat = lat;
+      prevLon = lon;
+    }
+
+    pos += putVarint(out + pos, (zigzag((int32_t)(fixTime - prevTime)) << 2) | (entry.source & 0x03));
+    pos += putVarint(out + pos, zigzag(lat - prevLat));
+    pos += putVarint(out + pos, zigzag(lon - prevLon));
+    pos += putVarint(out + pos, (uint32_t)lroundf(max(entry.speed, 0.0f) * 10.0f));
+
+    prevTime = fixTime;
+    prevLat = lat;
+    prevLon = lon;
+    points++;
+  }
+
+  out[13] = points;
+  putUplinkU16(out + pos, crc16(out, pos));
+  return pos + TRACK_CRC_LEN;
+}
+
+/*
+ * Upload pending history points in batches
+ * Stops at the first batch that is not acknowledged
+ *
+ * @param host  Server name or IP address
+ * @param port  Server UDP port
+ * @return points acknowledged, -1 if the first batch failed
+ */
+int uploadTrackHistory(const char* host, uint16_t port) {
+  static uint8_t batch[TRACK_BATCH_MAX_BYTES];
+  int delivered = 0;
+
+  for (int b = 0; b < TRACK_MAX_BATCHES && getPendingTrackPoints() > 0; b++) {
+    uint16_t msgSeq = nextUplinkSequence();
+    uint32_t firstSeq;
+    int points;
+    int len = encodeBatch(batch, msgSeq, firstSeq, points);
+    if (len == 0) break;
+
+    uint8_t ack[TRACK_ACK_LEN] = {};
+    uint32_t start = millis();
+    if (!sendDataMessage(host, port, batch, len, msgSeq, ack, sizeof(ack))) {
+      Serial.printf("❌ Track batch #%u not acknowledged\n", msgSeq);
+      return delivered > 0 ? delivered : -1;
+    }
+
+    // Server acks the next point it expects
+    uint32_t next = ack[4] | (ack[5] << 8) | ((uint32_t)ack[6] << 16) | ((uint32_t)ack[7] << 24);
+    uint32_t total = getGPSLogSequence();
+    if (next > total) next = total;
+    if (next <= firstSeq) break;  // Server did not accept anything
+
+    saveAckedSequence(next);
+    delivered += next - firstSeq;
+    Serial.printf("📊 Track batch #%u: %d points in %d bytes (%.1f bytes/point), acked in %lu ms\n",
+                  msgSeq, points, len, (float)len / points, millis() - start);
+  }
+
+  return delivered;
+}
+
+/*
+ * Number of stored points not yet acknowledged by the server
+ */
+int getPendingTrackPoints() {
+  uint32_t total;
+  uint32_t first = firstPendingSequence(total);
+  return total - first;
+}
@@ -0,0 +1,29 @@
+/*
+ * track_upload.h
+ *
+ * Batched upload of the GPS history over the data uplink
+ * Points not yet acknowledged by the server are packed delta-encoded
+ * into one datagram while a report session already has the bearer open.
+ */
+
+#ifndef TRACK_UPLOAD_H
+#define TRACK_UPLOAD_H
+
+#include <Arduino.h>
+
+// Upload configuration
+#define TRACK_UPLOAD_NAMESPACE     "track-upload"
+#define TRACK_BATCH_MAX_BYTES      512   // Datagram size limit
+#define TRACK_MAX_BATCHES          4     // Per report session
+#define TRACK_COORD_SCALE          100000  // 1e-5 degree (~1.1 m) fixed point
+
+// Wire format (see track_upload.cpp)
+#define UPLINK_MSG_TRACK           'T'
+#define TRACK_HEADER_LEN           26
+#define TRACK_ACK_LEN              8     // Ack header + next expected point (uint32)
+
+// Track upload functions (call with RF enabled)
+int uploadTrackHistory(const char* host, uint16_t port);
+int getPendingTrackPoints();
+
+#endif // TRACK_UPLOAD_H
@@ -0,0 +1,499 @@
+"""Replay recorded rides through the IMU/GNSS track filter.
+
+The firmware's filter (track_fusion.cpp) is integer only, and this tool
+mirrors it bit for bit, so rides can be replayed and the filter tuned on
+the host. Record a ride with a TRACK_FUSION_LOG = 1 build (track_fusion.h):
+the serial log then holds every filter input as FUS lines, with the CPU
+cycles each update took on the device.
+
+    python3 fusion_replay.py run ride.log --truth reference.csv
+
+The reference track (e.g. from a survey-grade receiver or a phone on the
+handlebar) is a CSV of unix_ms,lat,lon. The report gives the position
+error of the raw fixes, the fused fixes and the dead-reckoned track
+between fixes (against holding the last fix), the heading error, how
+often the truth lies within the reported uncertainty, and cycles per
+update as measured on the device. E lines in the log, the device's own
+output, are compared with the mirror to catch a drift between the two.
+
+Without a recording, generate a synthetic ride with its ground truth:
+
+    python3 fusion_replay.py synth ride.txt --fix-interval 10
+    python3 fusion_replay.py run ride.txt
+
+--scenario transport gives a bike carried in a van instead: steady road
+speeds with the IMU under the stillness threshold, where only the GNSS
+speed tells the filter that the bike is not standing still.
+
+Ride lines (the FUS prefix is optional, times are the device's RTC
+clock in ms, which keeps running through deep sleep):
+
+    I <ms> <intensity mg> [cycles]
+    G <ms> <unix ms> <lat e6> <lon e6> <speed mm/s> <course cdeg> <accuracy mm> [cycles]
+    S <ms>                        wake from a motion-armed sleep
+    E <ms> <lat e6> <lon e6> <uncertainty mm> <heading cdeg>
+    T <ms> <lat e6> <lon e6>      ground truth
+"""
+
+import argparse
+import math
+import random
+import statistics
+
+# Must match track_fusion.h
+IMU_PERIOD_MS = 100
+MAX_GAP_MS = 30000
+STILL_MG = 40
+STILL_MS = 1000
+ACCEL_MIN_MMS2 = 500
+ACCEL_UNKNOWN_MMS2 = 3000
+ZUPT_VAR = 100
+GNSS_SPEED_SIGMA = 500
+COURSE_MIN_MMS = 1000
+
+# Must match track_fusion.cpp / fix_validator.cpp
+MM_PER_UDEG_NUM = 11132
+MM_PER_UDEG_DEN = 100
+CM_PER_UDEG_NUM = 11132
+CM_PER_UDEG_DEN = 1000
+COS_MIN_Q15 = 512
+COS_TABLE = [32768, 32643, 32270, 31651, 30792, 29697, 28378, 26842, 25102, 23170,
+             21063, 18795, 16384, 13848, 11207, 8481, 5690, 2856, 0]
+CORDIC_ATAN = [4500, 2657, 1404, 713, 358, 179, 90, 45, 22, 11, 6, 3, 1, 1]
+U32 = 0xFFFFFFFF
+
+EARTH_M_PER_DEG = 111320.0
+
+
+def tdiv(a, b):
+    """C integer division (truncates toward zero)"""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b > 0) else -q
+
+
+def div_round(a, b):
+    return tdiv(a + b // 2, b) if a >= 0 else tdiv(a - b // 2, b)
+
+
+def cos_q15(angle_e6):
+    a = angle_e6 % 360000000
+    if a > 180000000:
+        a = 360000000 - a
+    negative = a > 90000000
+    if negative:
+        a = 180000000 - a
+    index = a // 5000000
+    value = COS_TABLE[18]
+    if index < 18:
+        frac = a % 5000000
+        value = COS_TABLE[index] - (COS_TABLE[index] - COS_TABLE[index + 1]) * frac // 5000000
+    return -value if negative else value
+
+
+def local_offset_cm(from_lat, from_lon, to_lat, to_lon):
+    d_lon = to_lon - from_lon
+    if d_lon > 180000000:
+        d_lon -= 360000000
+    if d_lon < -180000000:
+        d_lon += 360000000
+    d_lat = to_lat - from_lat
+    north = tdiv(d_lat * CM_PER_UDEG_NUM, CM_PER_UDEG_DEN)
+    east = (tdiv(d_lon * CM_PER_UDEG_NUM, CM_PER_UDEG_DEN) * cos_q15(tdiv(from_lat + to_lat, 2))) >> 15
+    return east, north
+
+
+def heading_cdeg(vel_east, vel_north):
+    x = vel_north * 256
+    y = vel_east * 256
+    angle = 0
+    if x < 0:
+        x, y, angle = -x, -y, 18000
+    for i, step in enumerate(CORDIC_ATAN):
+        dx, dy = x >> i, y >> i
+        if y > 0:
+            x, y, angle = x + dy, y - dx, angle + step
+        else:
+            x, y, angle = x - dy, y + dx, angle - step
+    return angle % 36000
+
+
+class Axis:
+    def __init__(self, vel, pos_var, vel_var):
+        self.pos, self.vel = 0, vel
+        self.p00, self.p01, self.p11 = pos_var, 0, vel_var
+
+    def predict(self, dt, accel_var):
+        self.pos += div_round(self.vel * dt, 1000)
+        p11dt = tdiv(self.p11 * dt, 1000)
+        qdt = tdiv(accel_var * dt, 1000)
+        qdt2 = tdiv(qdt * dt, 1000)
+        self.p00 += tdiv(2 * self.p01 * dt, 1000) + tdiv(p11dt * dt, 1000) + tdiv(qdt2 * dt, 3000)
+        self.p01 += p11dt + tdiv(qdt2, 2)
+        self.p11 += qdt
+
+    def update_position(self, z, r):
+        s = self.p00 + r
+        k0, k1 = tdiv(self.p00 * 65536, s), tdiv(self.p01 * 65536, s)
+        y = z - self.pos
+        p00, p01 = self.p00, self.p01
+        self.pos += (k0 * y) >> 16
+        self.vel += (k1 * y) >> 16
+        self.p00 = max(p00 - ((k0 * p00) >> 16), 1)
+        self.p01 = p01 - ((k0 * p01) >> 16)
+        self.p11 = max(self.p11 - ((k1 * p01) >> 16), 1)
+
+    def update_velocity(self, z, r):
+        s = self.p11 + r
+        k0, k1 = tdiv(self.p01 * 65536, s), tdiv(self.p11 * 65536, s)
+        y = z - self.vel
+        p01, p11 = self.p01, self.p11
+        self.pos += (k0 * y) >> 16
+        self.vel += (k1 * y) >> 16
+        self.p00 = max(self.p00 - ((k0 * p01) >> 16), 1)
+        self.p01 = p01 - ((k0 * p11) >> 16)
+        self.p11 = max(p11 - ((k1 * p11) >> 16), 1)
+
+
+class TrackFusion:
+    """Mirror of track_fusion.cpp"""
+
+    def __init__(self):
+        self.active = False
+        self.east = self.north = None
+        self.origin = (0, 0)
+        self.last_update = 0
+        self.last_imu = 0
+        self.last_motion = 0
+        self.intensity = 0
+        self.gnss_speed = 0
+        self.still = False
+        self.imu_seen = False
+        self.restarts = 0
+
+    def predict_to(self, now):
+        dt = (now - self.last_update) & U32
+        if dt > MAX_GAP_MS:
+            self.active = False
+            self.restarts += 1
+            return False
+        sigma = ACCEL_UNKNOWN_MMS2
+        if self.imu_seen and (now - self.last_imu) & U32 <= 4 * IMU_PERIOD_MS:
+            sigma = 0 if self.still else max(self.intensity * 981 // 100, ACCEL_MIN_MMS2)
+        self.east.predict(dt, sigma * sigma)
+        self.north.predict(dt, sigma * sigma)
+        self.last_update = now
+        return True
+
+    def position(self):
+        lat, lon = self.origin
+        d_lat = div_round(self.north.pos * MM_PER_UDEG_DEN, MM_PER_UDEG_NUM)
+        cos_lat = max(cos_q15(lat + d_lat), COS_MIN_Q15)
+        d_lon = div_round(self.east.pos * MM_PER_UDEG_DEN * 32768, MM_PER_UDEG_NUM * cos_lat)
+        return lat + d_lat, lon + d_lon
+
+    def recenter(self):
+        lat, lon = self.position()
+        if lon > 180000000:
+            lon -= 360000000
+        if lon < -180000000:
+            lon += 360000000
+        self.origin = (lat, lon)
+        self.east.pos = self.north.pos = 0
+
+    def imu(self, now, intensity):
+        if not self.imu_seen or intensity >= STILL_MG:
+            self.last_motion = now
+        self.imu_seen = True
+        self.last_imu = now
+        self.intensity = intensity
+        self.still = (intensity < STILL_MG and (now - self.last_motion) & U32 >= STILL_MS and
+                      self.gnss_speed < COURSE_MIN_MMS)
+        if self.active and self.predict_to(now) and self.still:
+            self.east.update_velocity(0, ZUPT_VAR)
+            self.north.update_velocity(0, ZUPT_VAR)
+
+    def watched_sleep(self, now):
+        if self.active:
+            for axis in (self.east, self.north):
+                axis.vel = axis.p01 = 0
+                axis.p11 = ZUPT_VAR
+            self.last_update = now
+        self.last_motion = now
+
+    def gnss(self, now, lat, lon, speed, course, accuracy):
+        vel_east = vel_north = 0
+        if speed >= COURSE_MIN_MMS:
+            vel_east = (speed * cos_q15(90000000 - course * 10000)) >> 15
+            vel_north = (speed * cos_q15(course * 10000)) >> 15
+        pos_var = accuracy * accuracy // 2
+        vel_var = GNSS_SPEED_SIGMA * GNSS_SPEED_SIGMA
+
+        if not self.active or not self.predict_to(now):
+            self.origin = (lat, lon)
+            self.east = Axis(vel_east, pos_var, vel_var)
+            self.north = Axis(vel_north, pos_var, vel_var)
+            self.last_update = now
+            self.active = True
+        else:
+            east_cm, north_cm = local_offset_cm(self.origin[0], self.origin[1], lat, lon)
+            self.east.update_position(east_cm * 10, pos_var)
+            self.north.update_position(north_cm * 10, pos_var)
+            self.east.update_velocity(vel_east, vel_var)
+            self.north.update_velocity(vel_north, vel_var)
+            self.recenter()
+        self.gnss_speed = speed
+
+    def state(self):
+        """(lat e6, lon e6, uncertainty mm, heading cdeg or -1), None if inactive"""
+        if not self.active:
+            return None
+        lat, lon = self.position()
+        speed = math.isqrt(self.east.vel ** 2 + self.north.vel ** 2)
+        heading = -1
+        if not self.still and speed >= COURSE_MIN_MMS:
+            heading = heading_cdeg(self.east.vel, self.north.vel)
+        return lat, lon, math.isqrt(self.east.p00 + self.north.p00), heading
+
+
+def load_ride(path):
+    """Records (kind, ms, fields) from a serial log or a ride file"""
+    records = []
+    for line in open(path, errors='replace'):
+        parts = line.split()
+        if 'FUS' in parts:
+            parts = parts[parts.index('FUS') + 1:]
+        if not parts or parts[0] not in ('I', 'G', 'S', 'E', 'T'):
+            continue
+        try:
+            values = [int(v) for v in parts[1:]]
+        except ValueError:
+            continue
+        records.append((parts[0], values[0], values[1:]))
+    return records
+
+
+def load_truth(path, records):
+    """Reference CSV (unix_ms,lat,lon) as T records on the device clock"""
+    offsets = [f[0] - ms for kind, ms, f in records if kind == 'G']
+    if not offsets:
+        raise SystemExit('no GNSS records to align the reference track with')
+    offset = statistics.median(offsets)
+    truth = []
+    for line in open(path):
+        parts = line.strip().split(',')
+        try:
+            unix_ms, lat, lon = int(parts[0]), float(parts[1]), float(parts[2])
+        except (ValueError, IndexError):
+            continue  # Header
+        truth.append(('T', unix_ms - offset, [round(lat * 1e6), round(lon * 1e6)]))
+    return truth
+
+
+def distance_m(a, b):
+    d_lat = (b[0] - a[0]) / 1e6
+    d_lon = (b[1] - a[1]) / 1e6 * math.cos(math.radians(a[0] / 1e6))
+    return math.hypot(d_lat, d_lon) * EARTH_M_PER_DEG
+
+
+class Truth:
+    def __init__(self, points):
+        self.points = sorted((ms, lat, lon) for _, ms, (lat, lon) in points)
+
+    def at(self, ms):
+        pts = self.points
+        if not pts or ms < pts[0][0] or ms > pts[-1][0]:
+            return None
+        lo, hi = 0, len(pts) - 1
+        while hi - lo > 1:
+            mid = (lo + hi) // 2
+            if pts[mid][0] <= ms:
+                lo = mid
+            else:
+                hi = mid
+        (t0, la0, lo0), (t1, la1, lo1) = pts[lo], pts[hi]
+        f = 0 if t1 == t0 else (ms - t0) / (t1 - t0)
+        return la0 + (la1 - la0) * f, lo0 + (lo1 - lo0) * f
+
+    def heading(self, ms):
+        a, b = self.at(ms - 500), self.at(ms + 500)
+        if not a or not b or distance_m(a, b) < 1.0:
+            return None
+        d_north = b[0] - a[0]
+        d_east = (b[1] - a[1]) * math.cos(math.radians(a[0] / 1e6))
+        return math.degrees(math.atan2(d_east, d_north)) % 360
+
+
+def stats_line(name, errors):
+    if not errors:
+        return f'  {name:<26} {"-":>6}'
+    errors = sorted(errors)
+    p95 = errors[min(len(errors) - 1, int(len(errors) * 0.95))]
+    rms = math.sqrt(sum(e * e for e in errors) / len(errors))
+    return f'  {name:<26} {len(errors):>6} {rms:>8.1f} {p95:>8.1f} {errors[-1]:>8.1f}'
+
+
+def run(records, truth):
+    fusion = TrackFusion()
+    raw, fused, between, held, heading_err = [], [], [], [], []
+    within1 = within2 = checked = 0
+    mismatches = compared = 0
+    cycles = {'I': [], 'G': []}
+    last_fix = None
+
+    # Stable sort: records with the same time keep the device's order
+    for kind, ms, f in sorted(records, key=lambda r: r[1]):
+        if kind == 'I':
+            fusion.imu(ms, f[0])
+            if len(f) > 1:
+                cycles['I'].append(f[1])
+        elif kind == 'S':
+            fusion.watched_sleep(ms)
+        elif kind == 'G':
+            lat, lon, speed, course, accuracy = f[1:6]
+            fusion.gnss(ms, lat, lon, speed, course, accuracy)
+            if len(f) > 6:
+                cycles['G'].append(f[6])
+            state = fusion.state()
+            last_fix = (state[0], state[1])
+            ref = truth.at(ms)
+            if ref:
+                raw.append(distance_m(ref, (lat, lon)))
+                fused.append(distance_m(ref, last_fix))
+                ref_heading = truth.heading(ms)
+                if ref_heading is not None and state[3] >= 0:
+                    heading_err.append(abs((state[3] / 100 - ref_heading + 180) % 360 - 180))
+        elif kind == 'E':
+            state = fusion.state()
+            device = f[:3] + [f[3] - (1 << 32) if f[3] >= 1 << 31 else f[3]]  # Heading printed unsigned
+            compared += 1
+            if state is None or list(state) != device:
+                mismatches += 1
+                if mismatches <= 5:
+                    print(f'  mirror differs at {ms} ms: device {device}, mirror {state}')
+        elif kind == 'T':
+            state = fusion.state()
+            if state is None or last_fix is None:
+                continue
+            ref = (f[0], f[1])
+            error = distance_m(ref, (state[0], state[1]))
+            between.append(error)
+            held.append(distance_m(ref, last_fix))
+            checked += 1
+            sigma = state[2] / 1000
+            within1 += error <= sigma
+            within2 += error <= 2 * sigma
+
+    print(f'\n{"position error (m)":<28} {"count":>6} {"rms":>8} {"p95":>8} {"max":>8}')
+    print(stats_line('raw GNSS fixes', raw))
+    print(stats_line('fused fixes', fused))
+    print(stats_line('fused track (dead reckoned)', between))
+    print(stats_line('last fix held', held))
+    if heading_err:
+        print(f'\nHeading error: mean {statistics.mean(heading_err):.1f} deg, '
+              f'max {max(heading_err):.1f} deg ({len(heading_err)} fixes)')
+    if checked:
+        print(f'Truth within reported uncertainty: {within1 * 100 // checked}% (1x), '
+              f'{within2 * 100 // checked}% (2x)')
+    print(f'Filter restarts: {fusion.restarts}')
+
+    print('\nCycles per update (device):')
+    for kind, name in (('I', 'IMU'), ('G', 'GNSS')):
+        values = cycles[kind]
+        if values:
+            print(f'  {name:<5} {len(values):>6} updates, mean {statistics.mean(values):.0f}, max {max(values)}')
+        else:
+            print(f'  {name:<5} not in the log (record with TRACK_FUSION_LOG = 1)')
+    if compared:
+        print(f'\nMirror check: {compared - mismatches} of {compared} device estimates reproduced exactly')
+
+
+# Synthetic scenarios: legs of (duration s, speed m/s at the end, heading deg at the end)
+# and the vibration while moving (mean, sigma in g)
+SCENARIOS = {
+    # Ridden: stops, straights and turns
+    'ride': ([(20, 0, 90), (5, 5, 90), (60, 5, 90), (6, 5, 0), (40, 6, 0), (4, 0, 0), (15, 0, 0),
+              (5, 4, 200), (30, 4, 200), (8, 4, 290), (25, 5, 290), (5, 0, 290), (20, 0, 290)],
+             (0.12, 0.05)),
+    # Carried in a van: road speeds, the IMU stays under the stillness threshold at steady speed
+    'transport': ([(20, 0, 90), (25, 12, 90), (90, 14, 90), (10, 14, 30), (60, 14, 30),
+                   (25, 0, 30), (20, 0, 30)],
+                  (0.015, 0.008)),
+}
+
+
+def synth(path, fix_interval, accuracy, seed, scenario='ride'):
+    """Synthetic ride with ground truth"""
+    rng = random.Random(seed)
+    legs, (vibration_mean, vibration_sigma) = SCENARIOS[scenario]
+    lat, lon = 14.599512, 120.984222
+    speed, heading = 0.0, 90.0
+    ms = 1000
+    base_unix = 1760000000000
+    prev_speed = 0.0
+    out = open(path, 'w')
+
+    for duration, end_speed, end_heading in legs:
+        steps = duration * 1000 // IMU_PERIOD_MS
+        start_speed, start_heading = speed, heading
+        turn = (end_heading - start_heading + 180) % 360 - 180
+        for i in range(1, steps + 1):
+            ms += IMU_PERIOD_MS
+            f = i / steps
+            speed = start_speed + (end_speed - start_speed) * f
+            heading = (start_heading + turn * f) % 360
+            dt = IMU_PERIOD_MS / 1000
+            lat += speed * dt * math.cos(math.radians(heading)) / EARTH_M_PER_DEG
+            lon += speed * dt * math.sin(math.radians(heading)) / (EARTH_M_PER_DEG * math.cos(math.radians(lat)))
+            out.write(f'T {ms} {round(lat * 1e6)} {round(lon * 1e6)}\n')
+
+            accel = abs(speed - prev_speed) / dt
+            prev_speed = speed
+            if speed > 0.3:
+                vibration = rng.gauss(vibration_mean, vibration_sigma) * 9.81
+            else:
+                vibration = abs(rng.gauss(0, 0.01)) * 9.81
+            intensity = round(max(0.0, vibration + accel) / 9.81 * 1000)
+            out.write(f'I {ms} {intensity}\n')
+
+            if ms % (fix_interval * 1000) == 0:
+                sigma = accuracy / math.sqrt(2)
+                f_lat = lat + rng.gauss(0, sigma) / EARTH_M_PER_DEG
+                f_lon = lon + rng.gauss(0, sigma) / (EARTH_M_PER_DEG * math.cos(math.radians(lat)))
+                f_speed = max(0.0, speed + rng.gauss(0, 0.3))
+                f_course = (heading + rng.gauss(0, 3)) % 360
+                out.write(f'G {ms} {base_unix + ms} {round(f_lat * 1e6)} {round(f_lon * 1e6)} '
+                          f'{round(f_speed * 1000)} {round(f_course * 100)} {round(accuracy * 1000)}\n')
+    out.close()
+    print(f'Synthetic {scenario}: {ms // 1000} s, fix every {fix_interval} s -> {path}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Replay rides through the track filter')
+    sub = parser.add_subparsers(dest='action', required=True)
+
+    run_cmd = sub.add_parser('run', help='replay a ride and report the error against ground truth')
+    run_cmd.add_argument('ride', help='serial log with FUS lines or a ride file')
+    run_cmd.add_argument('--truth', help='reference track CSV (unix_ms,lat,lon), else T lines in the ride')
+
+    synth_cmd = sub.add_parser('synth', help='write a synthetic ride with ground truth')
+    synth_cmd.add_argument('output')
+    synth_cmd.add_argument('--fix-interval', type=int, default=10, help='seconds between GNSS fixes')
+    synth_cmd.add_argument('--accuracy', type=float, default=5.0, help='GNSS accuracy in metres')
+    synth_cmd.add_argument('--seed', type=int, default=1)
+    synth_cmd.add_argument('--scenario', choices=sorted(SCENARIOS), default='ride',
+                           help='ride (ridden, with stops) or transport (carried in a vehicle)')
+    args = parser.parse_args()
+
+    if args.action == 'synth':
+        synth(args.output, args.fix_interval, args.accuracy, args.seed, args.scenario)
+        return
+
+    records = load_ride(args.ride)
+    if not any(kind == 'G' for kind, _, _ in records):
+        parser.error('no GNSS records in ride')
+    truth_records = load_truth(args.truth, records) if args.truth else [r for r in records if r[0] == 'T']
+    run([r for r in records if r[0] != 'T'] + truth_records, Truth(truth_records))
+
+
+if __name__ == '__main__':
+    main()
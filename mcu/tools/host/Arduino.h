@@ -0,0 +1,234 @@
+/*
+ * Arduino.h (host build)
+ *
+ * The part of the ESP32 Arduino core the modem layer uses, for building
+ * the firmware sources on Linux (see modem_host.cpp). Time is real time
+ * since start, Serial is stdout and simSerial is a pseudo terminal or
+ * serial port driven by tools/modem_standin.py or transcript_replay.py.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+#define F(x) x
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+#define SERIAL_8N1 0x800001c
+#define PI 3.1415926535897932384626433832795
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+typedef int esp_err_t;
+#define ESP_OK 0
+
+// Time and pins
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+/*
+ * Arduino String on top of std::string
+ */
+class String {
+  public:
+    String() {}
+    String(const char* text) : s(text ? text : "") {}
+    String(const std::string& text) : s(text) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(long long v) : s(std::to_string(v)) {}
+    String(unsigned long long v) : s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { format(v, decimals); }
+    String(double v, unsigned int decimals = 2) { format(v, decimals); }
+
+    unsigned int length() const { return s.size(); }
+    bool isEmpty() const { return s.empty(); }
+    const char* c_str() const { return s.c_str(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+
+    char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return s[i]; }
+
+    int indexOf(char c, unsigned int from = 0) const { return found(s.find(c, from)); }
+    int indexOf(const String& text, unsigned int from = 0) const { return found(s.find(text.s, from)); }
+    int lastIndexOf(char c) const { return found(s.rfind(c)); }
+    int lastIndexOf(const String& text) const { return found(s.rfind(text.s)); }
+    bool startsWith(const String& text) const { return s.compare(0, text.s.size(), text.s) == 0; }
+    bool endsWith(const String& text) const {
+      return s.size() >= text.s.size() && s.compare(s.size() - text.s.size(), text.s.size(), text.s) == 0;
+    }
+    bool equals(const String& text) const { return s == text.s; }
+    bool equalsIgnoreCase(const String& text) const { return strcasecmp(s.c_str(), text.s.c_str()) == 0; }
+
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+      if (from > to) std::swap(from, to);
+      return from < s.size() ? String(s.substr(from, to - from)) : String();
+    }
+
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+    double toDouble() const { return atof(s.c_str()); }
+
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    void replace(const String& from, const String& to);
+    void remove(unsigned int index) { if (index < s.size()) s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s.size()) s.erase(index, count); }
+    void getBytes(unsigned char* buf, unsigned int size, unsigned int index = 0) const;
+
+    bool concat(const String& text) { s += text.s; return true; }
+    bool concat(char c) { s += c; return true; }
+    String& operator+=(const String& text) { s += text.s; return *this; }
+    String& operator+=(const char* text) { s += text; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    String& operator+=(int v) { s += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { s += std::to_string(v); return *this; }
+    String& operator+=(long v) { s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+
+    bool operator==(const String& text) const { return s == text.s; }
+    bool operator!=(const String& text) const { return s != text.s; }
+    bool operator==(const char* text) const { return s == text; }
+    bool operator!=(const char* text) const { return s != text; }
+    bool operator<(const String& text) const { return s < text.s; }
+
+    std::string s;
+
+  private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    void format(double v, unsigned int decimals);
+};
+
+inline String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+inline String operator+(const String& a, const char* b) { return String(a.s + b); }
+inline String operator+(const char* a, const String& b) { return String(a + b.s); }
+inline String operator+(const String& a, char b) { return String(a.s + b); }
+inline String operator+(const String& a, int b) { return String(a.s + std::to_string(b)); }
+inline String operator+(const String& a, unsigned int b) { return String(a.s + std::to_string(b)); }
+inline String operator+(const String& a, long b) { return String(a.s + std::to_string(b)); }
+inline String operator+(const String& a, unsigned long b) { return String(a.s + std::to_string(b)); }
+inline String operator+(const String& a, float b) { return a + String(b); }
+inline String operator+(const String& a, double b) { return a + String(b); }
+
+/*
+ * Byte stream with Arduino print helpers, over a file descriptor
+ */
+class Stream {
+  public:
+    virtual ~Stream() {}
+    virtual int available();
+    virtual int read();
+    virtual int peek();
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    void flush() {}
+
+    size_t print(const String& text) { return write(text.c_str()); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+    template <typename T> size_t println(const T& v) { return print(v) + println(); }
+    size_t println(double v, int decimals) { return print(v, decimals) + println(); }
+    size_t println() { return write("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t readBytes(uint8_t* buffer, size_t size);
+    size_t readBytes(char* buffer, size_t size) { return readBytes((uint8_t*)buffer, size); }
+    String readStringUntil(char terminator);
+    void setTimeout(unsigned long ms) { timeoutMs = ms; }
+
+    int fd = -1;
+    bool console = false;   // Line ends are plain '\n' on a terminal
+
+  protected:
+    bool fill(int waitMs);
+    uint8_t rx[4096];
+    size_t rxHead = 0;
+    size_t rxTail = 0;
+    unsigned long timeoutMs = 1000;
+};
+
+typedef enum {
+  UART_NO_ERROR,
+  UART_BREAK_ERROR,
+  UART_BUFFER_FULL_ERROR,
+  UART_FIFO_OVF_ERROR,
+  UART_FRAME_ERROR,
+  UART_PARITY_ERROR
+} hardwareSerial_error_t;
+
+/*
+ * UART 0 is stdout/stdin, any other UART is the device opened with
+ * openHostSerial() (set up raw, rate changes are only logged)
+ */
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(int uart) : uartNum(uart) {}
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end() {}
+    void updateBaudRate(unsigned long baud);
+    unsigned long baudRate() { return baudRateValue; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    void onReceiveError(void (*handler)(hardwareSerial_error_t)) { (void)handler; }
+    operator bool() const { return true; }
+
+    using Stream::read;
+    using Stream::write;
+
+  private:
+    int uartNum;
+    unsigned long baudRateValue = 0;
+};
+
+extern HardwareSerial Serial;
+bool openHostSerial(HardwareSerial& port, const char* device);
+
+struct EspClass {
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  uint32_t getCycleCount() { return (uint32_t)(micros() * 240); }
+  uint32_t getFreeHeap() { return 200000; }
+  void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
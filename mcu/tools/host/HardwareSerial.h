@@ -0,0 +1,5 @@
+/*
+ * HardwareSerial.h (host build), the class lives in Arduino.h
+ */
+
+#include "Arduino.h"
@@ -0,0 +1,50 @@
+/*
+ * Preferences.h (host build)
+ *
+ * NVS namespaces kept in RAM for the life of the process
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+
+class Preferences {
+  public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+    size_t putString(const char* key, const String& value);
+    String getString(const char* key, const String& defaultValue = String());
+    size_t getString(const char* key, char* buf, size_t maxLen);
+
+    size_t putBool(const char* key, bool value) { return putValue(key, value); }
+    size_t putUChar(const char* key, uint8_t value) { return putValue(key, value); }
+    size_t putInt(const char* key, int32_t value) { return putValue(key, value); }
+    size_t putUInt(const char* key, uint32_t value) { return putValue(key, value); }
+    size_t putULong(const char* key, uint32_t value) { return putValue(key, value); }
+    size_t putFloat(const char* key, float value) { return putValue(key, value); }
+    bool getBool(const char* key, bool defaultValue = false) { return getValue(key, defaultValue); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getULong(const char* key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    float getFloat(const char* key, float defaultValue = 0) { return getValue(key, defaultValue); }
+
+  private:
+    template <typename T> size_t putValue(const char* key, T value) { return putBytes(key, &value, sizeof(T)); }
+    template <typename T> T getValue(const char* key, T defaultValue) {
+      T value;
+      return getBytesLength(key) == sizeof(T) && getBytes(key, &value, sizeof(T)) ? value : defaultValue;
+    }
+
+    std::string space;
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,303 @@
+/*
+ * arduino_host.cpp
+ *
+ * Host implementation of the Arduino core subset in Arduino.h,
+ * Preferences.h and esp_partition.h
+ */
+
+#include "Arduino.h"
+#include "Preferences.h"
+#include "esp_partition.h"
+#include "driver/gpio.h"
+#include <chrono>
+#include <map>
+#include <vector>
+#include <thread>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+HardwareSerial Serial(0);
+EspClass ESP;
+
+static const auto hostStart = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - hostStart).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - hostStart).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {}
+
+// No pins on the host: power and DTR lines are no-ops
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+esp_err_t gpio_hold_en(gpio_num_t) { return ESP_OK; }
+esp_err_t gpio_hold_dis(gpio_num_t) { return ESP_OK; }
+void gpio_deep_sleep_hold_en() {}
+void gpio_deep_sleep_hold_dis() {}
+
+// ---- String ----
+
+void String::format(double v, unsigned int decimals) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  s = buf;
+}
+
+void String::trim() {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    s.clear();
+    return;
+  }
+  s = s.substr(begin, s.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+void String::toUpperCase() {
+  for (char& c : s) c = toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+  for (char& c : s) c = tolower((unsigned char)c);
+}
+
+void String::replace(const String& from, const String& to) {
+  if (from.s.empty()) return;
+  size_t pos = 0;
+  while ((pos = s.find(from.s, pos)) != std::string::npos) {
+    s.replace(pos, from.s.size(), to.s);
+    pos += to.s.size();
+  }
+}
+
+void String::getBytes(unsigned char* buf, unsigned int size, unsigned int index) const {
+  if (size == 0) return;
+  size_t n = 0;
+  if (index < s.size()) {
+    n = min((size_t)size - 1, s.size() - index);
+    memcpy(buf, s.data() + index, n);
+  }
+  buf[n] = 0;
+}
+
+// ---- Stream ----
+
+/*
+ * Read what the descriptor has into the receive buffer
+ * Waits up to waitMs for the first byte, returns whether any is buffered
+ */
+bool Stream::fill(int waitMs) {
+  if (rxHead < rxTail) return true;
+  if (fd < 0) return false;
+
+  struct pollfd p = {fd, POLLIN, 0};
+  if (poll(&p, 1, waitMs) <= 0 || !(p.revents & POLLIN)) return false;
+
+  ssize_t n = ::read(fd, rx, sizeof(rx));
+  if (n <= 0) return false;
+  rxHead = 0;
+  rxTail = n;
+  return true;
+}
+
+int Stream::available() {
+  fill(0);
+  return rxTail - rxHead;
+}
+
+int Stream::read() {
+  return fill(0) ? rx[rxHead++] : -1;
+}
+
+int Stream::peek() {
+  return fill(0) ? rx[rxHead] : -1;
+}
+
+size_t Stream::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t Stream::write(const uint8_t* buffer, size_t size) {
+  int out = (fd < 0) ? 1 : fd;
+  size_t done = 0;
+  while (done < size) {
+    if (console && buffer[done] == '\r') {
+      done++;
+      continue;
+    }
+    size_t run = 1;
+    while (done + run < size && !(console && buffer[done + run] == '\r')) run++;
+    ssize_t n = ::write(out, buffer + done, run);
+    if (n <= 0) break;
+    done += n;
+  }
+  return done;
+}
+
+size_t Stream::printf(const char* format, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, min((size_t)n, sizeof(buf) - 1));
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  unsigned long start = millis();
+  while (n < size && millis() - start < timeoutMs) {
+    if (fill(5)) buffer[n++] = rx[rxHead++];
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String text;
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (!fill(5)) continue;
+    char c = rx[rxHead++];
+    if (c == terminator) break;
+    text += c;
+  }
+  return text;
+}
+
+// ---- HardwareSerial ----
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t) {
+  baudRateValue = baud;
+  if (uartNum == 0) {
+    fd = STDOUT_FILENO;
+    console = true;
+  }
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+  baudRateValue = baud;
+  if (fd < 0 || !isatty(fd)) return;
+
+  // A real serial port follows the rate, a pseudo terminal ignores it
+  speed_t speed;
+  switch (baud) {
+    case 115200: speed = B115200; break;
+    case 230400: speed = B230400; break;
+    case 460800: speed = B460800; break;
+    case 921600: speed = B921600; break;
+    default: return;
+  }
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) return;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tcsetattr(fd, TCSADRAIN, &tio);
+}
+
+/*
+ * Attach a UART to a serial port or pseudo terminal, raw 8N1
+ */
+bool openHostSerial(HardwareSerial& port, const char* device) {
+  int fd = open(device, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    perror(device);
+    return false;
+  }
+
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  port.fd = fd;
+  return true;
+}
+
+// ---- Preferences (RAM only, one process is one power cycle) ----
+
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  space = name;
+  (void)readOnly;
+  return true;
+}
+
+void Preferences::end() {}
+
+bool Preferences::clear() {
+  nvs[space].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  return nvs[space].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return nvs[space].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  const uint8_t* p = (const uint8_t*)value;
+  nvs[space][key].assign(p, p + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  auto& ns = nvs[space];
+  auto it = ns.find(key);
+  if (it == ns.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  auto& ns = nvs[space];
+  auto it = ns.find(key);
+  return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+  return putBytes(key, value.c_str(), value.length() + 1);
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+  auto& ns = nvs[space];
+  auto it = ns.find(key);
+  return it == ns.end() ? defaultValue : String((const char*)it->second.data());
+}
+
+size_t Preferences::getString(const char* key, char* buf, size_t maxLen) {
+  return getBytes(key, buf, maxLen);
+}
+
+// ---- Flash partition (none on the host: the transcript recorder stays off) ----
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char*) {
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t*, size_t, void*, size_t) { return -1; }
+esp_err_t esp_partition_write(const esp_partition_t*, size_t, const void*, size_t) { return -1; }
+esp_err_t esp_partition_erase_range(const esp_partition_t*, size_t, size_t) { return -1; }
@@ -0,0 +1,17 @@
+/*
+ * driver/gpio.h (host build), pad holds are no-ops
+ */
+
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#include "../Arduino.h"
+
+typedef int gpio_num_t;
+
+esp_err_t gpio_hold_en(gpio_num_t pin);
+esp_err_t gpio_hold_dis(gpio_num_t pin);
+void gpio_deep_sleep_hold_en();
+void gpio_deep_sleep_hold_dis();
+
+#endif // HOST_DRIVER_GPIO_H
@@ -0,0 +1,202 @@
+/*
+ * modem_host.cpp
+ *
+ * Report sessions of the tracker firmware, built for Linux
+ *
+ * Links the modem layer (sim7070g.cpp, gps_handler.cpp, sms_handler.cpp,
+ * data_uplink.cpp, track_upload.cpp and what they use) unchanged against
+ * the host core in this directory. simSerial is the serial device given on
+ * the command line, normally the pseudo terminal of modem_standin.py or
+ * transcript_replay.py (both start this program with --host):
+ *
+ *   make -C mcu/tools/host
+ *   python3 mcu/tools/modem_standin.py --host mcu/tools/host/modem_host
+ *   python3 mcu/tools/transcript_replay.py replay serial.log --host mcu/tools/host/modem_host
+ *
+ * Each wake runs the session the sketch runs after a timer wake
+ * (runReportSession in bike_tracker_esp32.ino): planner phases, GNSS
+ * fix, data uplink with SMS fallback, outbox retries, inbound commands.
+ * BLE, sensors and deep sleep are left out; RTC state carries over from
+ * one wake to the next as it does on the device, NVS lasts for the run.
+ */
+
+#include <Arduino.h>
+#include "sim7070g.h"
+#include "gps_handler.h"
+#include "sms_handler.h"
+#include "sms_outbox.h"
+#include "report_session.h"
+#include "data_uplink.h"
+#include "track_upload.h"
+#include "cell_locator.h"
+#include "signal_quality.h"
+#include "gnss_profile.h"
+#include "gnss_budget.h"
+#include "modem_transcript.h"
+
+struct HostOptions {
+  const char* device;
+  int wakes;
+  uint32_t sleepMs;
+  const char* phone;
+  char uplinkHost[UPLINK_HOST_MAX_LEN];
+  uint16_t uplinkPort;
+  uint16_t interval;
+  bool urgent;
+};
+
+static HostOptions options = {nullptr, 1, 0, "+15550100", "", 0, 300, false};
+
+/*
+ * Inbound commands are only logged, the sketch's handler needs its config
+ */
+static bool logSMSCommand(SMSCommand cmd, long arg, char* reply, size_t replySize) {
+  Serial.printf("📩 Command %d (%ld)\n", cmd, arg);
+  snprintf(reply, replySize, "OK");
+  return true;
+}
+
+/*
+ * Report over the data uplink, as sendUplinkReport() in the sketch
+ */
+static bool sendHostUplinkReport(const GPSData& gps, bool fresh, const CellLocation& cell) {
+  if (options.uplinkPort == 0 || !setModemState(MODEM_RF)) return false;
+
+  ReportInfo report = {REPORT_STATUS, ALERT_BLE_DISCONNECT, &gps, false, options.interval};
+  if (!gps.valid) report.type = REPORT_NO_FIX;
+  if (!fresh && cell.hasCell) report.cell = &cell;
+  FusedState fused;
+  getFusedState(fused);
+  if (fused.valid) report.fused = &fused;
+  if (!sendDataReport(options.uplinkHost, options.uplinkPort, report, fresh)) {
+    Serial.println("📱 Data uplink failed - falling back to SMS");
+    return false;
+  }
+
+  uploadTrackHistory(options.uplinkHost, options.uplinkPort);
+  flushSMSOutbox();
+  checkInboundSMS(options.phone);
+  return true;
+}
+
+/*
+ * One wake: the planned OFF -> (RF) -> GNSS -> RF -> OFF session
+ */
+static bool runHostSession() {
+  if (!isSIM7070GInitialized() && !initializeSIM7070G()) return false;
+
+  SessionWork work = {};
+  work.needFix = true;
+  work.messages = 1 + getSMSOutboxCount();
+  work.inboundCheck = true;
+
+  uint32_t gnssAttempts = predictGNSSAttempts();
+  work.cellFirst = isGNSSFixDoubtful() && getModemState() != MODEM_GNSS;
+
+  SessionPlan plan = planReportSession(work);
+  beginReportSession(plan);
+  setTransmissionUrgency(options.urgent);
+  selectGNSSProfile(options.urgent ? GNSS_PROFILE_URGENT :
+                    options.interval <= GNSS_LIVE_INTERVAL_S ? GNSS_PROFILE_LIVE :
+                    GNSS_PROFILE_PERIODIC);
+
+  GPSData gps = GPSData();
+  bool fresh = false;
+  bool reported = false;
+  CellLocation cell = CellLocation();
+  SMSRecipientList recipients = {};
+  strncpy(recipients.entries[0].number, options.phone, RECIPIENT_NUMBER_MAX_LEN - 1);
+  recipients.entries[0].alertMask = ALERT_MASK_ALL;
+  recipients.count = 1;
+
+  for (int i = 0; i < plan.phaseCount; i++) {
+    enterSessionPhase(plan.phases[i]);
+
+    if (plan.phases[i] == MODEM_RF && i + 1 < plan.phaseCount && plan.phases[i + 1] == MODEM_GNSS) {
+      if (setModemState(MODEM_RF) && locateByCell(cell)) {
+        gnssAttempts = capGNSSAttempts(gnssAttempts);
+      }
+    } else if (plan.phases[i] == MODEM_GNSS) {
+      // Trusted fixes go to the track log (uploaded with the report), as in the sketch
+      if (acquireGPSFix(gps, gnssAttempts)) {
+        saveGPSData(gps);
+        logGPSPoint(gps, 2);
+        fresh = true;
+      } else if (getRejectedFix(gps)) {
+        fresh = true;   // Reported unverified
+      } else {
+        loadGPSData(gps);
+      }
+    } else if (plan.phases[i] == MODEM_RF) {
+      if (setModemState(MODEM_RF)) sampleSignalQuality();
+      if (shouldDeferTransmission()) {
+        flushSMSOutbox();
+        checkInboundSMS(options.phone);
+        continue;
+      }
+      if (!fresh && !cell.hasCell && setModemState(MODEM_RF)) locateByCell(cell);
+
+      reported = sendHostUplinkReport(gps, fresh, cell);
+      if (!reported && cell.resolved && !fresh) {
+        reported = sendCellLocationSMS(recipients, cell, false, options.interval);
+      } else if (!reported && gps.valid) {
+        reported = sendDisconnectSMS(recipients, gps, false, options.interval);
+      } else if (!reported) {
+        reported = sendNoLocationSMS(recipients, false, false, gps, options.interval);
+      }
+    }
+  }
+
+  endReportSession();
+  return reported;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: modem_host DEVICE [--wakes N] [--sleep S] [--phone NUMBER]\n"
+          "                  [--uplink HOST:PORT] [--interval S] [--urgent]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) usage();
+  options.device = argv[1];
+  for (int i = 2; i < argc; i++) {
+    String arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--wakes" && hasValue) {
+      options.wakes = atoi(argv[++i]);
+    } else if (arg == "--sleep" && hasValue) {
+      options.sleepMs = atof(argv[++i]) * 1000;
+    } else if (arg == "--phone" && hasValue) {
+      options.phone = argv[++i];
+    } else if (arg == "--interval" && hasValue) {
+      options.interval = atoi(argv[++i]);
+    } else if (arg == "--uplink" && hasValue) {
+      String value = argv[++i];
+      int colon = value.lastIndexOf(':');
+      if (colon <= 0) usage();
+      strncpy(options.uplinkHost, value.substring(0, colon).c_str(), UPLINK_HOST_MAX_LEN - 1);
+      options.uplinkPort = value.substring(colon + 1).toInt();
+    } else if (arg == "--urgent") {
+      options.urgent = true;
+    } else {
+      usage();
+    }
+  }
+
+  Serial.begin(115200);
+  if (!openHostSerial(simSerial, options.device)) return 1;
+  setSMSCommandHandler(logSMSCommand);
+  initGPSHistory();
+
+  int reported = 0;
+  for (int wake = 0; wake < options.wakes; wake++) {
+    if (wake > 0) delay(options.sleepMs);
+    Serial.printf("\n=== Wake %d ===\n", wake);
+    if (runHostSession()) reported++;
+  }
+
+  Serial.printf("\n%d of %d sessions reported\n", reported, options.wakes);
+  return reported == options.wakes ? 0 : 1;
+}
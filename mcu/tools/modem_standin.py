@@ -0,0 +1,348 @@
+"""Scripted stand-in for the SIM7070G AT interface.
+
+Answers the AT commands used by the tracker firmware so report sessions
+can run without a modem or network: GNSS returns a scripted fix, SMS
+submissions are logged, and the data uplink commands (AT+CNACT,
+AT+CAOPEN, AT+CASEND, AT+CARECV) go to a real UDP socket, e.g. the
+local uplink_server.py.
+
+Without hardware, run the host build of the firmware's modem layer
+(host/modem_host.cpp) on a pseudo terminal. The stand-in exits with the
+host program, its status tells whether every session reported:
+
+    make -C host
+    python3 uplink_server.py --port 9000 &
+    python3 modem_standin.py --host "host/modem_host --wakes 2 --uplink 127.0.0.1:9000"
+    python3 modem_standin.py --host host/modem_host --fail cmgs   # SMS queued in the outbox
+
+Or connect the ESP32's modem UART (GPIO4/5) to a USB-serial adapter:
+
+    python3 modem_standin.py --port /dev/ttyUSB0
+    python3 modem_standin.py --port /dev/ttyUSB0 --fail caopen   # force SMS fallback
+
+Without --port or --host a pseudo terminal is created for manual testing.
+"""
+
+import argparse
+import os
+import re
+import select
+import shlex
+import socket
+import subprocess
+import sys
+import time
+
+CTRL_Z = 0x1A
+ESC = 0x1B
+
+
+class SerialLink:
+    """Byte stream to the firmware, a serial port or a pseudo terminal"""
+
+    def __init__(self, port, baud):
+        self.child = None
+        if port:
+            import serial  # pyserial
+            self.port = serial.Serial(port, baud, timeout=0)
+            self.fd = self.port.fileno()
+            print(f'Modem stand-in on {port} @ {baud}')
+        else:
+            self.port = None
+            self.fd, self.slave = os.openpty()
+            self.name = os.ttyname(self.slave)
+            print(f'Modem stand-in on {self.name}')
+
+    def spawn(self, command):
+        """Run a host build ("host/modem_host [options]") on the pseudo terminal"""
+        args = shlex.split(command)
+        self.child = subprocess.Popen([args[0], self.name] + args[1:])
+
+    @property
+    def running(self):
+        """False once a spawned host build has exited"""
+        return self.child is None or self.child.poll() is None
+
+    def close(self):
+        """Stop a spawned host build, return its exit status"""
+        if self.child is None:
+            return 0
+        if self.child.poll() is None:
+            self.child.terminate()
+        return self.child.wait()
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        return os.read(self.fd, 256) if ready else b''
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def set_baud(self, baud):
+        if self.port:
+            self.port.flush()
+            self.port.baudrate = baud
+            print(f'  link now {baud} baud')
+
+
+class ModemStandIn:
+    def __init__(self, link, fix, failures, delay):
+        self.link = link
+        self.fix = fix
+        self.failures = failures
+        self.delay = delay
+        self.cfun = 1
+        self.cmgf = 0
+        self.gnss = False
+        self.gnss_since = 0.0
+        self.pdp_active = False
+        self.psm = False
+        self.edrx = False
+        self.sock = None
+        self.remote = None
+        self.buffer = b''
+        self.pending = None  # ('casend', length) or ('cmgs', None)
+
+    def reply(self, *lines, ok=True):
+        out = ''.join(f'\r\n{line}\r\n' for line in lines)
+        if ok:
+            out += '\r\nOK\r\n'
+        self.link.write(out.encode())
+
+    def error(self):
+        self.link.write(b'\r\nERROR\r\n')
+
+    def fails(self, name):
+        return name in self.failures
+
+    def run(self):
+        while self.link.running:
+            self.buffer += self.link.read(0.05)
+            self.process()
+        return self.link.close()
+
+    def process(self):
+        while True:
+            if self.pending:
+                if not self.process_payload():
+                    return
+                continue
+
+            # Drop stray escape characters sent to leave SMS mode
+            self.buffer = self.buffer.replace(bytes([ESC]), b'')
+            end = self.buffer.find(b'\r')
+            if end == -1:
+                return
+            line = self.buffer[:end].decode(errors='replace').strip()
+            self.buffer = self.buffer[end + 1:].lstrip(b'\n')
+            if line:
+                print(f'> {line}')
+                time.sleep(self.delay)
+                self.command(line)
+
+    def process_payload(self):
+        kind, length = self.pending
+        if kind == 'casend':
+            if len(self.buffer) < length:
+                return False
+            data, self.buffer = self.buffer[:length], self.buffer[length:]
+            self.pending = None
+            print(f'  datagram {len(data)} bytes: {data.hex()}')
+            if self.fails('casend') or self.sock is None:
+                self.error()
+            else:
+                self.sock.sendto(data, self.remote)
+                self.reply()
+            return True
+
+        # SMS body ends with Ctrl+Z, ESC cancels
+        for i, b in enumerate(self.buffer):
+            if b in (CTRL_Z, ESC):
+                body, self.buffer = self.buffer[:i], self.buffer[i + 1:]
+                self.pending = None
+                if b == ESC:
+                    print('  SMS cancelled')
+                elif self.fails('cmgs') or self.cfun != 1:
+                    print(f'  SMS rejected: {body.decode(errors="replace")}')
+                    self.error()
+                else:
+                    print(f'  SMS submitted: {body.decode(errors="replace")}')
+                    self.reply('+CMGS: 1')
+                return True
+        return False
+
+    def command(self, line):
+        cmd = line.upper()
+
+        if cmd.startswith('AT+CMGF='):
+            self.cmgf = int(cmd.split('=')[1] or 0)
+            self.reply()
+        elif cmd == 'AT+CMGF?':
+            self.reply('+CMGF: %d' % self.cmgf)
+        elif cmd in ('AT', 'ATE0') or cmd.startswith(('AT+CSMP', 'AT+CNMI', 'AT+CMGD', 'AT+CNCFG', 'AT+CMEE=',
+                                                    'AT+CSCLK', 'AT+CEREG=', 'AT+CMNB=', 'AT+CBANDCFG=')):
+            self.reply()
+        elif cmd == 'AT+CSQ':
+            self.reply('+CSQ: 20,99')
+        elif cmd.startswith('AT+CFUN='):
+            self.cfun = 1 if cmd.split('=')[1].startswith('1') else 0
+            if self.cfun == 0:
+                self.pdp_active = False
+            self.reply()
+        elif cmd == 'AT+CREG?':
+            self.reply('+CREG: 0,%d' % (1 if self.cfun == 1 else 0))
+        elif cmd == 'AT+COPS?':
+            self.reply('+COPS: 0,0,"Stand-in",7')
+        elif cmd.startswith('AT+CGNSPWR='):
+            self.gnss = cmd.endswith('1')
+            self.gnss_since = time.monotonic()
+            self.reply()
+        elif cmd.startswith(('AT+CGNSMOD=', 'AT+CGNSCMD=')) or cmd in ('AT+CGNSHOT', 'AT+CGNSWARM', 'AT+CGNSCOLD'):
+            self.reply()
+        elif cmd == 'AT+CGNSINF':
+            self.gnss_info()
+        elif cmd.startswith('AT+CMGL'):
+            self.reply()
+        elif cmd.startswith('AT+CMGS='):
+            self.pending = ('cmgs', None)
+            self.link.write(b'\r\n> ')
+        elif cmd == 'AT+CNACT?':
+            state = 1 if self.pdp_active else 0
+            self.reply('+CNACT: 0,%d,"%s"' % (state, '10.0.0.2' if state else '0.0.0.0'))
+        elif cmd == 'AT+CPSI?':
+            if self.cfun != 1 or self.fails('cell'):
+                self.reply('+CPSI: NO SERVICE,Online')
+            else:
+                self.reply('+CPSI: LTE CAT-M1,Online,515-02,0x5A1E,187214780,257,EUTRAN-BAND28,9410,3,3,-11,-98,-70,12')
+        elif cmd.startswith('AT+CENG='):
+            self.reply()
+        elif cmd == 'AT+CENG?':
+            self.reply('+CENG: 1,1,3,LTE CAT-M1',
+                       '+CENG: 0,"9410,257,-98,-70,-11,12,5a1e,187214780,515,02,255"',
+                       '+CENG: 1,"9410,101,-106"',
+                       '+CENG: 2,"9410,388,-111"')
+        elif cmd.startswith('AT+CLBS='):
+            if not self.pdp_active or self.fails('lbs') or self.fix is None:
+                self.reply('+CLBS: 1')
+            else:
+                lat, lon = self.fix
+                self.reply(f'+CLBS: 0,{lon + 0.0031:.6f},{lat - 0.0024:.6f},550')
+        elif cmd.startswith('AT+IPR='):
+            if self.fails('ipr'):
+                self.error()
+            else:
+                self.reply()
+                self.link.set_baud(int(cmd.split('=')[1]))
+        elif cmd == 'AT+CGMR':
+            self.reply('Revision:1951B16SIM7070')
+        elif cmd == 'AT&W':
+            self.reply()
+        elif cmd == 'AT+CPOWD=1':
+            self.reply('NORMAL POWER DOWN', ok=False)
+            self.cfun = 1  # Boots with full functionality
+            self.cmgf = 0
+            self.gnss = False
+            self.pdp_active = False
+        elif cmd.startswith('AT+CPSMS='):
+            self.psm = cmd.startswith('AT+CPSMS=1')
+            self.reply()
+        elif cmd == 'AT+CEREG?':
+            granted = '"00000001","00100011"' if self.psm and not self.fails('psm') else ','
+            self.reply('+CEREG: 4,%d,"5A1E","0B28ABBC",7,,,%s' % (1 if self.cfun == 1 else 0, granted))
+        elif cmd.startswith('AT+CEDRX='):
+            self.edrx = cmd.startswith('AT+CEDRX=1')
+            self.reply()
+        elif cmd == 'AT+CEDRXRDP':
+            if self.edrx and not self.fails('edrx'):
+                self.reply('+CEDRXRDP: 4,"1001","1001","0011"')
+            else:
+                self.reply('+CEDRXRDP: 0')
+        elif cmd.startswith('AT+CNACT='):
+            if self.fails('cnact') or self.cfun != 1:
+                self.error()
+            else:
+                self.pdp_active = cmd.endswith(',1')
+                self.reply()
+                self.link.write(b'\r\n+APP PDP: 0,ACTIVE\r\n')
+        elif cmd.startswith('AT+CAOPEN='):
+            self.open_socket(line)
+        elif cmd.startswith('AT+CASEND='):
+            self.pending = ('casend', int(cmd.split(',')[1]))
+            self.link.write(b'\r\n> ')
+        elif cmd.startswith('AT+CARECV='):
+            self.receive(int(cmd.split(',')[1]))
+        elif cmd.startswith('AT+CACLOSE'):
+            if self.sock:
+                self.sock.close()
+                self.sock = None
+            self.reply()
+        else:
+            print(f'  unhandled command, answering ERROR')
+            self.error()
+
+    def gnss_info(self):
+        if not self.gnss or self.fails('gnss') or self.fix is None:
+            self.reply('+CGNSINF: %d,0,,,,,,,,,,,,,,,,,,,' % (1 if self.gnss else 0))
+            return
+        lat, lon = self.fix
+        utc = time.strftime('%Y%m%d%H%M%S.000', time.gmtime())
+        # Fix quality improves while the receiver tracks more satellites
+        elapsed = time.monotonic() - self.gnss_since
+        hdop = max(0.9, 3.5 - 0.25 * elapsed)
+        used = min(10, 4 + int(elapsed / 2))
+        self.reply(f'+CGNSINF: 1,1,{utc},{lat:.6f},{lon:.6f},12.0,0.00,0.0,1,,'
+                   f'{hdop:.1f},{hdop + 0.4:.1f},0.9,,12,{used},,,30,,')
+
+    def open_socket(self, line):
+        match = re.match(r'AT\+CAOPEN=(\d+),(\d+),"(\w+)","([^"]+)",(\d+)', line, re.I)
+        if not match or not self.pdp_active or self.fails('caopen'):
+            cid = match.group(1) if match else '0'
+            self.reply(f'+CAOPEN: {cid},1')
+            return
+        cid, _, proto, host, port = match.groups()
+        self.remote = (host, int(port))
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setblocking(False)
+        print(f'  socket {cid} -> {proto} {host}:{port}')
+        self.reply(f'+CAOPEN: {cid},0')
+
+    def receive(self, size):
+        data = b''
+        if self.sock and not self.fails('ack'):
+            try:
+                data = self.sock.recv(size)
+            except BlockingIOError:
+                pass
+        if data:
+            print(f'  received {len(data)} bytes: {data.hex()}')
+            self.link.write(b'\r\n+CARECV: %d,' % len(data) + data + b'\r\n\r\nOK\r\n')
+        else:
+            self.reply('+CARECV: 0')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Scripted SIM7070G stand-in')
+    parser.add_argument('--port', help='serial device wired to the ESP32 modem UART')
+    parser.add_argument('--host', help='host build to run on a pseudo terminal, with its options')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--fix', default='14.599512,120.984222',
+                        help='"lat,lon" returned by AT+CGNSINF, "none" for no fix')
+    parser.add_argument('--fail', action='append', default=[],
+                        choices=['gnss', 'cmgs', 'cnact', 'caopen', 'casend', 'ack', 'lbs', 'cell', 'psm', 'edrx', 'ipr'],
+                        help='make a step fail (repeatable)')
+    parser.add_argument('--delay', type=float, default=0.0,
+                        help='seconds to wait before answering each command')
+    args = parser.parse_args()
+
+    if args.port and args.host:
+        parser.error('--port and --host are exclusive')
+
+    fix = None if args.fix == 'none' else tuple(float(v) for v in args.fix.split(','))
+    link = SerialLink(args.port, args.baud)
+    if args.host:
+        link.spawn(args.host)
+    sys.exit(ModemStandIn(link, fix, set(args.fail), args.delay).run())
+
+
+if __name__ == '__main__':
+    main()
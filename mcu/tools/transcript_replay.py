@@ -0,0 +1,340 @@
+"""Replay recorded SIM7070G UART transcripts against the tracker firmware.
+
+The firmware records every byte on the modem UART when built with
+MODEM_TRANSCRIPT = 1 (modem_transcript.h). Get the transcript off the
+device either from a serial log of the "dumptranscript" command or by
+reading the partition with esptool:
+
+    esptool.py read_flash 0x290000 0x160000 transcript.bin
+
+Show the recorded sessions, per command and wake:
+
+    python3 transcript_replay.py show serial.log
+
+Replay one as the modem, with the recorded response timing, to the
+host build of the modem layer (host/modem_host.cpp, no hardware needed)
+or to a firmware build wired as for modem_standin.py. The firmware's
+command flow and timing are compared with the recording, so a change to
+sim7070g.cpp, gps_handler.cpp or sms_handler.cpp can be benchmarked
+against real field sessions:
+
+    make -C host
+    python3 transcript_replay.py replay serial.log --host host/modem_host
+    python3 transcript_replay.py replay transcript.bin --wake 12 --host "host/modem_host --urgent"
+    python3 transcript_replay.py replay serial.log --port /dev/ttyUSB0 --speed 2
+
+The host build runs one report session per wake (--wakes N for more),
+so replay the wakes that recorded report sessions.
+
+Commands are matched to the recording by their key (text up to the
+first parameter, as at_stats.cpp), looking a few exchanges ahead so a
+firmware that skips or adds steps stays in step with the transcript.
+"""
+
+import argparse
+import re
+import struct
+import time
+from collections import OrderedDict
+
+from modem_standin import SerialLink, CTRL_Z, ESC
+
+# Must match modem_transcript.h
+TX = ord('T')
+RX = ord('R')
+WAKE = ord('W')
+HEADER_FORMAT = '<BBI'
+HEADER_LEN = struct.calcsize(HEADER_FORMAT)
+
+LOOKAHEAD = 8          # Exchanges searched for a matching command
+PAYLOAD_QUIET_S = 0.2  # End of a prompt payload without Ctrl+Z
+
+
+def load(path):
+    """Records (type, ms, payload) from a serial log or a raw partition image"""
+    data = open(path, 'rb').read()
+    if b'MTR ' in data:
+        chunks = {}
+        for line in data.decode(errors='replace').splitlines():
+            m = re.search(r'MTR ([0-9a-f]{6}) ([0-9a-f]+)', line)
+            if m:
+                chunks[int(m.group(1), 16)] = bytes.fromhex(m.group(2))
+        data = b''.join(chunks[k] for k in sorted(chunks))
+
+    records = []
+    offset = 0
+    while offset + HEADER_LEN <= len(data):
+        kind, length, ms = struct.unpack_from(HEADER_FORMAT, data, offset)
+        if kind not in (TX, RX, WAKE) or length == 0:
+            break
+        payload = data[offset + HEADER_LEN:offset + HEADER_LEN + length]
+        records.append((kind, ms, payload))
+        offset += HEADER_LEN + length
+    return records
+
+
+INDEXED_KEYS = ('AT+CMGD', 'AT+CMGR', 'AT+CMGS', 'AT+CMGL', 'AT+IPR', 'AT+CMNB', 'AT+CBANDCFG',
+                'AT+CNCFG', 'AT+CAOPEN', 'AT+CASEND', 'AT+CARECV', 'AT+CACLOSE', 'AT+CLBS',
+                'AT+CGNSMOD', 'AT+CGNSCMD', 'AT+CSMP', 'AT+CNMI')
+
+
+def command_key(line):
+    """Command text up to its first parameter, as makeATKey()"""
+    key = ''
+    equals = -1
+    for i, c in enumerate(line):
+        if c in ',"\r\n' or len(key) >= 15 or (equals != -1 and i > equals + 1):
+            break
+        if c == '=':
+            if key in INDEXED_KEYS:
+                break
+            equals = i
+        key += c
+    return key
+
+
+class Exchange:
+    """One firmware transmission and the modem bytes that followed it"""
+
+    def __init__(self, wake, ms, sent):
+        self.wake = wake
+        self.ms = ms
+        self.sent = sent
+        self.replies = []  # (offset ms, bytes)
+
+    @property
+    def line(self):
+        return self.sent.split(b'\r')[0].decode(errors='replace').strip()
+
+    @property
+    def key(self):
+        if self.sent.strip(bytes([ESC])) == b'':
+            return 'ESC'
+        return command_key(self.line) if self.line.upper().startswith('AT') else 'PAYLOAD'
+
+    @property
+    def prompts(self):
+        return any(b'>' in data for _, data in self.replies)
+
+
+def build_exchanges(records):
+    """Group records into exchanges, split at every transmission"""
+    exchanges = []
+    wake = 0
+    current = None
+    for kind, ms, payload in records:
+        if kind == WAKE:
+            wake = struct.unpack('<I', payload[:4])[0]
+            current = None
+        elif kind == TX:
+            if current and not current.replies and ms - current.ms < 20:
+                current.sent += payload  # Same transmission split over records
+            else:
+                current = Exchange(wake, ms, payload)
+                exchanges.append(current)
+        elif current:
+            current.replies.append((ms - current.ms, payload))
+    return exchanges
+
+
+def summarize(title, rows):
+    """Print per-command time between consecutive commands"""
+    print(f'\n{title}')
+    print(f'  {"command":<12} {"count":>5} {"total ms":>9} {"mean ms":>8}')
+    for key, times in sorted(rows.items(), key=lambda kv: -sum(kv[1])):
+        print(f'  {key:<12} {len(times):>5} {sum(times):>9} {sum(times) // len(times):>8}')
+
+
+def recorded_gaps(exchanges):
+    """Per-command time until the firmware's next transmission, by wake"""
+    wakes = OrderedDict()
+    for cur, nxt in zip(exchanges, exchanges[1:] + [None]):
+        rows = wakes.setdefault(cur.wake, {})
+        end = nxt.ms if nxt and nxt.wake == cur.wake else cur.ms + (cur.replies[-1][0] if cur.replies else 0)
+        rows.setdefault(cur.key, []).append(end - cur.ms)
+    return wakes
+
+
+def show(exchanges, verbose):
+    for wake, rows in recorded_gaps(exchanges).items():
+        session = [e for e in exchanges if e.wake == wake]
+        total = sum(sum(t) for t in rows.values())
+        summarize(f'Wake {wake}: {len(session)} exchanges, {total} ms', rows)
+        if verbose:
+            for e in session:
+                reply = b''.join(d for _, d in e.replies).decode(errors='replace')
+                first = e.replies[0][0] if e.replies else '-'
+                print(f'    {e.ms:>9}  {e.line[:40]:<40} first {first} ms  {reply.strip()[:60]!r}')
+
+
+class Replayer:
+    def __init__(self, link, exchanges, speed):
+        self.link = link
+        self.script = exchanges
+        self.speed = speed
+        self.pos = 0
+        self.buffer = b''
+        self.pending = []         # (due time, bytes) still to send
+        self.payload = None       # None, ('len', n) or ('ctrlz', None)
+        self.payload_last = 0
+        self.baud_after = None
+        self.replayed = []        # (arrival time, exchange)
+        self.unmatched = 0
+        self.skipped = 0
+        self.dropped = 0
+
+    def run(self):
+        try:
+            while (self.pos < len(self.script) or self.pending) and self.link.running:
+                self.buffer += self.link.read(0.005)
+                self.send_due()
+                self.process()
+        except KeyboardInterrupt:
+            pass
+        self.report()
+        return self.link.close()
+
+    def send_due(self):
+        now = time.monotonic()
+        while self.pending and self.pending[0][0] <= now:
+            self.link.write(self.pending.pop(0)[1])
+            if not self.pending and self.baud_after:
+                self.link.set_baud(self.baud_after)
+                self.baud_after = None
+
+    def schedule(self, exchange):
+        if self.pending:
+            self.dropped += len(self.pending)
+        start = time.monotonic()
+        self.pending = [(start + offset / 1000.0 / self.speed, data) for offset, data in exchange.replies]
+        self.replayed.append((start, exchange))
+
+        m = re.match(r'AT\+IPR=(\d+)', exchange.line)
+        if m and any(b'OK' in d for _, d in exchange.replies):
+            self.baud_after = int(m.group(1))
+
+        if exchange.prompts:
+            m = re.match(r'AT\+CASEND=\d+,(\d+)', exchange.line)
+            self.payload = ('len', int(m.group(1))) if m else ('ctrlz', None)
+            self.payload_last = time.monotonic()
+
+    def match(self, key):
+        for i in range(self.pos, min(self.pos + LOOKAHEAD, len(self.script))):
+            if self.script[i].key == key:
+                self.skipped += i - self.pos
+                self.pos = i + 1
+                return self.script[i]
+        return None
+
+    def process(self):
+        while True:
+            if self.payload:
+                if not self.take_payload():
+                    return
+                continue
+
+            # Escape characters leave SMS prompt mode
+            while self.buffer[:1] in (bytes([ESC]), b'\r', b'\n'):
+                if self.buffer[0] == ESC:
+                    self.match('ESC')
+                self.buffer = self.buffer[1:]
+
+            end = self.buffer.find(b'\r')
+            if end == -1:
+                return
+            line = self.buffer[:end].decode(errors='replace').strip()
+            self.buffer = self.buffer[end + 1:]
+            if not line:
+                continue
+
+            exchange = self.match(command_key(line))
+            if exchange:
+                print(f'> {line}')
+                self.schedule(exchange)
+            else:
+                print(f'> {line}   (not in transcript)')
+                self.unmatched += 1
+                self.link.write(b'\r\nERROR\r\n')
+
+    def take_payload(self):
+        kind, length = self.payload
+        if kind == 'len':
+            if len(self.buffer) < length:
+                return False
+            self.buffer = self.buffer[length:]
+        else:
+            end = next((i for i, b in enumerate(self.buffer) if b in (CTRL_Z, ESC)), -1)
+            if end == -1:
+                if self.buffer and time.monotonic() - self.payload_last > PAYLOAD_QUIET_S:
+                    end = len(self.buffer) - 1
+                else:
+                    return False
+            self.buffer = self.buffer[end + 1:]
+
+        self.payload = None
+        if self.pos < len(self.script) and self.script[self.pos].key == 'PAYLOAD':
+            self.schedule(self.script[self.pos])
+            self.pos += 1
+        return True
+
+    def report(self):
+        rows = {}
+        for (start, e), nxt in zip(self.replayed, self.replayed[1:] + [None]):
+            end = nxt[0] if nxt else time.monotonic()
+            rows.setdefault(e.key, []).append(int((end - start) * 1000 * self.speed))
+
+        recorded = {}
+        for wake_rows in recorded_gaps(self.script).values():
+            for key, times in wake_rows.items():
+                recorded.setdefault(key, []).extend(times)
+
+        print(f'\nReplayed {len(self.replayed)} of {len(self.script)} exchanges '
+              f'({self.skipped} skipped, {self.unmatched} unmatched, {self.dropped} reply chunks dropped)')
+        print(f'  {"command":<12} {"recorded ms":>12} {"replay ms":>10} {"change":>8}')
+        for key in sorted(rows, key=lambda k: -sum(rows[k])):
+            rec = sum(recorded.get(key, [])[:len(rows[key])])
+            rep = sum(rows[key])
+            change = f'{(rep - rec) * 100 // rec:+d}%' if rec else '-'
+            print(f'  {key:<12} {rec:>12} {rep:>10} {change:>8}')
+        rec_total = sum(sum(v) for v in recorded.values())
+        rep_total = sum(sum(v) for v in rows.values())
+        print(f'  {"total":<12} {rec_total:>12} {rep_total:>10}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Show or replay SIM7070G UART transcripts')
+    sub = parser.add_subparsers(dest='action', required=True)
+
+    show_cmd = sub.add_parser('show', help='print recorded sessions')
+    show_cmd.add_argument('transcript', help='serial log with "dumptranscript" output or partition image')
+    show_cmd.add_argument('--wake', type=int, action='append', help='only these wakes (repeatable)')
+    show_cmd.add_argument('-v', '--verbose', action='store_true', help='list every exchange')
+
+    replay_cmd = sub.add_parser('replay', help='act as the modem with the recorded responses')
+    replay_cmd.add_argument('transcript')
+    replay_cmd.add_argument('--wake', type=int, action='append', help='only these wakes (repeatable)')
+    replay_cmd.add_argument('--port', help='serial device wired to the ESP32 modem UART')
+    replay_cmd.add_argument('--host', help='host build to run on a pseudo terminal, with its options')
+    replay_cmd.add_argument('--baud', type=int, default=115200)
+    replay_cmd.add_argument('--speed', type=float, default=1.0, help='time scale, 2 = twice as fast')
+    args = parser.parse_args()
+
+    exchanges = build_exchanges(load(args.transcript))
+    if args.wake:
+        exchanges = [e for e in exchanges if e.wake in args.wake]
+    if not exchanges:
+        parser.error('no exchanges in transcript')
+
+    if args.action == 'show':
+        show(exchanges, args.verbose)
+    else:
+        if args.port and args.host:
+            parser.error('--port and --host are exclusive')
+        link = SerialLink(args.port, args.baud)
+        if args.host:
+            link.spawn(args.host)
+        Replayer(link, exchanges, args.speed).run()
+
+
+if __name__ == '__main__':
+    main()
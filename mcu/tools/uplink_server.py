@@ -0,0 +1,278 @@
+"""Stand-in report server for the tracker's data uplink.
+
+Receives the binary UDP reports (data_uplink.cpp) and track batches
+(track_upload.cpp), prints them decoded and answers with an
+acknowledgement, so the data path can be tested on Linux without a real
+backend. Track batches are checked for CRC and sequence continuity, and
+bytes per point are reported:
+
+    python3 uplink_server.py --port 9000
+    python3 uplink_server.py --port 9000 --track-csv track.csv
+    python3 uplink_server.py --port 9000 --drop-acks   # force SMS fallback
+"""
+
+import argparse
+import csv
+import socket
+import struct
+import time
+
+MAGIC = 0xB7
+VERSION = 1
+MSG_REPORT = ord('R')
+MSG_TRACK = ord('T')
+MSG_ACK = ord('A')
+
+HEADER_FORMAT = '<BBBIH'
+HEADER_LEN = struct.calcsize(HEADER_FORMAT)
+
+# Must match the layout documented in data_uplink.cpp
+REPORT_FORMAT = '<BBBIHBBBBiiHHI'
+REPORT_LEN = struct.calcsize(REPORT_FORMAT)
+CELL_FORMAT = '<HHHIB'
+CELL_LEN = struct.calcsize(CELL_FORMAT)
+FUSED_FORMAT = '<iiHH'
+FUSED_LEN = struct.calcsize(FUSED_FORMAT)
+CELL_ACCURACY_STEP = 50
+
+# Must match the layout documented in track_upload.cpp
+TRACK_FORMAT = '<BBBIHIBIii'
+TRACK_HEADER_LEN = struct.calcsize(TRACK_FORMAT)
+TRACK_COORD_SCALE = 100000
+UDP_IP_OVERHEAD = 28  # IPv4 + UDP headers per datagram
+
+REPORT_TYPES = {0: 'location', 1: 'status', 2: 'no-fix', 3: 'cell'}
+ALERT_TYPES = {0: 'update', 1: 'low-battery', 2: 'test', 3: 'disconnect'}
+
+FLAG_LOCATION = 0x01
+FLAG_FRESH = 0x02
+FLAG_USER = 0x04
+FLAG_CELL = 0x08
+FLAG_CELL_ID = 0x10
+FLAG_UNVERIFIED = 0x20
+FLAG_FUSED = 0x40
+
+
+def decode_report(data):
+    """Decode one report datagram, returns a dict or None if malformed"""
+    if len(data) < REPORT_LEN:
+        return None
+
+    (magic, version, msg, device, seq, rtype, alert, flags, hdop,
+     lat, lon, speed, interval, fix_time) = struct.unpack(REPORT_FORMAT, data[:REPORT_LEN])
+    if magic != MAGIC or version != VERSION or msg != MSG_REPORT:
+        return None
+    trailers = (CELL_LEN if flags & FLAG_CELL_ID else 0) + (FUSED_LEN if flags & FLAG_FUSED else 0)
+    if len(data) != REPORT_LEN + trailers:
+        return None
+
+    report = {
+        'device': '%08X' % device,
+        'seq': seq,
+        'type': REPORT_TYPES.get(rtype, rtype),
+        'alert': ALERT_TYPES.get(alert, alert),
+        'user_present': bool(flags & FLAG_USER),
+        'interval_s': interval,
+    }
+    if flags & FLAG_LOCATION:
+        report.update({
+            'lat': lat / 1e6,
+            'lon': lon / 1e6,
+            'source': 'cell' if flags & FLAG_CELL else 'gnss',
+            'fresh': bool(flags & FLAG_FRESH),
+            'unverified': bool(flags & FLAG_UNVERIFIED),
+            'speed_kmh': speed / 10.0,
+            'fix_time': fix_time,
+        })
+        if flags & FLAG_CELL:
+            report['accuracy_m'] = hdop * CELL_ACCURACY_STEP
+        else:
+            report['hdop'] = hdop / 10.0 if hdop else None
+    pos = REPORT_LEN
+    if flags & FLAG_CELL_ID:
+        mcc, mnc, tac, cell_id, neighbors = struct.unpack(CELL_FORMAT, data[pos:pos + CELL_LEN])
+        report['cell'] = f'{mcc}-{mnc:02d}-{tac:X}-{cell_id:X}'
+        report['neighbors'] = neighbors
+        pos += CELL_LEN
+    if flags & FLAG_FUSED:
+        f_lat, f_lon, heading, uncertainty = struct.unpack(FUSED_FORMAT, data[pos:pos + FUSED_LEN])
+        report['fused'] = {
+            'lat': f_lat / 1e6,
+            'lon': f_lon / 1e6,
+            'heading_deg': heading / 100.0 if heading != 0xFFFF else None,
+            'uncertainty_m': uncertainty,
+        }
+    return report
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def read_varint(data, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError('truncated varint')
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_track(data):
+    """Decode a track batch, returns a dict or None if malformed"""
+    if len(data) < TRACK_HEADER_LEN + 2:
+        return None
+    if crc16(data[:-2]) != struct.unpack('<H', data[-2:])[0]:
+        return None
+
+    (magic, version, msg, device, seq, first, count,
+     fix_time, lat, lon) = struct.unpack(TRACK_FORMAT, data[:TRACK_HEADER_LEN])
+    if magic != MAGIC or version != VERSION or msg != MSG_TRACK:
+        return None
+
+    points = []
+    pos = TRACK_HEADER_LEN
+    try:
+        for i in range(count):
+            value, pos = read_varint(data, pos)
+            source = value & 0x03
+            fix_time += unzigzag(value >> 2)
+            value, pos = read_varint(data, pos)
+            lat += unzigzag(value)
+            value, pos = read_varint(data, pos)
+            lon += unzigzag(value)
+            speed, pos = read_varint(data, pos)
+            points.append({
+                'seq': first + i,
+                'time': fix_time,
+                'lat': lat / TRACK_COORD_SCALE,
+                'lon': lon / TRACK_COORD_SCALE,
+                'speed_kmh': speed / 10.0,
+                'source': source,
+            })
+    except ValueError:
+        return None
+    if pos != len(data) - 2:
+        return None
+
+    return {'device': '%08X' % device, 'seq': seq, 'first': first, 'points': points}
+
+
+def encode_ack(seq, payload=b''):
+    """Acknowledgement for a message sequence number"""
+    return struct.pack('<BBH', MAGIC, MSG_ACK, seq) + payload
+
+
+class UplinkServer:
+    def __init__(self, sock, drop_acks, track_csv):
+        self.sock = sock
+        self.drop_acks = drop_acks
+        self.track_csv = track_csv
+        self.seen_reports = set()
+        self.next_point = {}   # device -> next expected point sequence
+        self.track_points = 0
+        self.track_bytes = 0
+
+    def handle(self, data, addr):
+        stamp = time.strftime('%H:%M:%S')
+        msg = data[2] if len(data) >= HEADER_LEN else None
+
+        if msg == MSG_REPORT:
+            self.handle_report(data, addr, stamp)
+        elif msg == MSG_TRACK:
+            self.handle_track(data, addr, stamp)
+        else:
+            print(f'[{stamp}] {addr[0]}:{addr[1]} malformed datagram ({len(data)} bytes): {data.hex()}')
+
+    def handle_report(self, data, addr, stamp):
+        report = decode_report(data)
+        if report is None:
+            print(f'[{stamp}] {addr[0]}:{addr[1]} malformed report: {data.hex()}')
+            return
+
+        key = (report['device'], report['seq'])
+        duplicate = key in self.seen_reports
+        self.seen_reports.add(key)
+        print(f'[{stamp}] {addr[0]}:{addr[1]} {report}{" (duplicate)" if duplicate else ""}')
+        self.ack(report['seq'], addr)
+
+    def handle_track(self, data, addr, stamp):
+        batch = decode_track(data)
+        if batch is None:
+            print(f'[{stamp}] {addr[0]}:{addr[1]} track batch failed integrity check ({len(data)} bytes)')
+            return
+
+        device = batch['device']
+        expected = self.next_point.get(device, batch['first'])
+        if batch['first'] > expected:
+            print(f'           gap: points {expected}..{batch["first"] - 1} were never received')
+
+        new_points = [p for p in batch['points'] if p['seq'] >= expected]
+        if new_points:
+            self.next_point[device] = new_points[-1]['seq'] + 1
+        self.track_points += len(new_points)
+        self.track_bytes += len(data)
+
+        print(f'[{stamp}] {addr[0]}:{addr[1]} track {device} #{batch["seq"]}: '
+              f'{len(batch["points"])} points from {batch["first"]}, {len(new_points)} new, '
+              f'{len(data)} bytes ({len(data) / max(len(batch["points"]), 1):.1f} bytes/point)')
+        if self.track_points:
+            print(f'           total {self.track_points} points, '
+                  f'{self.track_bytes / self.track_points:.1f} bytes/point payload')
+        for p in new_points:
+            print(f'           {p}')
+        if self.track_csv and new_points:
+            with open(self.track_csv, 'a', newline='') as f:
+                writer = csv.writer(f)
+                for p in new_points:
+                    writer.writerow([device, p['seq'], p['time'], p['lat'], p['lon'],
+                                     p['speed_kmh'], p['source']])
+
+        next_point = self.next_point.get(device, batch['first'])
+        self.ack(batch['seq'], addr, struct.pack('<I', next_point))
+
+    def ack(self, seq, addr, payload=b''):
+        if not self.drop_acks:
+            self.sock.sendto(encode_ack(seq, payload), addr)
+
+
+def serve(host, port, drop_acks, track_csv):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((host, port))
+    print(f'Listening on {host}:{port} (report size {REPORT_LEN} bytes, '
+          f'+{UDP_IP_OVERHEAD} bytes IP/UDP per datagram)')
+
+    server = UplinkServer(sock, drop_acks, track_csv)
+    while True:
+        data, addr = sock.recvfrom(2048)
+        server.handle(data, addr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stand-in server for tracker data reports')
+    parser.add_argument('--host', default='0.0.0.0')
+    parser.add_argument('--port', type=int, default=9000)
+    parser.add_argument('--drop-acks', action='store_true',
+                        help='never acknowledge, to exercise the SMS fallback')
+    parser.add_argument('--track-csv', help='append received track points to this CSV file')
+    args = parser.parse_args()
+    serve(args.host, args.port, args.drop_acks, args.track_csv)
+
+
+if __name__ == '__main__':
+    main()